@@ -0,0 +1,342 @@
+/*
+ * GtkShot - A screen capture programme using GtkLib
+ * Copyright (C) 2012 flytreeleft @ CrazyDan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * 绘制内核的离屏基准: 在cairo图像表面上计时各类画笔的draw_track,
+ * 以及截图窗口覆盖层(遮罩/选区边框/缩放锚点/信息窗口)的绘制,
+ * 输出每次调用的耗时(ns)和像素吞吐(Mpixel/s),无需X服务.
+ * 画笔分为绘制中(live,每次重新生成路径/打码图像)
+ * 和已提交(compiled,回放缓存)两种状态.
+ * 用法: bench-draw [MILLISECONDS]
+ * MILLISECONDS为每项的最短计时时间,默认200
+ */
+
+#include <config.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include <gtk/gtk.h>
+
+#include "utils.h"
+#include "pen.h"
+#include "overlay.h"
+
+/* The size of the canvas of pens */
+#define CANVAS_WIDTH 1920
+#define CANVAS_HEIGHT 1080
+/* The minimum count of calls of a case */
+#define MIN_CALLS 16
+
+typedef void (*DrawFunc) (gpointer data, cairo_t *cr);
+
+typedef struct _Overlay {
+  GdkRectangle screen, section;
+  GdkPoint anchor[8];
+  PangoLayout *message;
+} Overlay;
+
+static void bench_pens(cairo_t *cr, GdkPixbuf *source, gdouble budget);
+static void bench_overlays(gint width, gint height, gdouble budget);
+static GtkShotPen* create_pen(GtkShotPenType type, gint width
+                                , gint height, gint points
+                                , GdkPixbuf *source);
+static void draw_live_pen(gpointer data, cairo_t *cr);
+static void draw_compiled_pen(gpointer data, cairo_t *cr);
+static void draw_mask(gpointer data, cairo_t *cr);
+static void draw_border(gpointer data, cairo_t *cr);
+static void draw_anchors(gpointer data, cairo_t *cr);
+static void draw_message(gpointer data, cairo_t *cr);
+static void run(const gchar *name, const gchar *variant, const gchar *size
+                  , DrawFunc draw, gpointer data, cairo_t *cr
+                  , gdouble pixels, gdouble budget);
+static GdkPixbuf* create_source(gint width, gint height);
+
+static const struct {
+  const gchar *name;
+  GtkShotPenType type;
+} PENS[] = {
+  {"rect", GTK_SHOT_PEN_RECT},
+  {"ellipse", GTK_SHOT_PEN_ELLIPSE},
+  {"arrow", GTK_SHOT_PEN_ARROW},
+  {"line", GTK_SHOT_PEN_LINE},
+  {"text", GTK_SHOT_PEN_TEXT},
+  {"mosaic", GTK_SHOT_PEN_MOSAIC},
+  {"blur", GTK_SHOT_PEN_BLUR}
+};
+// 画笔的范围
+static const GdkPoint EXTENTS[] = {{64, 48}, {480, 320}, {1600, 900}};
+// 手绘线条的点数,文字画笔的字符数
+static const gint POINTS[] = {16, 256, 4096};
+// 覆盖层的屏幕分辨率
+static const GdkPoint SCREENS[] = {{1920, 1080}, {3840, 2160}
+                                      , {7680, 4320}};
+
+int main(int argc, char *argv[]) {
+  gdouble budget = (argc > 1 ? atoi(argv[1]) : 200) / 1000.0;
+  gint i = 0;
+
+#if !GLIB_CHECK_VERSION(2, 36, 0)
+  g_type_init();
+#endif
+  if (budget <= 0) budget = 0.2;
+
+  printf("%-8s %-9s %-14s %14s %14s\n"
+            , "kernel", "variant", "size", "ns/call", "Mpixel/s");
+
+  cairo_surface_t *canvas =
+    cairo_image_surface_create(CAIRO_FORMAT_ARGB32
+                                , CANVAS_WIDTH, CANVAS_HEIGHT);
+  cairo_t *cr = cairo_create(canvas);
+  GdkPixbuf *source = create_source(CANVAS_WIDTH, CANVAS_HEIGHT);
+
+  bench_pens(cr, source, budget);
+
+  g_object_unref(source);
+  cairo_destroy(cr);
+  cairo_surface_destroy(canvas);
+
+  for (i = 0; i < G_N_ELEMENTS(SCREENS); i++) {
+    bench_overlays(SCREENS[i].x, SCREENS[i].y, budget);
+  }
+  pango_cairo_clear_layout_cache();
+
+  return 0;
+}
+
+void bench_pens(cairo_t *cr, GdkPixbuf *source, gdouble budget) {
+  gint i = 0, j = 0, k = 0;
+  gchar size[32];
+
+  for (i = 0; i < G_N_ELEMENTS(PENS); i++) {
+    for (j = 0; j < G_N_ELEMENTS(EXTENTS); j++) {
+      for (k = 0; k < G_N_ELEMENTS(POINTS); k++) {
+        // 点数仅对手绘线条和文字有意义
+        if (k > 0 && PENS[i].type != GTK_SHOT_PEN_LINE
+              && PENS[i].type != GTK_SHOT_PEN_TEXT) {
+          break;
+        }
+        GtkShotPen *pen = create_pen(PENS[i].type, EXTENTS[j].x
+                                      , EXTENTS[j].y, POINTS[k], source);
+        gdouble pixels = (gdouble) EXTENTS[j].x * EXTENTS[j].y;
+
+        // 以提交后的范围(含线宽,文字由排版决定)计算像素数
+        gtk_shot_pen_compile(pen);
+        if (pen->bounds.width > 0 && pen->bounds.height > 0) {
+          pixels = (gdouble) pen->bounds.width * pen->bounds.height;
+        }
+        gtk_shot_pen_invalidate(pen);
+
+        if (PENS[i].type == GTK_SHOT_PEN_LINE
+              || PENS[i].type == GTK_SHOT_PEN_TEXT) {
+          g_snprintf(size, sizeof(size), "%dx%d/%d"
+                      , EXTENTS[j].x, EXTENTS[j].y, POINTS[k]);
+        } else {
+          g_snprintf(size, sizeof(size), "%dx%d"
+                      , EXTENTS[j].x, EXTENTS[j].y);
+        }
+        run(PENS[i].name, "live", size, draw_live_pen, pen
+              , cr, pixels, budget);
+
+        gtk_shot_pen_compile(pen);
+        run(PENS[i].name, "compiled", size, draw_compiled_pen, pen
+              , cr, pixels, budget);
+
+        gtk_shot_pen_free(pen);
+      }
+    }
+  }
+}
+
+void bench_overlays(gint width, gint height, gdouble budget) {
+  cairo_surface_t *canvas =
+    cairo_image_surface_create(CAIRO_FORMAT_ARGB32, width, height);
+  cairo_t *cr = cairo_create(canvas);
+  Overlay overlay;
+  gchar size[32];
+  gint border = 2, anchor = 6, i = 0;
+  gint x0 = width / 4, y0 = height / 4;
+  gint x1 = width * 3 / 4, y1 = height * 3 / 4;
+
+  overlay.screen.x = overlay.screen.y = 0;
+  overlay.screen.width = width;
+  overlay.screen.height = height;
+  overlay.section.x = x0;
+  overlay.section.y = y0;
+  overlay.section.width = x1 - x0;
+  overlay.section.height = y1 - y0;
+  // 同gtk_shot_get_zoom_anchor
+  GdkPoint points[8] = {{x0, y0}, {(x0 + x1) / 2, y0}, {x1, y0}
+                          , {x1, (y0 + y1) / 2}, {x1, y1}
+                          , {(x0 + x1) / 2, y1}, {x0, y1}
+                          , {x0, (y0 + y1) / 2}};
+  for (i = 0; i < 8; i++) {
+    overlay.anchor[i].x = points[i].x - anchor;
+    overlay.anchor[i].y = points[i].y - anchor;
+  }
+  gchar *message = g_strdup_printf("x:%4d, y:%4d\nw:%4d, h:%4d"
+                                    , x0, y0, x1 - x0, y1 - y0);
+  g_snprintf(size, sizeof(size), "%dx%d", width, height);
+
+  gdouble area = (gdouble) width * height;
+  gdouble section = (gdouble) (x1 - x0) * (y1 - y0);
+  gint w = 0, h = 0;
+  // 与GtkShot相同,信息窗口的布局预先排版并复用
+  overlay.message = pango_cairo_create_layout(cr);
+  pango_layout_set_text(overlay.message, message, -1);
+  pango_layout_get_pixel_size(overlay.message, &w, &h);
+  g_free(message);
+
+  run("mask", "overlay", size, draw_mask, &overlay
+        , cr, area - section, budget);
+  run("section", "overlay", size, draw_border, &overlay
+        , cr, 2.0 * (x1 - x0 + y1 - y0) * border, budget);
+  run("anchor", "overlay", size, draw_anchors, &overlay
+        , cr, 8 * M_PI * anchor * anchor / 4, budget);
+  run("message", "overlay", size, draw_message, &overlay
+        , cr, (gdouble) (w + 16) * (h + 8), budget);
+
+  g_object_unref(overlay.message);
+  cairo_destroy(cr);
+  cairo_surface_destroy(canvas);
+}
+
+/** 在画布中央生成指定范围的画笔 */
+GtkShotPen* create_pen(GtkShotPenType type, gint width, gint height
+                          , gint points, GdkPixbuf *source) {
+  GtkShotPen *pen = gtk_shot_pen_new(type);
+  gint x = (CANVAS_WIDTH - width) / 2, y = (CANVAS_HEIGHT - height) / 2;
+  gint i = 0;
+
+  pen->start.x = x;
+  pen->start.y = y;
+  if (type == GTK_SHOT_PEN_LINE) {
+    // 折线在范围内往复,转折处的夹角各不相同
+    for (i = 0; i < points; i++) {
+      gdouble t = (gdouble) i / MAX(points - 1, 1);
+      pen->save_track(pen, x + width * t
+                        , y + height * (0.5 + 0.5 * sin(t * 37.0)));
+    }
+  } else if (type == GTK_SHOT_PEN_TEXT) {
+    GString *text = g_string_new(NULL);
+    for (i = 0; i < points; i++) {
+      g_string_append_c(text, i % 40 == 39 ? '\n' : 'a' + i % 26);
+    }
+    pen->text.content = g_string_free(text, FALSE);
+  } else {
+    pen->save_track(pen, x + width, y + height);
+  }
+  if (gtk_shot_pen_is_redaction(pen)) {
+    gtk_shot_pen_set_source(pen, source, 0, 0);
+  }
+
+  return pen;
+}
+
+/** 绘制中的画笔: 每次重新计算路径,打码画笔重新生成打码图像 */
+void draw_live_pen(gpointer data, cairo_t *cr) {
+  GtkShotPen *pen = data;
+
+  if (gtk_shot_pen_is_redaction(pen)) {
+    pen->redact.size = 0;
+  }
+  pen->draw_track(pen, cr);
+}
+
+void draw_compiled_pen(gpointer data, cairo_t *cr) {
+  GtkShotPen *pen = data;
+
+  pen->draw_track(pen, cr);
+}
+
+void draw_mask(gpointer data, cairo_t *cr) {
+  Overlay *overlay = data;
+
+  gtk_shot_overlay_draw_mask(cr, &overlay->screen, &overlay->section
+                                , 0x000000, 0.5);
+}
+
+void draw_border(gpointer data, cairo_t *cr) {
+  Overlay *overlay = data;
+
+  gtk_shot_overlay_draw_border(cr, &overlay->section, 2, 0x00ff00);
+}
+
+void draw_anchors(gpointer data, cairo_t *cr) {
+  Overlay *overlay = data;
+
+  gtk_shot_overlay_draw_anchors(cr, overlay->anchor, 6, 0x00ff00);
+}
+
+void draw_message(gpointer data, cairo_t *cr) {
+  Overlay *overlay = data;
+
+  gtk_shot_overlay_draw_message(cr, overlay->message, &overlay->screen
+                                  , &overlay->section, 2, 6, 0.4, TRUE);
+}
+
+/**
+ * 先预热一次,再成批调用直到超过计时时间,
+ * 结束前刷新表面以计入cairo延迟的光栅化
+ */
+void run(const gchar *name, const gchar *variant, const gchar *size
+            , DrawFunc draw, gpointer data, cairo_t *cr
+            , gdouble pixels, gdouble budget) {
+  cairo_surface_t *surface = cairo_get_target(cr);
+  GTimer *timer = g_timer_new();
+  gulong calls = 0, batch = 1, i = 0;
+  gdouble elapsed = 0;
+
+  draw(data, cr);
+  cairo_surface_flush(surface);
+
+  g_timer_start(timer);
+  while (elapsed < budget || calls < MIN_CALLS) {
+    for (i = 0; i < batch; i++) {
+      draw(data, cr);
+    }
+    calls += batch;
+    batch = MIN(batch * 2, 1024);
+    cairo_surface_flush(surface);
+    elapsed = g_timer_elapsed(timer, NULL);
+  }
+  g_timer_destroy(timer);
+
+  printf("%-8s %-9s %-14s %14.0f %14.1f\n", name, variant, size
+            , elapsed * 1e9 / calls, pixels * calls / elapsed / 1e6);
+}
+
+/** 打码画笔的原始截图,内容需有足够的细节 */
+GdkPixbuf* create_source(gint width, gint height) {
+  GdkPixbuf *pixbuf = gdk_pixbuf_new(GDK_COLORSPACE_RGB, FALSE, 8
+                                        , width, height);
+  gint rowstride = gdk_pixbuf_get_rowstride(pixbuf);
+  guchar *pixels = gdk_pixbuf_get_pixels(pixbuf);
+  gint x = 0, y = 0;
+
+  for (y = 0; y < height; y++) {
+    guchar *p = pixels + y * rowstride;
+    for (x = 0; x < width; x++, p += 3) {
+      p[0] = x & 0xff;
+      p[1] = y & 0xff;
+      p[2] = (x ^ y) & 0xff;
+    }
+  }
+
+  return pixbuf;
+}
@@ -0,0 +1,184 @@
+/*
+ * GtkShot - A screen capture programme using GtkLib
+ * Copyright (C) 2012 flytreeleft @ CrazyDan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * 边缘索引的基准: 在合成的界面截图(窗口/按钮/文字块)上
+ * 计时gtk_shot_edges_build到后台线程完成的耗时,
+ * 以及在计算中途调用gtk_shot_edges_clear(界面线程)的耗时,
+ * 并检查已知的窗口边框能否被吸附.无需X服务.
+ * 用法: bench-edges [ITERATIONS]
+ * 4K截图的中位耗时超过BUDGET毫秒时返回1
+ */
+
+#include <config.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <gtk/gtk.h>
+
+#include "utils.h"
+#include "edges.h"
+
+/* The maximum median milliseconds to build the edges of a 4K screenshot */
+#define BUDGET 20
+/* The size (in pixels) of a window grid cell of the screenshot */
+#define CELL 480
+
+static gboolean bench_screen(gint width, gint height, gint iterations);
+static GdkPixbuf* create_screen(gint width, gint height);
+static void fill(GdkPixbuf *pixbuf, gint x, gint y
+                    , gint width, gint height, guint32 color);
+static gint compare_double(gconstpointer a, gconstpointer b);
+
+static const GdkPoint SCREENS[] = {{1920, 1080}, {3840, 2160}};
+
+int main(int argc, char *argv[]) {
+  gint iterations = argc > 1 ? atoi(argv[1]) : 20;
+  gboolean ok = TRUE;
+  gint i = 0;
+
+  if (!g_thread_supported()) g_thread_init(NULL);
+#if !GLIB_CHECK_VERSION(2, 36, 0)
+  g_type_init();
+#endif
+  if (iterations <= 0) iterations = 20;
+
+  printf("%-10s %10s %10s %10s %12s %6s\n"
+            , "size", "min ms", "p50 ms", "max ms", "clear us", "snap");
+  for (i = 0; i < G_N_ELEMENTS(SCREENS); i++) {
+    if (!bench_screen(SCREENS[i].x, SCREENS[i].y, iterations)
+          && SCREENS[i].x >= 3840) {
+      ok = FALSE;
+    }
+  }
+  if (!ok) {
+    fprintf(stderr, "4K edges exceed %d ms\n", BUDGET);
+  }
+  return ok ? 0 : 1;
+}
+
+/** @return 中位耗时不超过BUDGET毫秒时返回TRUE */
+gboolean bench_screen(gint width, gint height, gint iterations) {
+  GdkPixbuf *pixbuf = create_screen(width, height);
+  GtkShotEdges *edges = gtk_shot_edges_new();
+  GArray *build_ms = g_array_new(FALSE, FALSE, sizeof(gdouble));
+  GTimer *timer = g_timer_new();
+  gdouble clear_us = 0, ms = 0;
+  gint i = 0, snapped = -1;
+  gboolean found = FALSE;
+  gchar size[32];
+
+  // 预热: 首次创建线程及分配行缓冲
+  gtk_shot_edges_build(edges, pixbuf, 0, 0);
+  gtk_shot_edges_wait(edges);
+
+  for (i = 0; i < iterations; i++) {
+    g_timer_start(timer);
+    gtk_shot_edges_build(edges, pixbuf, 0, 0);
+    gtk_shot_edges_wait(edges);
+    ms = g_timer_elapsed(timer, NULL) * 1000;
+    g_array_append_val(build_ms, ms);
+  }
+  // 窗口的左边框位于每个网格的第16列
+  found = gtk_shot_edges_snap_x(edges, CELL + 16 - 3
+                                  , CELL + 64, CELL + 128, &snapped)
+            && snapped == CELL + 16;
+
+  // 计算中途被取代时,界面线程不应等待后台线程
+  for (i = 0; i < iterations; i++) {
+    gtk_shot_edges_build(edges, pixbuf, 0, 0);
+    g_timer_start(timer);
+    gtk_shot_edges_clear(edges);
+    clear_us += g_timer_elapsed(timer, NULL) * 1e6;
+    gtk_shot_edges_wait(edges);
+  }
+
+  g_array_sort(build_ms, compare_double);
+  ms = g_array_index(build_ms, gdouble, build_ms->len / 2);
+  g_snprintf(size, sizeof(size), "%dx%d", width, height);
+  printf("%-10s %10.2f %10.2f %10.2f %12.1f %6s\n", size
+            , g_array_index(build_ms, gdouble, 0), ms
+            , g_array_index(build_ms, gdouble, build_ms->len - 1)
+            , clear_us / iterations, found ? "ok" : "miss");
+
+  g_timer_destroy(timer);
+  g_array_free(build_ms, TRUE);
+  gtk_shot_edges_destroy(edges);
+  g_object_unref(pixbuf);
+
+  return ms <= BUDGET;
+}
+
+/**
+ * 合成的界面截图: 渐变的桌面上按网格排列窗口,
+ * 每个窗口有边框/标题栏/按钮,以及模拟文字的细条纹
+ */
+GdkPixbuf* create_screen(gint width, gint height) {
+  GdkPixbuf *pixbuf = gdk_pixbuf_new(GDK_COLORSPACE_RGB, FALSE, 8
+                                        , width, height);
+  gint rowstride = gdk_pixbuf_get_rowstride(pixbuf);
+  guchar *pixels = gdk_pixbuf_get_pixels(pixbuf);
+  gint x = 0, y = 0, i = 0;
+
+  for (y = 0; y < height; y++) {
+    guchar *p = pixels + y * rowstride;
+    for (x = 0; x < width; x++, p += 3) {
+      p[0] = 40 + x * 40 / width;
+      p[1] = 60 + y * 40 / height;
+      p[2] = 90;
+    }
+  }
+  for (y = 0; y + CELL <= height; y += CELL) {
+    for (x = 0; x + CELL <= width; x += CELL) {
+      // 边框, 客户区, 标题栏
+      fill(pixbuf, x + 16, y + 16, CELL - 32, CELL - 32, 0x000000);
+      fill(pixbuf, x + 18, y + 48, CELL - 36, CELL - 66, 0xf0f0f0);
+      fill(pixbuf, x + 18, y + 18, CELL - 36, 30, 0x3465a4);
+      for (i = 0; i < 3; i++) {
+        fill(pixbuf, x + CELL - 48 - i * 28, y + 22, 22, 22, 0xcc0000);
+      }
+      for (i = 0; i < 12; i++) {
+        fill(pixbuf, x + 32, y + 64 + i * 24
+                , (CELL - 96) * (12 - i % 5) / 12, 10, 0x202020);
+      }
+    }
+  }
+
+  return pixbuf;
+}
+
+void fill(GdkPixbuf *pixbuf, gint x, gint y
+            , gint width, gint height, guint32 color) {
+  gint rowstride = gdk_pixbuf_get_rowstride(pixbuf);
+  guchar *pixels = gdk_pixbuf_get_pixels(pixbuf);
+  gint i = 0, j = 0;
+
+  for (j = y; j < y + height; j++) {
+    guchar *p = pixels + j * rowstride + x * 3;
+    for (i = 0; i < width; i++, p += 3) {
+      p[0] = (color >> 16) & 0xff;
+      p[1] = (color >> 8) & 0xff;
+      p[2] = color & 0xff;
+    }
+  }
+}
+
+gint compare_double(gconstpointer a, gconstpointer b) {
+  gdouble x = *(const gdouble*) a, y = *(const gdouble*) b;
+  return x < y ? -1 : x > y;
+}
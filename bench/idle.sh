@@ -0,0 +1,83 @@
+#!/bin/sh
+#
+# GtkShot - A screen capture programme using GtkLib
+# Copyright (C) 2012 flytreeleft @ CrazyDan
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#      http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+#
+# 在Xvfb中以常驻模式(--daemon)启动gtkshot,
+# 通过控制端口显示并隐藏一次截图窗口(截屏,隐藏后释放缓存等一次性工作),
+# 待其稳定后统计空闲窗口期内所有线程的上下文切换次数(/proc),
+# 有任何唤醒即失败.
+# 环境变量:
+#   GTKSHOT         gtkshot程序, 默认../src/gtkshot
+#   IDLE_WINDOW     空闲窗口期(秒), 默认60
+#   IDLE_SETTLE     开始统计前的等待时间(秒), 默认5
+#   BENCH_DISPLAY   Xvfb使用的显示号, 默认99
+
+GTKSHOT=${GTKSHOT:-../src/gtkshot}
+WINDOW=${IDLE_WINDOW:-60}
+SETTLE=${IDLE_SETTLE:-5}
+DISPLAY_NUM=${BENCH_DISPLAY:-99}
+LOCK_FILE=/tmp/gtkshot.lock
+
+if ! command -v Xvfb >/dev/null 2>&1; then
+  echo "Xvfb is required by idle test" >&2
+  exit 1
+fi
+if [ -e $LOCK_FILE ]; then
+  echo "another GtkShot is running, see $LOCK_FILE" >&2
+  exit 1
+fi
+
+# 进程所有线程的上下文切换次数之和
+switches() {
+  cat /proc/$1/task/*/status 2>/dev/null \
+    | awk '/ctxt_switches/ { n += $2 } END { print n + 0 }'
+}
+
+Xvfb :$DISPLAY_NUM -screen 0 1920x1080x24 -nolisten tcp >/dev/null 2>&1 &
+xvfb=$!
+for i in 1 2 3 4 5 6 7 8 9 10; do
+  [ -e /tmp/.X11-unix/X$DISPLAY_NUM ] && break
+  sleep 0.5
+done
+
+# 释放缓存的定时器在隐藏后1秒触发,在等待期间完成
+DISPLAY=:$DISPLAY_NUM $GTKSHOT --daemon --idle-timeout 1 &
+shot=$!
+sleep 1
+$GTKSHOT --control show >/dev/null
+sleep 1
+$GTKSHOT --control hide >/dev/null
+sleep $SETTLE
+
+status=0
+if kill -0 $shot 2>/dev/null; then
+  before=$(switches $shot)
+  sleep $WINDOW
+  after=$(switches $shot)
+  wakeups=$((after - before))
+  echo "idle: $wakeups wakeup(s) in $WINDOW seconds"
+  [ $wakeups -eq 0 ] || status=1
+else
+  echo "gtkshot exited before the idle window" >&2
+  status=1
+fi
+
+kill -INT $shot 2>/dev/null
+wait $shot 2>/dev/null
+kill $xvfb
+wait $xvfb 2>/dev/null
+
+exit $status
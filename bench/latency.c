@@ -0,0 +1,336 @@
+/*
+ * GtkShot - A screen capture programme using GtkLib
+ * Copyright (C) 2012 flytreeleft @ CrazyDan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * 交互延时基准: 以屏幕大小的合成图像显示截图窗口,
+ * 向窗口送入脚本化的操作事件,每个事件后同步完成重绘,
+ * 统计重绘(expose)耗时和事件到完成绘制的延时,
+ * 以JSON输出p50/p95/p99及进程的内存峰值.
+ * 用法: bench-latency SCENARIO
+ * SCENARIO: drag-select, zoom-anchors, freehand, text, undo-storm
+ * 通常由latency.sh在不同分辨率的Xvfb中运行
+ */
+
+#include <config.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+
+#include <gtk/gtk.h>
+#include <gdk/gdkkeysyms.h>
+
+#include "utils.h"
+#include "shot.h"
+#include "journal.h"
+
+/* The count of freehand strokes */
+#define FREEHAND_STROKES 500
+/* The count of text annotations */
+#define TEXT_PENS 300
+/* The count of pens undone */
+#define UNDO_PENS 500
+/* The count of motion events of a drag */
+#define DRAG_STEPS 300
+
+typedef struct _Bench {
+  GtkShot *shot;
+  GtkShotJournal *journal;
+  GTimer *timer;
+  gboolean measuring;
+  gdouble expose_start; // 本次重绘开始的时间
+  guint exposes;
+  GArray *expose_ms, *latency_ms;
+} Bench;
+
+static void run_drag_select(Bench *bench);
+static void run_zoom_anchors(Bench *bench);
+static void run_freehand(Bench *bench);
+static void run_text(Bench *bench);
+static void run_undo_storm(Bench *bench);
+static void select_section(Bench *bench, gint x0, gint y0
+                              , gint x1, gint y1);
+static void drag(Bench *bench, gint x0, gint y0, gint x1, gint y1
+                    , gint steps);
+static void send(Bench *bench, GdkEventType type, gint x, gint y
+                    , guint state, guint keyval);
+static gboolean on_expose(GtkWidget *widget, GdkEventExpose *event
+                            , Bench *bench);
+static GdkPixbuf* create_screen(gint width, gint height);
+static void flush_events();
+static gint compare_double(gconstpointer a, gconstpointer b);
+static void print_percentiles(const char *name, GArray *values);
+
+static const struct {
+  const char *name;
+  void (*run) (Bench *bench);
+} scenarios[] = {
+  {"drag-select", run_drag_select},
+  {"zoom-anchors", run_zoom_anchors},
+  {"freehand", run_freehand},
+  {"text", run_text},
+  {"undo-storm", run_undo_storm}
+};
+
+int main(int argc, char *argv[]) {
+  Bench bench;
+  gint i = 0;
+
+  if (!g_thread_supported()) g_thread_init(NULL);
+  gtk_init(&argc, &argv);
+
+  for (i = 0; i < G_N_ELEMENTS(scenarios); i++) {
+    if (argc > 1 && strcmp(argv[1], scenarios[i].name) == 0) break;
+  }
+  if (i == G_N_ELEMENTS(scenarios)) {
+    fprintf(stderr, "usage: %s SCENARIO\n", argv[0]);
+    return 1;
+  }
+
+  GdkScreen *screen = gdk_screen_get_default();
+  gint width = gdk_screen_get_width(screen);
+  gint height = gdk_screen_get_height(screen);
+  GdkPixbuf *pixbuf = create_screen(width, height);
+
+  memset(&bench, 0, sizeof(bench));
+  bench.shot = gtk_shot_new();
+  bench.journal = gtk_shot_journal_new(GTK_WIDGET(bench.shot));
+  bench.timer = g_timer_new();
+  bench.expose_ms = g_array_new(FALSE, FALSE, sizeof(gdouble));
+  bench.latency_ms = g_array_new(FALSE, FALSE, sizeof(gdouble));
+  g_signal_connect(bench.shot, "expose-event"
+                      , G_CALLBACK(on_expose), &bench);
+
+  gtk_shot_show_pixbuf(bench.shot, pixbuf);
+  g_object_unref(pixbuf);
+  flush_events();
+
+  scenarios[i].run(&bench);
+
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  printf("{\"scenario\": \"%s\", \"screen\": \"%dx%d\""
+            ", \"events\": %u, \"exposes\": %u, "
+            , scenarios[i].name, width, height
+            , bench.latency_ms->len, bench.expose_ms->len);
+  print_percentiles("expose_ms", bench.expose_ms);
+  printf(", ");
+  print_percentiles("latency_ms", bench.latency_ms);
+  printf(", \"peak_rss_kib\": %ld}\n", usage.ru_maxrss);
+
+  g_array_free(bench.expose_ms, TRUE);
+  g_array_free(bench.latency_ms, TRUE);
+  g_timer_destroy(bench.timer);
+  gtk_shot_journal_destroy(bench.journal);
+
+  return 0;
+}
+
+/** 从左上到右下拖出选区 */
+void run_drag_select(Bench *bench) {
+  GtkShot *shot = bench->shot;
+
+  bench->measuring = TRUE;
+  drag(bench, shot->x + 50, shot->y + 50
+          , shot->x + shot->width - 50, shot->y + shot->height - 50
+          , DRAG_STEPS);
+}
+
+/** 拖动选区右下角的锚点缩放选区 */
+void run_zoom_anchors(Bench *bench) {
+  GtkShot *shot = bench->shot;
+  gint x = 0, y = 0;
+
+  select_section(bench, shot->x + 100, shot->y + 100
+                    , shot->x + shot->width / 2
+                    , shot->y + shot->height / 2);
+  x = shot->section.x + shot->section.width;
+  y = shot->section.y + shot->section.height;
+  bench->measuring = TRUE;
+  // 先移动到锚点上,以确定鼠标位置
+  send(bench, GDK_MOTION_NOTIFY, x, y, 0, 0);
+  drag(bench, x, y, shot->x + shot->width - 100
+          , shot->y + shot->height - 100, DRAG_STEPS);
+}
+
+/** 在选区中绘制大量自由线条 */
+void run_freehand(Bench *bench) {
+  GtkShot *shot = bench->shot;
+  gint i = 0;
+
+  select_section(bench, shot->x + 10, shot->y + 10
+                    , shot->x + shot->width - 10
+                    , shot->y + shot->height - 10);
+  gtk_shot_set_pen(shot, gtk_shot_pen_new(GTK_SHOT_PEN_LINE));
+  bench->measuring = TRUE;
+  for (i = 0; i < FREEHAND_STROKES; i++) {
+    gint x = shot->x + 20 + (i * 37) % MAX(shot->width - 120, 1);
+    gint y = shot->y + 20 + (i * 53) % MAX(shot->height - 120, 1);
+    drag(bench, x, y, x + 80, y + 60, 4);
+  }
+}
+
+/** 存在大量文本时拖动绘制矩形 */
+void run_text(Bench *bench) {
+  GtkShot *shot = bench->shot;
+  gint i = 0;
+
+  select_section(bench, shot->x + 10, shot->y + 10
+                    , shot->x + shot->width - 10
+                    , shot->y + shot->height - 10);
+  gtk_shot_set_pen(shot, gtk_shot_pen_new(GTK_SHOT_PEN_TEXT));
+  for (i = 0; i < TEXT_PENS; i++) {
+    shot->pen->start.x = shot->x + 20 + (i % 10) * (shot->width / 11);
+    shot->pen->start.y = shot->y + 40 + (i / 10) * 24;
+    gtk_shot_pen_set_text(shot->pen
+              , g_strdup_printf("annotation #%d: the quick brown fox", i));
+    gtk_shot_save_pen(shot);
+  }
+  gtk_shot_remove_pen(shot);
+  gtk_shot_set_pen(shot, gtk_shot_pen_new(GTK_SHOT_PEN_RECT));
+  flush_events();
+
+  bench->measuring = TRUE;
+  drag(bench, shot->x + 100, shot->y + 100
+          , shot->x + shot->width - 100, shot->y + shot->height - 100
+          , DRAG_STEPS);
+}
+
+/** 连续撤销大量画笔 */
+void run_undo_storm(Bench *bench) {
+  GtkShot *shot = bench->shot;
+  gint i = 0;
+
+  select_section(bench, shot->x + 10, shot->y + 10
+                    , shot->x + shot->width - 10
+                    , shot->y + shot->height - 10);
+  gtk_shot_set_pen(shot, gtk_shot_pen_new(GTK_SHOT_PEN_RECT));
+  for (i = 0; i < UNDO_PENS; i++) {
+    gint x = shot->x + 20 + (i * 37) % MAX(shot->width - 120, 1);
+    gint y = shot->y + 20 + (i * 53) % MAX(shot->height - 120, 1);
+    drag(bench, x, y, x + 80, y + 60, 1);
+  }
+  bench->measuring = TRUE;
+  for (i = 0; i < UNDO_PENS; i++) {
+    send(bench, GDK_KEY_PRESS, 0, 0, GDK_CONTROL_MASK, GDK_z);
+    send(bench, GDK_KEY_RELEASE, 0, 0, GDK_CONTROL_MASK, GDK_z);
+  }
+}
+
+void select_section(Bench *bench, gint x0, gint y0, gint x1, gint y1) {
+  drag(bench, x0, y0, x1, y1, 8);
+  flush_events();
+}
+
+void drag(Bench *bench, gint x0, gint y0, gint x1, gint y1
+            , gint steps) {
+  gint i = 0;
+
+  send(bench, GDK_BUTTON_PRESS, x0, y0, 0, 0);
+  for (i = 1; i <= steps; i++) {
+    send(bench, GDK_MOTION_NOTIFY
+            , x0 + (x1 - x0) * i / steps
+            , y0 + (y1 - y0) * i / steps
+            , GDK_BUTTON1_MASK, 0);
+  }
+  send(bench, GDK_BUTTON_RELEASE, x1, y1, GDK_BUTTON1_MASK, 0);
+}
+
+/** 送入事件并同步完成重绘,记录耗时 */
+void send(Bench *bench, GdkEventType type, gint x, gint y
+            , guint state, guint keyval) {
+  GdkWindow *window = GTK_WIDGET(bench->shot)->window;
+  GtkShotJournalEvent e = {.time = 0, .type = type, .button = 1
+                            , .state = state, .x = x, .y = y
+                            , .keyval = keyval};
+  guint exposes = bench->exposes;
+  gdouble start = g_timer_elapsed(bench->timer, NULL), end = 0;
+
+  gtk_shot_journal_send(bench->journal, &e);
+  gdk_window_process_updates(window, TRUE);
+  end = g_timer_elapsed(bench->timer, NULL);
+  // 等待X服务器完成绘制
+  gdk_display_sync(gdk_drawable_get_display(window));
+
+  if (bench->measuring) {
+    gdouble ms = (end - bench->expose_start) * 1000;
+    if (bench->exposes != exposes) {
+      g_array_append_val(bench->expose_ms, ms);
+    }
+    ms = (g_timer_elapsed(bench->timer, NULL) - start) * 1000;
+    g_array_append_val(bench->latency_ms, ms);
+  }
+}
+
+gboolean on_expose(GtkWidget *widget, GdkEventExpose *event
+                      , Bench *bench) {
+  bench->exposes++;
+  bench->expose_start = g_timer_elapsed(bench->timer, NULL);
+  return FALSE;
+}
+
+/** 类似桌面的合成图像: 渐变背景上分布着带边框的"窗口" */
+GdkPixbuf* create_screen(gint width, gint height) {
+  GdkPixbuf *pixbuf = gdk_pixbuf_new(GDK_COLORSPACE_RGB, FALSE, 8
+                                        , width, height);
+  gint n_channels = gdk_pixbuf_get_n_channels(pixbuf);
+  gint rowstride = gdk_pixbuf_get_rowstride(pixbuf);
+  guchar *pixels = gdk_pixbuf_get_pixels(pixbuf);
+  gint x = 0, y = 0;
+
+  for (y = 0; y < height; y++) {
+    guchar *p = pixels + y * rowstride;
+    for (x = 0; x < width; x++, p += n_channels) {
+      gboolean border = (x % 480 == 20 || y % 360 == 20);
+      gboolean text = (x % 480 > 40 && y % 12 < 2 && (x / 6) % 7 != 0);
+      p[0] = border ? 0x30 : (text ? 0x20 : 0x80 + x * 0x7f / width);
+      p[1] = border ? 0x30 : (text ? 0x20 : 0x90 + y * 0x6f / height);
+      p[2] = border ? 0x30 : (text ? 0x20 : 0xc0);
+    }
+  }
+  return pixbuf;
+}
+
+void flush_events() {
+  gdk_flush();
+  while (gtk_events_pending()) {
+    gtk_main_iteration();
+  }
+}
+
+gint compare_double(gconstpointer a, gconstpointer b) {
+  gdouble x = *(const gdouble*) a, y = *(const gdouble*) b;
+  return x < y ? -1 : (x > y ? 1 : 0);
+}
+
+void print_percentiles(const char *name, GArray *values) {
+  gdouble q[] = {0.50, 0.95, 0.99};
+  const char *key[] = {"p50", "p95", "p99"};
+  gint i = 0;
+
+  g_array_sort(values, compare_double);
+  printf("\"%s\": {", name);
+  for (i = 0; i < G_N_ELEMENTS(q); i++) {
+    gdouble v = values->len > 0 ?
+                  g_array_index(values, gdouble
+                                  , (guint) ((values->len - 1) * q[i]))
+                  : 0;
+    printf("%s\"%s\": %.3f", i > 0 ? ", " : "", key[i], v);
+  }
+  printf("}");
+}
@@ -0,0 +1,64 @@
+#!/bin/sh
+#
+# GtkShot - A screen capture programme using GtkLib
+# Copyright (C) 2012 flytreeleft @ CrazyDan
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#      http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+#
+# 在不同分辨率的Xvfb中逐个运行bench-latency的场景,
+# 每个场景单独一个进程(内存峰值互不影响),
+# 结果以JSON数组输出到标准输出及bench-latency.json.
+# 环境变量:
+#   BENCH_SCREENS   分辨率列表, 默认"1920x1080 3840x2160 7680x4320"
+#   BENCH_SCENARIOS 场景列表, 默认全部场景
+#   BENCH_DISPLAY   Xvfb使用的显示号, 默认99
+
+BENCH=${BENCH:-./bench-latency}
+SCREENS=${BENCH_SCREENS:-"1920x1080 3840x2160 7680x4320"}
+SCENARIOS=${BENCH_SCENARIOS:-"drag-select zoom-anchors freehand text undo-storm"}
+DISPLAY_NUM=${BENCH_DISPLAY:-99}
+OUTPUT=bench-latency.json
+
+if ! command -v Xvfb >/dev/null 2>&1; then
+  echo "Xvfb is required by latency benchmark" >&2
+  exit 1
+fi
+
+status=0
+sep=""
+echo "[" > $OUTPUT
+for screen in $SCREENS; do
+  Xvfb :$DISPLAY_NUM -screen 0 ${screen}x24 -nolisten tcp >/dev/null 2>&1 &
+  xvfb=$!
+  # 等待Xvfb就绪
+  for i in 1 2 3 4 5 6 7 8 9 10; do
+    [ -e /tmp/.X11-unix/X$DISPLAY_NUM ] && break
+    sleep 0.5
+  done
+  for scenario in $SCENARIOS; do
+    if result=$(DISPLAY=:$DISPLAY_NUM $BENCH $scenario); then
+      printf '%s  %s' "$sep" "$result" >> $OUTPUT
+      sep=",
+"
+    else
+      echo "scenario $scenario failed on $screen" >&2
+      status=1
+    fi
+  done
+  kill $xvfb
+  wait $xvfb 2>/dev/null
+done
+printf '\n]\n' >> $OUTPUT
+cat $OUTPUT
+
+exit $status
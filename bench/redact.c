@@ -0,0 +1,156 @@
+/*
+ * GtkShot - A screen capture programme using GtkLib
+ * Copyright (C) 2012 flytreeleft @ CrazyDan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * 打码画笔的拖动基准: 从屏幕左上角拖动到右下角,
+ * 计时每次鼠标移动后的重绘(预览图像的重新生成及绘制),
+ * 以及松开鼠标后以原始分辨率生成打码图像的耗时.无需X服务.
+ * 用法: bench-redact [STEPS]
+ * 1080p屏幕拖动的中位耗时超过BUDGET毫秒时返回1
+ */
+
+#include <config.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <gtk/gtk.h>
+
+#include "utils.h"
+#include "pen.h"
+
+/* The maximum median milliseconds of a motion of a 1080p drag */
+#define BUDGET 16
+
+static gboolean bench_drag(const gchar *name, GtkShotPenType type
+                              , gint width, gint height, gint steps);
+static GdkPixbuf* create_source(gint width, gint height);
+static gint compare_double(gconstpointer a, gconstpointer b);
+
+static const struct {
+  const gchar *name;
+  GtkShotPenType type;
+} PENS[] = {
+  {"mosaic", GTK_SHOT_PEN_MOSAIC},
+  {"blur", GTK_SHOT_PEN_BLUR}
+};
+static const GdkPoint SCREENS[] = {{1920, 1080}, {3840, 2160}};
+
+int main(int argc, char *argv[]) {
+  gint steps = argc > 1 ? atoi(argv[1]) : 60;
+  gboolean ok = TRUE;
+  gint i = 0, j = 0;
+
+#if !GLIB_CHECK_VERSION(2, 36, 0)
+  g_type_init();
+#endif
+  if (steps <= 0) steps = 60;
+
+  printf("%-8s %-10s %10s %10s %10s %12s\n"
+            , "pen", "size", "min ms", "p50 ms", "max ms", "release ms");
+  for (i = 0; i < G_N_ELEMENTS(PENS); i++) {
+    for (j = 0; j < G_N_ELEMENTS(SCREENS); j++) {
+      if (!bench_drag(PENS[i].name, PENS[i].type
+                        , SCREENS[j].x, SCREENS[j].y, steps)
+            && SCREENS[j].x <= 1920) {
+        ok = FALSE;
+      }
+    }
+  }
+  if (!ok) {
+    fprintf(stderr, "1080p redaction drag exceeds %d ms\n", BUDGET);
+  }
+  return ok ? 0 : 1;
+}
+
+/**
+ * 同GtkShot: 拖动期间引用整屏截图,松开时截取副本.
+ * 每步结束前刷新表面以计入cairo的光栅化
+ * @return 每次移动的中位耗时不超过BUDGET毫秒时返回TRUE
+ */
+gboolean bench_drag(const gchar *name, GtkShotPenType type
+                        , gint width, gint height, gint steps) {
+  GdkPixbuf *source = create_source(width, height);
+  cairo_surface_t *canvas =
+    cairo_image_surface_create(CAIRO_FORMAT_ARGB32, width, height);
+  cairo_t *cr = cairo_create(canvas);
+  GtkShotPen *pen = gtk_shot_pen_new(type);
+  GArray *motion_ms = g_array_new(FALSE, FALSE, sizeof(gdouble));
+  GTimer *timer = g_timer_new();
+  gdouble ms = 0, release = 0;
+  gint i = 0;
+  gchar size[32];
+
+  pen->start.x = pen->start.y = 0;
+  gtk_shot_pen_set_source(pen, source, 0, 0);
+  for (i = 1; i <= steps; i++) {
+    pen->save_track(pen, width * i / steps, height * i / steps);
+    g_timer_start(timer);
+    pen->draw_track(pen, cr);
+    cairo_surface_flush(canvas);
+    ms = g_timer_elapsed(timer, NULL) * 1000;
+    g_array_append_val(motion_ms, ms);
+  }
+
+  g_timer_start(timer);
+  gtk_shot_pen_snapshot_source(pen);
+  pen->draw_track(pen, cr);
+  cairo_surface_flush(canvas);
+  release = g_timer_elapsed(timer, NULL) * 1000;
+
+  g_array_sort(motion_ms, compare_double);
+  ms = g_array_index(motion_ms, gdouble, motion_ms->len / 2);
+  g_snprintf(size, sizeof(size), "%dx%d", width, height);
+  printf("%-8s %-10s %10.2f %10.2f %10.2f %12.2f\n", name, size
+            , g_array_index(motion_ms, gdouble, 0), ms
+            , g_array_index(motion_ms, gdouble, motion_ms->len - 1)
+            , release);
+
+  g_timer_destroy(timer);
+  g_array_free(motion_ms, TRUE);
+  gtk_shot_pen_free(pen);
+  cairo_destroy(cr);
+  cairo_surface_destroy(canvas);
+  g_object_unref(source);
+
+  return ms <= BUDGET;
+}
+
+/** 打码画笔的原始截图,内容需有足够的细节 */
+GdkPixbuf* create_source(gint width, gint height) {
+  GdkPixbuf *pixbuf = gdk_pixbuf_new(GDK_COLORSPACE_RGB, FALSE, 8
+                                        , width, height);
+  gint rowstride = gdk_pixbuf_get_rowstride(pixbuf);
+  guchar *pixels = gdk_pixbuf_get_pixels(pixbuf);
+  gint x = 0, y = 0;
+
+  for (y = 0; y < height; y++) {
+    guchar *p = pixels + y * rowstride;
+    for (x = 0; x < width; x++, p += 3) {
+      p[0] = x & 0xff;
+      p[1] = y & 0xff;
+      p[2] = (x ^ y) & 0xff;
+    }
+  }
+
+  return pixbuf;
+}
+
+gint compare_double(gconstpointer a, gconstpointer b) {
+  gdouble x = *(const gdouble*) a, y = *(const gdouble*) b;
+  return x < y ? -1 : x > y;
+}
@@ -0,0 +1,194 @@
+/*
+ * GtkShot - A screen capture programme using GtkLib
+ * Copyright (C) 2012 flytreeleft @ CrazyDan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * 对比被遮挡窗口的两种截取方式的延时:
+ *  - composite: 通过XComposite直接读取窗口的离屏图像
+ *    (没有混成管理器时包括临时重定向窗口并等待其重绘的时间),
+ *    并统计未能取得离屏图像而改为提升窗口的次数;
+ *  - raise: 提升窗口,等待本进程处理完事件后截取屏幕,再恢复遮挡;
+ * 被截取的窗口由子进程创建并运行其主循环,与截取外部窗口时一致,
+ * 否则截取期间无人重绘该窗口.
+ * 用法: bench-window-capture [ITERATIONS]
+ */
+
+#include <config.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <signal.h>
+#include <sys/wait.h>
+
+#include <gtk/gtk.h>
+#include <gdk/gdkx.h>
+
+#include "utils.h"
+#include "capture.h"
+
+#define WINDOW_WIDTH 800
+#define WINDOW_HEIGHT 600
+
+static pid_t run_target(int argc, char *argv[], GdkNativeWindow *xid);
+static gboolean on_target_expose(GtkWidget *widget
+                                    , GdkEventExpose *event);
+static GtkWidget* create_window(gboolean target);
+static void flush_events();
+
+static int notify = -1; // 子进程首次绘制后通过该管道报告窗口ID
+
+int main(int argc, char *argv[]) {
+  gint iterations = argc > 1 ? atoi(argv[1]) : 50;
+  gint i = 0;
+  GdkNativeWindow xid = 0;
+  // 需在建立X连接前创建子进程
+  pid_t child = run_target(argc, argv, &xid);
+
+  if (child < 0) {
+    fprintf(stderr, "failed to start the target window\n");
+    return 1;
+  }
+  gtk_init(&argc, &argv);
+
+  GtkWidget *cover = create_window(FALSE);
+  GdkDisplay *display = gtk_widget_get_display(cover);
+  GdkRectangle bounds;
+  GdkPixbuf *pixbuf = NULL;
+  GTimer *timer = g_timer_new();
+  gdouble composite = 0, raise = 0;
+  guint fallbacks = 0;
+
+  flush_events();
+  // 预热: 首次截取时需查询XComposite扩展
+  pixbuf = gtk_shot_capture_window(display, xid, &bounds);
+  if (pixbuf) g_object_unref(pixbuf);
+  gdk_window_raise(cover->window);
+  flush_events();
+  fallbacks = gtk_shot_capture_get_fallbacks();
+
+  for (i = 0; i < iterations; i++) {
+    g_timer_start(timer);
+    pixbuf = gtk_shot_capture_window(display, xid, &bounds);
+    composite += g_timer_elapsed(timer, NULL);
+    if (pixbuf) g_object_unref(pixbuf);
+
+    g_timer_start(timer);
+    pixbuf = gtk_shot_capture_window_by_raise(display, xid, &bounds);
+    raise += g_timer_elapsed(timer, NULL);
+    if (pixbuf) g_object_unref(pixbuf);
+
+    // 恢复遮挡
+    gdk_window_raise(cover->window);
+    flush_events();
+  }
+
+  printf("window %dx%d, %d iteration(s)\n"
+            , WINDOW_WIDTH, WINDOW_HEIGHT, iterations);
+  printf("composite: %8.3f ms/capture (fell back to raise %u/%d)\n"
+            , composite * 1000 / iterations
+            , gtk_shot_capture_get_fallbacks() - fallbacks, iterations);
+  printf("raise:     %8.3f ms/capture\n", raise * 1000 / iterations);
+
+  g_timer_destroy(timer);
+  gtk_widget_destroy(cover);
+  kill(child, SIGTERM);
+  waitpid(child, NULL, 0);
+
+  return 0;
+}
+
+/**
+ * 在子进程中创建被截取的窗口并运行主循环
+ * @param xid 返回子进程中窗口的ID
+ * @return 子进程的ID,失败时返回-1
+ */
+pid_t run_target(int argc, char *argv[], GdkNativeWindow *xid) {
+  int fds[2];
+  pid_t pid = 0;
+
+  if (pipe(fds) < 0) return -1;
+
+  pid = fork();
+  if (pid == 0) {
+    close(fds[0]);
+    notify = fds[1];
+    gtk_init(&argc, &argv);
+    create_window(TRUE);
+    gtk_main();
+    _exit(0);
+  }
+  close(fds[1]);
+  if (pid > 0 && read(fds[0], xid, sizeof(*xid)) != sizeof(*xid)) {
+    kill(pid, SIGTERM);
+    waitpid(pid, NULL, 0);
+    pid = -1;
+  }
+  close(fds[0]);
+
+  return pid;
+}
+
+/** 被截取窗口的内容需足够复杂,以体现重绘的开销 */
+gboolean on_target_expose(GtkWidget *widget, GdkEventExpose *event) {
+  cairo_t *cr = gdk_cairo_create(widget->window);
+  gint x = 0, y = 0;
+
+  for (y = 0; y < WINDOW_HEIGHT; y += 8) {
+    for (x = 0; x < WINDOW_WIDTH; x += 8) {
+      SET_CAIRO_RGB(cr, RGB(x & 0xff, y & 0xff, (x ^ y) & 0xff));
+      cairo_rectangle(cr, x, y, 8, 8);
+      cairo_fill(cr);
+    }
+  }
+  cairo_destroy(cr);
+
+  if (notify >= 0) {
+    GdkNativeWindow xid = GDK_WINDOW_XID(widget->window);
+
+    if (write(notify, &xid, sizeof(xid)) != sizeof(xid)) {
+      _exit(1);
+    }
+    close(notify);
+    notify = -1;
+  }
+
+  return TRUE;
+}
+
+GtkWidget* create_window(gboolean target) {
+  GtkWidget *window = gtk_window_new(GTK_WINDOW_TOPLEVEL);
+
+  gtk_window_set_decorated(GTK_WINDOW(window), FALSE);
+  gtk_window_set_default_size(GTK_WINDOW(window)
+                                , WINDOW_WIDTH, WINDOW_HEIGHT);
+  gtk_window_move(GTK_WINDOW(window), 0, 0);
+  gtk_widget_set_app_paintable(window, TRUE);
+  if (target) {
+    g_signal_connect(window, "expose-event"
+                        , G_CALLBACK(on_target_expose), NULL);
+  }
+  gtk_widget_show(window);
+
+  return window;
+}
+
+void flush_events() {
+  gdk_flush();
+  while (gtk_events_pending()) {
+    gtk_main_iteration();
+  }
+}
@@ -0,0 +1,46 @@
+/*
+ * GtkShot - A screen capture programme using GtkLib
+ * Copyright (C) 2012 flytreeleft @ CrazyDan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _GTK_SHOT_CAPTURE_H_
+#define _GTK_SHOT_CAPTURE_H_
+
+#include <gtk/gtk.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* The milliseconds to wait for a temporarily redirected window to repaint */
+#define GTK_SHOT_CAPTURE_TIMEOUT 200
+/* The milliseconds without damage after which the repaint is complete */
+#define GTK_SHOT_CAPTURE_SETTLE 16
+
+GdkNativeWindow gtk_shot_capture_get_toplevel(GdkDisplay *display
+                                                  , GdkNativeWindow xid);
+GdkPixbuf* gtk_shot_capture_window(GdkDisplay *display
+                                      , GdkNativeWindow xid
+                                      , GdkRectangle *bounds);
+GdkPixbuf* gtk_shot_capture_window_by_raise(GdkDisplay *display
+                                              , GdkNativeWindow xid
+                                              , GdkRectangle *bounds);
+guint gtk_shot_capture_get_fallbacks();
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
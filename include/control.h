@@ -0,0 +1,69 @@
+/*
+ * GtkShot - A screen capture programme using GtkLib
+ * Copyright (C) 2012 flytreeleft @ CrazyDan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _GTK_SHOT_CONTROL_H_
+#define _GTK_SHOT_CONTROL_H_
+
+#include <gtk/gtk.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* The max length of a command line */
+#define GTK_SHOT_CONTROL_LINE 256
+/* The milliseconds the client waits for the reply */
+#define GTK_SHOT_CONTROL_TIMEOUT 2000
+/* The file name of the socket in the private directory */
+#define GTK_SHOT_CONTROL_SOCKET "gtkshot.sock"
+
+typedef struct _GtkShotControl GtkShotControl;
+
+/** 处理一条命令(不含换行),返回的应答由控制端口释放 */
+typedef gchar* (*GtkShotControlFunc) (const gchar *command
+                                        , gpointer data);
+
+#define GTK_SHOT_CONTROL(obj) ((GtkShotControl*) obj)
+
+/**
+ * 控制端口: 常驻进程监听的UNIX套接字,
+ * 位于当前用户私有(0700)的目录中且仅当前用户可访问.
+ * 每个连接发送一行命令,进程在主循环中处理后写回应答并关闭连接,
+ * 信号无法携带文本时(如查询内存统计)通过其交互
+ */
+struct _GtkShotControl {
+  gchar *path; // 套接字文件
+  GIOChannel *channel; // 监听的套接字
+  guint source;
+  GtkShotControlFunc func;
+  gpointer data;
+};
+
+GtkShotControl* gtk_shot_control_new(const gchar *path
+                                        , GtkShotControlFunc func
+                                        , gpointer data
+                                        , GError **error);
+void gtk_shot_control_destroy(GtkShotControl *control);
+gchar* gtk_shot_control_get_default_path();
+gchar* gtk_shot_control_send(const gchar *path, const gchar *command
+                                , GError **error);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
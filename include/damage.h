@@ -0,0 +1,61 @@
+/*
+ * GtkShot - A screen capture programme using GtkLib
+ * Copyright (C) 2012 flytreeleft @ CrazyDan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _GTK_SHOT_DAMAGE_H_
+#define _GTK_SHOT_DAMAGE_H_
+
+#include <gtk/gtk.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct _GtkShotDamage GtkShotDamage;
+typedef void (*GtkShotDamageFunc) (GdkRectangle *rect, gpointer data);
+
+#define GTK_SHOT_DAMAGE(obj) ((GtkShotDamage*) obj)
+
+/**
+ * 通过XDamage监听根窗口上的屏幕更新,
+ * 每个被更新的矩形区域均通过func回调
+ */
+struct _GtkShotDamage {
+  GdkWindow *root;
+  gulong damage; // Damage
+  gulong region; // XserverRegion, 用于取出已更新的区域
+  gint event_base;
+  gboolean supported; // X服务器是否支持XDamage和XFixes
+  gboolean active;
+
+  GtkShotDamageFunc func;
+  gpointer data;
+};
+
+GtkShotDamage* gtk_shot_damage_new(GdkWindow *root
+                                      , GtkShotDamageFunc func
+                                      , gpointer data);
+void gtk_shot_damage_destroy(GtkShotDamage *damage);
+gboolean gtk_shot_damage_start(GtkShotDamage *damage);
+void gtk_shot_damage_stop(GtkShotDamage *damage);
+#define gtk_shot_damage_active(damage) \
+        ((damage) && (damage)->active)
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -18,14 +18,17 @@
 #ifndef _GTK_SHOT_DEBUG_H_
 #define _GTK_SHOT_DEBUG_H_
 
-#ifdef GTK_SHOT_DEBUG
-# define debug(fmt, args...) \
-            printf("%s[%d]: "fmt, \
-                    __func__, __LINE__, ##args)
+#include "trace.h"
+
+/**
+ * 调试消息记录到追踪缓冲区(见trace.h),不做标准输出,
+ * 追踪级别低于GTK_SHOT_TRACE_DEBUG时不编译.
+ * 错误和面向用户的报告应使用g_printerr/g_print
+ */
+#if GTK_SHOT_TRACE_LEVEL >= GTK_SHOT_TRACE_DEBUG
+# define debug(fmt, args...) trace_message(__func__, fmt, ##args)
 #else
-# define debug(fmt, args...) \
-        printf(GTK_SHOT_NAME"-"GTK_SHOT_VERSION": "fmt \
-                  , ##args)
+# define debug(fmt, args...) do {} while (0)
 #endif
 
 #endif
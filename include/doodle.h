@@ -0,0 +1,68 @@
+/*
+ * GtkShot - A screen capture programme using GtkLib
+ * Copyright (C) 2012 flytreeleft @ CrazyDan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _GTK_SHOT_DOODLE_H_
+#define _GTK_SHOT_DOODLE_H_
+
+#include <gtk/gtk.h>
+
+#include "pen.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct _GtkShotDoodle GtkShotDoodle;
+typedef struct _GtkShotDoodleStats GtkShotDoodleStats;
+
+#define GTK_SHOT_DOODLE(obj) ((GtkShotDoodle*) obj)
+
+/** 最近一次绘制的统计信息 */
+struct _GtkShotDoodleStats {
+  guint pens; // 绘制的画笔数
+  guint batches; // 绘制的批次数(不含重绘区域外的批次)
+  guint calls; // 调用cairo的次数
+  guint state_changes; // 修改线宽/颜色的次数
+  guint draws; // 描边/填充的次数(含单独绘制的画笔)
+};
+
+/**
+ * 已提交画笔(涂鸦)的批量绘制:
+ * 按样式(描边/填充,线宽,颜色)将画笔分组,
+ * 同组画笔的缓存路径合并为一次描边或填充.
+ * 画笔仅在不与中间的批次重叠时才并入之前的批次,
+ * 故重叠部分的层叠顺序保持不变
+ */
+struct _GtkShotDoodle {
+  GPtrArray *batches;
+  gboolean dirty; // 画笔变化,需重新分组
+  guint rebuilds; // 重新分组的累计次数
+  GtkShotDoodleStats stats;
+};
+
+GtkShotDoodle* gtk_shot_doodle_new();
+void gtk_shot_doodle_destroy(GtkShotDoodle *doodle);
+void gtk_shot_doodle_invalidate(GtkShotDoodle *doodle);
+void gtk_shot_doodle_draw(GtkShotDoodle *doodle, GSList *pens
+                            , cairo_t *cr);
+gsize gtk_shot_doodle_get_memory(GtkShotDoodle *doodle);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
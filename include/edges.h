@@ -0,0 +1,71 @@
+/*
+ * GtkShot - A screen capture programme using GtkLib
+ * Copyright (C) 2012 flytreeleft @ CrazyDan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _GTK_SHOT_EDGES_H_
+#define _GTK_SHOT_EDGES_H_
+
+#include <gtk/gtk.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* The minimal luminance difference between adjacent pixels of an edge */
+#define GTK_SHOT_EDGES_THRESHOLD 40
+/* The minimal length (in pixels) of an edge run */
+#define GTK_SHOT_EDGES_MIN_RUN 16
+/* The distance (in pixels) within which a section edge snaps */
+#define GTK_SHOT_SNAP_DISTANCE 8
+
+typedef struct _GtkShotEdges GtkShotEdges;
+typedef struct _GtkShotEdgesJob GtkShotEdgesJob;
+
+#define GTK_SHOT_EDGES(obj) ((GtkShotEdges*) obj)
+
+/**
+ * 截图的边缘索引:
+ * 后台线程逐行计算相邻像素的亮度差,
+ * 将连续的强边缘按行(水平边缘)和列(垂直边缘)记录为线段,
+ * 并按所在的行/列排序,查找时二分定位.
+ * 重建或清空时不等待未完成的计算,仅将其标记为已取代,
+ * 其结果由后台线程自行丢弃
+ */
+struct _GtkShotEdges {
+  GMutex *mutex; // 保护job, index和running
+  GCond *cond; // 后台线程结束时通知
+  GtkShotEdgesJob *job; // 正在计算的任务
+  GtkShotEdgesJob *index; // 已完成的边缘索引
+  gint running; // 尚未结束的后台线程数(含已取代的)
+  volatile gint ready; // 边缘索引是否可用
+};
+
+GtkShotEdges* gtk_shot_edges_new();
+void gtk_shot_edges_destroy(GtkShotEdges *edges);
+void gtk_shot_edges_build(GtkShotEdges *edges, GdkPixbuf *pixbuf
+                            , gint x, gint y);
+void gtk_shot_edges_clear(GtkShotEdges *edges);
+void gtk_shot_edges_wait(GtkShotEdges *edges);
+gboolean gtk_shot_edges_snap_x(GtkShotEdges *edges, gint x
+                                , gint y0, gint y1, gint *snapped);
+gboolean gtk_shot_edges_snap_y(GtkShotEdges *edges, gint y
+                                , gint x0, gint x1, gint *snapped);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,61 @@
+/*
+ * GtkShot - A screen capture programme using GtkLib
+ * Copyright (C) 2012 flytreeleft @ CrazyDan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _GTK_SHOT_HOTKEY_H_
+#define _GTK_SHOT_HOTKEY_H_
+
+#include <gtk/gtk.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct _GtkShotHotkeys GtkShotHotkeys;
+
+/** 热键被按下,id为绑定时指定的标识 */
+typedef void (*GtkShotHotkeyFunc) (guint id, gpointer data);
+
+#define GTK_SHOT_HOTKEYS(obj) ((GtkShotHotkeys*) obj)
+
+/**
+ * 全局热键: 通过XGrabKey在根窗口上捕获按键,
+ * 常驻进程直接响应,无需启动新进程再通知.
+ * 绑定时忽略CapsLock和NumLock的状态
+ */
+struct _GtkShotHotkeys {
+  GdkWindow *root;
+  GArray *keys; // 已绑定的热键
+  GtkShotHotkeyFunc func;
+  gpointer data;
+  gint64 pressed; // 最近一次按下热键的时间(纳秒,见gtk_shot_trace_time)
+  guint num_lock; // NumLock对应的修饰键掩码(通常为Mod2Mask),未映射时为0
+};
+
+GtkShotHotkeys* gtk_shot_hotkeys_new(GdkWindow *root
+                                        , GtkShotHotkeyFunc func
+                                        , gpointer data);
+void gtk_shot_hotkeys_destroy(GtkShotHotkeys *hotkeys);
+gboolean gtk_shot_hotkeys_bind(GtkShotHotkeys *hotkeys, guint id
+                                  , const gchar *accelerator
+                                  , GError **error);
+void gtk_shot_hotkeys_unbind_all(GtkShotHotkeys *hotkeys);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
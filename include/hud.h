@@ -0,0 +1,79 @@
+/*
+ * GtkShot - A screen capture programme using GtkLib
+ * Copyright (C) 2012 flytreeleft @ CrazyDan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _GTK_SHOT_HUD_H_
+#define _GTK_SHOT_HUD_H_
+
+#include <gtk/gtk.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* The count of frames kept for the sparkline */
+#define GTK_SHOT_HUD_FRAMES 120
+/* The height of the sparkline */
+#define GTK_SHOT_HUD_SPARKLINE_HEIGHT 32
+/* The frame time budget (ms) marked on the sparkline */
+#define GTK_SHOT_HUD_FRAME_BUDGET (1000.0 / 60)
+/* The distance between the HUD and the corner of the window */
+#define GTK_SHOT_HUD_MARGIN 8
+/* The font of the HUD */
+#define GTK_SHOT_HUD_FONT "Monospace 9"
+/* The size of the text of the HUD */
+#define GTK_SHOT_HUD_TEXT_SIZE 512
+
+typedef struct _GtkShotHud GtkShotHud;
+
+#define GTK_SHOT_HUD(obj) ((GtkShotHud*) obj)
+
+/**
+ * 性能浮层(HUD):
+ * 始终记录截屏耗时、每帧(expose)的耗时及其间处理的事件数,
+ * 显示时绘制在窗口左下角.
+ * 帧耗时不含浮层自身的绘制,浮层显示的是上一帧的数值
+ */
+struct _GtkShotHud {
+  gboolean visible;
+  GTimer *timer;
+  gdouble capture_start, capture_ms; // 最近一次截屏的开始时间和耗时
+  gdouble frame_start; // 当前帧的开始时间
+  gdouble frames[GTK_SHOT_HUD_FRAMES]; // 最近各帧的耗时(ms),环形
+  guint frame_pos, frame_count;
+  guint events; // 当前帧之前收到的事件数
+  guint events_per_frame; // 最近一帧处理的事件数
+  GdkRectangle rect; // 上次绘制的范围(cr的坐标)
+  PangoLayout *layout; // 浮层文本(不使用共享的布局缓存)
+  gchar text[GTK_SHOT_HUD_TEXT_SIZE];
+};
+
+GtkShotHud* gtk_shot_hud_new();
+void gtk_shot_hud_destroy(GtkShotHud *hud);
+void gtk_shot_hud_toggle(GtkShotHud *hud);
+#define gtk_shot_hud_count_event(hud) ((hud)->events++)
+void gtk_shot_hud_begin_capture(GtkShotHud *hud);
+void gtk_shot_hud_end_capture(GtkShotHud *hud);
+void gtk_shot_hud_begin_frame(GtkShotHud *hud);
+void gtk_shot_hud_end_frame(GtkShotHud *hud);
+void gtk_shot_hud_draw(GtkShotHud *hud, cairo_t *cr
+                          , gint x, gint y, const gchar *extra);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,100 @@
+/*
+ * GtkShot - A screen capture programme using GtkLib
+ * Copyright (C) 2012 flytreeleft @ CrazyDan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _GTK_SHOT_JOURNAL_H_
+#define _GTK_SHOT_JOURNAL_H_
+
+#include <stdio.h>
+#include <gtk/gtk.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct _GtkShotJournal GtkShotJournal;
+typedef struct _GtkShotJournalEvent GtkShotJournalEvent;
+typedef void (*GtkShotJournalFunc) (GtkShotJournal *journal
+                                      , gpointer data);
+
+/* The magic at the beginning of event journal */
+#define GTK_SHOT_JOURNAL_MAGIC "GSEJ"
+/* The version of event journal format */
+#define GTK_SHOT_JOURNAL_VERSION 1
+/* The bytes of an event in journal */
+#define GTK_SHOT_JOURNAL_EVENT_SIZE 16
+
+#define GTK_SHOT_JOURNAL(obj) ((GtkShotJournal*) obj)
+
+/**
+ * 记录的事件(文件中按小端序存放,每个16字节):
+ * time(4) type(1) button(1) state(2) x(2) y(2) keyval(4)
+ */
+struct _GtkShotJournalEvent {
+  guint32 time; // 距第一个事件的毫秒数
+  guint8 type; // GdkEventType
+  guint8 button;
+  guint16 state; // GdkModifierType的低16位
+  gint16 x, y; // 鼠标的屏幕坐标
+  guint32 keyval;
+};
+
+/**
+ * 事件日志: 记录到达截图窗口的鼠标/按键事件,
+ * 并可将其按原有节奏或尽快地重新送入截图窗口,
+ * 以便在Xvfb等环境中准确重现操作过程
+ */
+struct _GtkShotJournal {
+  GtkWidget *widget;
+  gulong handler; // 记录时的事件监听
+
+  // 记录
+  FILE *file;
+  guint32 origin; // 第一个事件的时间
+  gboolean started;
+  guint recorded;
+
+  // 回放
+  GArray *events;
+  guint next; // 下一个待回放的事件
+  gboolean realtime; // 按原有节奏回放,否则尽快回放
+  guint source;
+  GTimer *timer;
+  GtkShotJournalFunc done;
+  gpointer data;
+};
+
+GtkShotJournal* gtk_shot_journal_new(GtkWidget *widget);
+void gtk_shot_journal_destroy(GtkShotJournal *journal);
+gboolean gtk_shot_journal_record(GtkShotJournal *journal
+                                    , const char *filename
+                                    , GError **error);
+void gtk_shot_journal_flush(GtkShotJournal *journal);
+gboolean gtk_shot_journal_play(GtkShotJournal *journal
+                                  , const char *filename
+                                  , gboolean realtime
+                                  , GtkShotJournalFunc done
+                                  , gpointer data
+                                  , GError **error);
+void gtk_shot_journal_send(GtkShotJournal *journal
+                              , GtkShotJournalEvent *e);
+void gtk_shot_journal_report(GtkShotJournal *journal);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,67 @@
+/*
+ * GtkShot - A screen capture programme using GtkLib
+ * Copyright (C) 2012 flytreeleft @ CrazyDan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _GTK_SHOT_LOUPE_H_
+#define _GTK_SHOT_LOUPE_H_
+
+#include <gtk/gtk.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* The radius (in screen pixels) of the magnified neighbourhood */
+#define GTK_SHOT_LOUPE_RADIUS 7
+/* The zoom factor of the loupe */
+#define GTK_SHOT_LOUPE_ZOOM 8
+/* The distance between the cursor and the loupe */
+#define GTK_SHOT_LOUPE_OFFSET 24
+/* The border width of the loupe */
+#define GTK_SHOT_LOUPE_BORDER 2
+
+#define GTK_SHOT_LOUPE_SIZE \
+          ((GTK_SHOT_LOUPE_RADIUS * 2 + 1) * GTK_SHOT_LOUPE_ZOOM)
+
+typedef struct _GtkShotLoupe GtkShotLoupe;
+
+#define GTK_SHOT_LOUPE(obj) ((GtkShotLoupe*) obj)
+
+/**
+ * 放大镜:
+ * 从截图中取鼠标附近的小块区域,按最近邻放大到固定大小的画布上,
+ * 绘制时直接贴图
+ */
+struct _GtkShotLoupe {
+  cairo_surface_t *surface; // 放大后的图像
+  GdkRectangle rect; // 放大镜的范围(屏幕坐标,含边框)
+  gboolean visible;
+};
+
+GtkShotLoupe* gtk_shot_loupe_new();
+void gtk_shot_loupe_destroy(GtkShotLoupe *loupe);
+void gtk_shot_loupe_update(GtkShotLoupe *loupe, GdkPixbuf *pixbuf
+                              , gint ox, gint oy
+                              , gint x, gint y
+                              , GdkRectangle *bounds);
+void gtk_shot_loupe_hide(GtkShotLoupe *loupe);
+void gtk_shot_loupe_draw(GtkShotLoupe *loupe, cairo_t *cr, gint color);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,62 @@
+/*
+ * GtkShot - A screen capture programme using GtkLib
+ * Copyright (C) 2012 flytreeleft @ CrazyDan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _GTK_SHOT_MEMORY_H_
+#define _GTK_SHOT_MEMORY_H_
+
+#include <glib.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum _GtkShotMemoryCategory GtkShotMemoryCategory;
+
+enum _GtkShotMemoryCategory {
+  GTK_SHOT_MEMORY_CAPTURE, // 截图及缓存池中闲置的截图,滚动截图的长图
+  GTK_SHOT_MEMORY_OVERLAY, // 遮罩层,缓存池中闲置的画布,放大镜
+  GTK_SHOT_MEMORY_DOODLE, // 涂鸦的批次
+  GTK_SHOT_MEMORY_PENS, // 画笔及其路径/轨迹/打码图像,画笔索引
+  GTK_SHOT_MEMORY_LAYOUTS, // 缓存的文本布局(估算)
+  GTK_SHOT_MEMORY_ENCODER, // 编码后的图像数据(释放缓存时压缩的截图)
+  GTK_SHOT_MEMORY_REPLAY, // 即时回放的画面
+  GTK_SHOT_MEMORY_CATEGORIES
+};
+
+typedef gsize (*GtkShotMemoryProbe) (gpointer data);
+
+/**
+ * 内存统计: 各模块为其占用的内存注册探针(返回当前字节数),
+ * 在内存可能变化处(截屏,提交画笔,编码,清理缓存等)采样,
+ * 并记录启动以来各类别的峰值.
+ * 仅在主线程中使用
+ */
+void gtk_shot_memory_add_probe(GtkShotMemoryCategory category
+                                  , GtkShotMemoryProbe probe
+                                  , gpointer data);
+void gtk_shot_memory_remove_probes(gpointer data);
+void gtk_shot_memory_sample();
+gsize gtk_shot_memory_get(GtkShotMemoryCategory category, gsize *peak);
+void gtk_shot_memory_note_release(gsize before, gsize after);
+gchar* gtk_shot_memory_report();
+gsize gtk_shot_memory_get_rss();
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,53 @@
+/*
+ * GtkShot - A screen capture programme using GtkLib
+ * Copyright (C) 2012 flytreeleft @ CrazyDan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _GTK_SHOT_OVERLAY_H_
+#define _GTK_SHOT_OVERLAY_H_
+
+#include <gtk/gtk.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* The corner radius of the message box */
+#define GTK_SHOT_OVERLAY_MESSAGE_RADIUS 8
+/* The background color of the message box */
+#define GTK_SHOT_OVERLAY_MESSAGE_COLOR 0x232126
+
+/**
+ * 截图窗口的覆盖层绘制,仅依赖cairo_t及显式传入的几何参数,
+ * 可在图像表面上离屏绘制(如基准测试)
+ */
+void gtk_shot_overlay_draw_mask(cairo_t *cr, const GdkRectangle *screen
+                                  , const GdkRectangle *hole
+                                  , gint color, gdouble alpha);
+void gtk_shot_overlay_draw_border(cairo_t *cr, const GdkRectangle *rect
+                                    , gint border, gint color);
+void gtk_shot_overlay_draw_anchors(cairo_t *cr, const GdkPoint anchor[8]
+                                    , gint size, gint color);
+void gtk_shot_overlay_draw_message(cairo_t *cr, PangoLayout *layout
+                                    , const GdkRectangle *screen
+                                    , const GdkRectangle *section
+                                    , gint border, gint margin
+                                    , gdouble opacity, gboolean flip);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
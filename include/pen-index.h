@@ -0,0 +1,65 @@
+/*
+ * GtkShot - A screen capture programme using GtkLib
+ * Copyright (C) 2012 flytreeleft @ CrazyDan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _GTK_SHOT_PEN_INDEX_H_
+#define _GTK_SHOT_PEN_INDEX_H_
+
+#include <gtk/gtk.h>
+
+#include "pen.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct _GtkShotPenIndex GtkShotPenIndex;
+
+/* The size of grid cell of pen index */
+#define GTK_SHOT_PEN_INDEX_CELL 64
+/* The distance to pen within which it can be picked */
+#define GTK_SHOT_PEN_INDEX_TOLERANCE 3
+
+#define GTK_SHOT_PEN_INDEX(obj) ((GtkShotPenIndex*) obj)
+
+/**
+ * 已提交画笔的空间索引(均匀网格):
+ * 画笔按其范围登记到所覆盖的各网格中,
+ * 拾取时仅检查鼠标所在网格中的画笔.
+ * 序号越大的画笔越靠上层
+ */
+struct _GtkShotPenIndex {
+  GHashTable *entries; // 画笔 -> 索引项
+  GHashTable *cells; // 网格坐标 -> 索引项链表
+  GSList *unbounded; // 范围未知的画笔,总是参与拾取
+  guint serial; // 下一个画笔的序号
+};
+
+GtkShotPenIndex* gtk_shot_pen_index_new();
+void gtk_shot_pen_index_destroy(GtkShotPenIndex *index);
+void gtk_shot_pen_index_insert(GtkShotPenIndex *index, GtkShotPen *pen);
+void gtk_shot_pen_index_remove(GtkShotPenIndex *index, GtkShotPen *pen);
+void gtk_shot_pen_index_update(GtkShotPenIndex *index, GtkShotPen *pen);
+void gtk_shot_pen_index_clear(GtkShotPenIndex *index);
+GtkShotPen* gtk_shot_pen_index_pick(GtkShotPenIndex *index
+                                      , gint x, gint y);
+gsize gtk_shot_pen_index_get_memory(GtkShotPenIndex *index);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -41,20 +41,39 @@ enum _GtkShotPenType{
   GTK_SHOT_PEN_ELLIPSE,
   GTK_SHOT_PEN_ARROW,
   GTK_SHOT_PEN_LINE,
-  GTK_SHOT_PEN_TEXT
+  GTK_SHOT_PEN_TEXT,
+  GTK_SHOT_PEN_MOSAIC,
+  GTK_SHOT_PEN_BLUR
 };
 
+#define gtk_shot_pen_is_redaction(pen) \
+          ((pen)->type == GTK_SHOT_PEN_MOSAIC \
+              || (pen)->type == GTK_SHOT_PEN_BLUR)
+
 struct _GtkShotPen {
   GtkShotPenType type;
   GdkPoint start, end;
   gint size, color;
   gboolean square; // 绘制正方形/圆形/直线
+  cairo_path_t *path; // 提交后缓存的描边路径
+  cairo_path_t *fill_path; // 提交后缓存的填充路径(箭头)
+  GdkRectangle bounds; // 提交后路径(含线宽)的范围(屏幕坐标)
   union {
     struct {
       gchar *fontname; // 注: 使用动态开辟的空间
       gchar *content;
+      PangoLayout *layout; // 缓存的文本布局,文本或字体变化时释放
     } text;
     GSList *tracks;
+    struct {
+      GdkPixbuf *source; // 原始截图(注: 持有引用)
+      gint x, y; // 原始截图原点的屏幕坐标
+      gboolean snapshot; // source是否为画笔私有的区域副本
+      cairo_surface_t *patch; // 打码后的区域图像
+      GdkRectangle rect; // patch的范围(屏幕坐标)
+      gint size; // 生成patch时的画笔大小
+      gint scale; // patch的缩小比例,绘制和拖动期间为预览的比例
+    } redact;
   };
   void (*save_track) (GtkShotPen *pen, gint x, gint y);
   void (*draw_track) (GtkShotPen *pen, cairo_t *cr);
@@ -80,6 +99,19 @@ void gtk_shot_pen_draw_ellipse(GtkShotPen *pen, cairo_t *cr);
 void gtk_shot_pen_draw_arrow(GtkShotPen *pen, cairo_t *cr);
 void gtk_shot_pen_draw_line(GtkShotPen *pen, cairo_t *cr);
 void gtk_shot_pen_draw_text(GtkShotPen *pen, cairo_t *cr);
+void gtk_shot_pen_compile(GtkShotPen *pen);
+void gtk_shot_pen_invalidate(GtkShotPen *pen);
+void gtk_shot_pen_translate(GtkShotPen *pen, gint dx, gint dy);
+void gtk_shot_pen_restyle(GtkShotPen *pen, GtkShotPen *style);
+gboolean gtk_shot_pen_hit(GtkShotPen *pen, gint x, gint y
+                            , gint tolerance);
+gsize gtk_shot_pen_get_memory(GtkShotPen *pen);
+void gtk_shot_pen_set_text(GtkShotPen *pen, gchar *text);
+void gtk_shot_pen_set_font(GtkShotPen *pen, const gchar *fontname);
+void gtk_shot_pen_set_source(GtkShotPen *pen, GdkPixbuf *source
+                                , gint x, gint y);
+void gtk_shot_pen_snapshot_source(GtkShotPen *pen);
+void gtk_shot_pen_draw_redaction(GtkShotPen *pen, cairo_t *cr);
 
 #ifdef __cplusplus
 }
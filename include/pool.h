@@ -0,0 +1,67 @@
+/*
+ * GtkShot - A screen capture programme using GtkLib
+ * Copyright (C) 2012 flytreeleft @ CrazyDan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _GTK_SHOT_POOL_H_
+#define _GTK_SHOT_POOL_H_
+
+#include <gtk/gtk.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct _GtkShotPool GtkShotPool;
+
+/* The seconds before an idle buffer is freed */
+#define GTK_SHOT_POOL_TRIM_TIMEOUT 30
+
+#define GTK_SHOT_POOL(obj) ((GtkShotPool*) obj)
+
+/**
+ * 以尺寸为键的截图/画布缓存池:
+ * 尺寸不变时直接复用已释放的缓存,
+ * 屏幕布局(RandR)变化时清空缓存,
+ * 闲置超过trim_timeout秒的缓存将被释放
+ */
+struct _GtkShotPool {
+  GdkScreen *screen;
+  GSList *pixbufs; // 闲置的截图
+  GSList *surfaces; // 闲置的ARGB32画布
+  guint trim_timeout; // 闲置缓存的保留时间(秒)
+  guint trim_source; // 清理定时器(单次),无闲置缓存时为0
+};
+
+GtkShotPool* gtk_shot_pool_new(GdkScreen *screen);
+void gtk_shot_pool_destroy(GtkShotPool *pool);
+GdkPixbuf* gtk_shot_pool_acquire_pixbuf(GtkShotPool *pool
+                                            , gint width, gint height);
+void gtk_shot_pool_release_pixbuf(GtkShotPool *pool
+                                      , GdkPixbuf *pixbuf);
+cairo_surface_t* gtk_shot_pool_acquire_surface(GtkShotPool *pool
+                                                  , gint width
+                                                  , gint height);
+void gtk_shot_pool_release_surface(GtkShotPool *pool
+                                      , cairo_surface_t *surface);
+void gtk_shot_pool_clean(GtkShotPool *pool);
+void gtk_shot_pool_get_memory(GtkShotPool *pool
+                                , gsize *pixbufs, gsize *surfaces);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
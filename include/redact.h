@@ -0,0 +1,54 @@
+/*
+ * GtkShot - A screen capture programme using GtkLib
+ * Copyright (C) 2012 flytreeleft @ CrazyDan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _GTK_SHOT_REDACT_H_
+#define _GTK_SHOT_REDACT_H_
+
+#include <gtk/gtk.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* The block size of the detail removed before blurring */
+#define GTK_SHOT_REDACT_BLUR_BLOCK 4
+/* The maximal box blur radius whose window sum fits in 16 bits */
+#define GTK_SHOT_REDACT_MAX_RADIUS 127
+/* The downscale factor of the live preview, the downscaling replaces
+   the blur's block removal */
+#define GTK_SHOT_REDACT_PREVIEW_SCALE GTK_SHOT_REDACT_BLUR_BLOCK
+
+/**
+ * 打码处理,均直接修改4字节像素(如CAIRO_FORMAT_ARGB32)的区域,
+ * 各通道独立计算,与像素的通道顺序无关
+ */
+void gtk_shot_redact_import(guchar *data, gint stride
+                              , const guchar *pixels, gint rowstride
+                              , gint n_channels, gint width, gint height
+                              , gint scale);
+void gtk_shot_redact_pixelate(guchar *data, gint width, gint height
+                                , gint stride, gint block);
+void gtk_shot_redact_blur(guchar *data, gint width, gint height
+                            , gint stride, gint radius);
+void gtk_shot_redact_box_blur(guchar *data, gint width, gint height
+                                , gint stride, gint radius);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
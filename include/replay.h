@@ -0,0 +1,77 @@
+/*
+ * GtkShot - A screen capture programme using GtkLib
+ * Copyright (C) 2012 flytreeleft @ CrazyDan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _GTK_SHOT_REPLAY_H_
+#define _GTK_SHOT_REPLAY_H_
+
+#include <gtk/gtk.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct _GtkShotReplay GtkShotReplay;
+
+/* The milliseconds between two samples */
+#define GTK_SHOT_REPLAY_INTERVAL 500
+/* The memory budget of frames in MiB */
+#define GTK_SHOT_REPLAY_BUDGET 64
+/* The width and height of tile */
+#define GTK_SHOT_REPLAY_TILE 64
+
+#define GTK_SHOT_REPLAY(obj) ((GtkShotReplay*) obj)
+
+/**
+ * 即时回放: 在后台按固定间隔截取整个屏幕,
+ * 保留最近seconds秒内的画面.
+ * 画面按图块保存,与上一帧相同的图块直接共享,
+ * 总内存不超过budget
+ */
+struct _GtkShotReplay {
+  GdkWindow *root;
+  gint seconds; // 保留的时长(秒)
+  guint interval; // 采样间隔(毫秒)
+  gsize budget; // 图块占用内存的上限(字节)
+
+  GQueue *frames; // 由旧到新排列的画面
+  GdkPixbuf *scratch; // 采样时使用的截图缓存
+  gsize bytes; // 图块占用的内存(字节)
+  guint source; // 采样定时器,未采样时为0
+
+  // 统计信息
+  GTimer *timer; // 采样总时长
+  gdouble busy; // 采样累计耗时(秒)
+  guint samples; // 采样次数
+};
+
+GtkShotReplay* gtk_shot_replay_new(GdkWindow *root, gint seconds
+                                      , gsize budget);
+void gtk_shot_replay_destroy(GtkShotReplay *replay);
+void gtk_shot_replay_start(GtkShotReplay *replay);
+void gtk_shot_replay_stop(GtkShotReplay *replay);
+GdkPixbuf* gtk_shot_replay_get_frame(GtkShotReplay *replay
+                                        , gint seconds_ago);
+gint gtk_shot_replay_export(GtkShotReplay *replay, const char *dir
+                                , GError **error);
+void gtk_shot_replay_report(GtkShotReplay *replay);
+gsize gtk_shot_replay_get_memory(GtkShotReplay *replay);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
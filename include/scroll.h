@@ -0,0 +1,65 @@
+/*
+ * GtkShot - A screen capture programme using GtkLib
+ * Copyright (C) 2012 flytreeleft @ CrazyDan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _GTK_SHOT_SCROLL_H_
+#define _GTK_SHOT_SCROLL_H_
+
+#include <gtk/gtk.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* The interval (in milliseconds) between two frames of scrolling capture */
+#define GTK_SHOT_SCROLL_INTERVAL 100
+/* The number of rows used to locate a frame in the previous one */
+#define GTK_SHOT_SCROLL_ANCHOR 16
+
+typedef struct _GtkShotScroll GtkShotScroll;
+
+#define GTK_SHOT_SCROLL(obj) ((GtkShotScroll*) obj)
+
+/**
+ * 滚动截图的拼接:
+ * 仅保存上一帧各行的哈希值,
+ * 通过滚动哈希在上一帧中定位新帧,仅将新出现的行追加到长图中.
+ * 选区顶部/底部固定不动的行(如标题栏,状态栏)在长图中只保留一份
+ */
+struct _GtkShotScroll {
+  gint width, height; // 帧的宽度和高度
+  gint n_channels;
+  gint rowstride; // 长图每行的字节数(无填充)
+  guchar *pixels; // 长图的像素数据
+  gint rows; // 长图已有的行数
+  gint capacity; // 长图已分配的行数
+  guint64 *hashes; // 上一帧各行的哈希值
+  guint64 *frame_hashes; // 新帧各行的哈希值
+  gboolean lost; // 滚动过快,新帧与上一帧没有重叠
+};
+
+GtkShotScroll* gtk_shot_scroll_new();
+void gtk_shot_scroll_destroy(GtkShotScroll *scroll);
+void gtk_shot_scroll_reset(GtkShotScroll *scroll);
+gint gtk_shot_scroll_append(GtkShotScroll *scroll, GdkPixbuf *frame);
+GdkPixbuf* gtk_shot_scroll_finish(GtkShotScroll *scroll);
+gsize gtk_shot_scroll_get_memory(GtkShotScroll *scroll);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -31,6 +31,15 @@ typedef struct _GtkShotSection GtkShotSection;
 typedef struct _GtkShot GtkShot;
 
 #include "pen.h"
+#include "pool.h"
+#include "damage.h"
+#include "window-tree.h"
+#include "edges.h"
+#include "scroll.h"
+#include "loupe.h"
+#include "doodle.h"
+#include "hud.h"
+#include "pen-index.h"
 #include "input.h"
 #include "toolbar.h"
 
@@ -44,6 +53,14 @@ typedef struct _GtkShot GtkShot;
 #define GTK_SHOT_SECTION_BORDER 2
 /* The color of selection of capture */
 #define GTK_SHOT_SECTION_COLOR 0x00ff00
+/* The gap between selected pen and its frame */
+#define GTK_SHOT_SELECTED_PEN_BORDER 3
+/* The dash length of frame of selected pen */
+#define GTK_SHOT_SELECTED_PEN_DASH 4.0
+/* The size of text buffer of message box */
+#define GTK_SHOT_MESSAGE_SIZE 128
+/* The seconds after hiding before the buffers are released */
+#define GTK_SHOT_IDLE_TIMEOUT 30
 /* The count of trying grab key */
 #define GRAB_KEY_TRY_COUNT 0
 
@@ -106,6 +123,12 @@ struct _GtkShot {
 
   GdkPixbuf *screen_pixbuf; // 整个屏幕的截图
   cairo_surface_t *mask_surface; // 遮罩层
+  cairo_t *mask_cr; // 遮罩层的cairo上下文(随遮罩层更换)
+  cairo_t *window_cr; // 窗口的cairo上下文(不使用GTK的双缓冲)
+  cairo_surface_t *buffer_surface; // 服务端的后备缓冲
+  cairo_t *buffer_cr; // 后备缓冲的cairo上下文
+  cairo_surface_t *screen_surface; // 上传到服务端的截图
+  GdkRectangle screen_dirty; // 截图中尚未上传的区域(窗口坐标)
 
   GtkShotMode mode;
   gboolean grab_key; // 是否捕获按键
@@ -117,14 +140,41 @@ struct _GtkShot {
   gint anchor_border; // 缩放锚点的宽度
 
   GtkShotSection section; // 选择区域
+  GdkRectangle last_section; // 上次保存的选区(屏幕坐标,含边框)
   GtkShotCursorPos cursor_pos; // 鼠标位置
   GdkCursorType edit_cursor; // 编辑模式下的鼠标样式
+  GdkCursorType cursor; // 当前的鼠标样式
+  GdkCursor *cursors[GDK_LAST_CURSOR]; // 预先创建的鼠标样式
+  gchar message[GTK_SHOT_MESSAGE_SIZE]; // 信息窗口的文本
+  PangoLayout *message_layout; // 信息窗口的文本布局(仅文本变化时重排)
   GdkPoint move_start, move_end; // 移动时的起点和终点
 
   GtkShotToolbar *toolbar; // 工具条
   GtkShotPen *pen; // 当前使用的画笔
   GSList *historic_pen; // 历史画笔
+  guint historic_count; // 历史画笔数,增删画笔时累计
+  gsize historic_memory; // 历史画笔占用的内存,增删画笔时累计
   GtkShotInput *input; // 文本输入窗口
+  GtkShotPool *pool; // 截图/画布缓存池
+  GtkShotDamage *damage; // 动态截图时监听屏幕更新
+  GdkRectangle live_area; // 动态截图时窗口镂空的区域(屏幕坐标)
+  GtkShotWindowTree *windows; // 顶层窗口的几何信息
+  GdkRectangle hover; // 无选区时鼠标下的窗口范围(屏幕坐标)
+  GtkShotEdges *edges; // 截图的边缘索引(选区吸附)
+  GtkShotScroll *scroll; // 滚动截图时拼接的长图
+  guint scroll_timer; // 滚动截图的定时器
+  GtkShotLoupe *loupe; // 鼠标旁的放大镜
+  GtkShotDoodle *doodle; // 历史画笔的批量绘制
+  GtkShotPenIndex *pens; // 历史画笔的空间索引
+  GtkShotPen *selected; // 选中的历史画笔
+  gint selected_pos; // 拖动前选中画笔在历史画笔中的位置
+  gboolean dragging; // 是否正在拖动选中的画笔
+  GtkShotHud *hud; // 性能浮层
+  guint idle_timeout; // 隐藏后释放缓存的延时(秒),为0时不释放
+  gboolean idle_compress; // 释放时保留压缩(PNG)后的截图
+  guint idle_source; // 释放缓存的定时器
+  gchar *idle_capture; // 压缩后的截图,未保留时为NULL
+  gsize idle_capture_size;
 
   // FUNCTION
   void (*dblclick)();
@@ -136,14 +186,20 @@ void gtk_shot_destroy(GtkShot *shot);
 
 void gtk_shot_hide(GtkShot *shot);
 void gtk_shot_show(GtkShot *shot, gboolean clean);
+void gtk_shot_show_pixbuf(GtkShot *shot, GdkPixbuf *pixbuf);
+void gtk_shot_show_window(GtkShot *shot, GdkNativeWindow xid);
+void gtk_shot_show_last_section(GtkShot *shot);
 void gtk_shot_quit(GtkShot *shot);
+void gtk_shot_set_idle_policy(GtkShot *shot, guint timeout
+                                , gboolean compress);
+void gtk_shot_release(GtkShot *shot);
 #define gtk_shot_visible(shot) \
         gtk_widget_get_visible(GTK_WIDGET(shot))
 
 void gtk_shot_hide_toolbar(GtkShot *shot);
 void gtk_shot_show_toolbar(GtkShot *shot);
-#define gtk_shot_refresh(shot) \
-            gdk_window_invalidate_rect(GTK_WIDGET(shot)->window, NULL, FALSE)
+void gtk_shot_invalidate(GtkShot *shot, GdkRectangle *rect);
+#define gtk_shot_refresh(shot) gtk_shot_invalidate(shot, NULL)
 gboolean gtk_shot_has_visible_section(GtkShot *shot);
 void gtk_shot_get_section(GtkShot *shot
                               , gint *x0, gint *y0
@@ -151,7 +207,12 @@ void gtk_shot_get_section(GtkShot *shot
 GdkPixbuf* gtk_shot_get_section_pixbuf(GtkShot *shot);
 void gtk_shot_save_section_to_clipboard(GtkShot *shot);
 void gtk_shot_save_section_to_file(GtkShot *shot);
+void gtk_shot_save_screen_to_clipboard(GtkShot *shot);
 void gtk_shot_record(GtkShot *shot);
+void gtk_shot_set_dynamic(GtkShot *shot, gboolean dynamic);
+void gtk_shot_start_scroll(GtkShot *shot);
+GdkPixbuf* gtk_shot_stop_scroll(GtkShot *shot);
+#define gtk_shot_scrolling(shot) ((shot)->scroll_timer != 0)
 
 void gtk_shot_set_pen(GtkShot *shot, GtkShotPen *pen);
 void gtk_shot_save_pen(GtkShot *shot);
@@ -0,0 +1,98 @@
+/*
+ * GtkShot - A screen capture programme using GtkLib
+ * Copyright (C) 2012 flytreeleft @ CrazyDan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _GTK_SHOT_TRACE_H_
+#define _GTK_SHOT_TRACE_H_
+
+#include <glib.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* The trace levels, points above GTK_SHOT_TRACE_LEVEL are not compiled */
+#define GTK_SHOT_TRACE_NONE 0
+#define GTK_SHOT_TRACE_SPAN 1
+#define GTK_SHOT_TRACE_DEBUG 2
+
+#ifndef GTK_SHOT_TRACE_LEVEL
+# ifdef GTK_SHOT_DEBUG
+#  define GTK_SHOT_TRACE_LEVEL GTK_SHOT_TRACE_DEBUG
+# else
+#  define GTK_SHOT_TRACE_LEVEL GTK_SHOT_TRACE_SPAN
+# endif
+#endif
+
+/* The count of events kept by each thread (power of 2) */
+#define GTK_SHOT_TRACE_EVENTS 8192
+/* The maximum count of traced threads */
+#define GTK_SHOT_TRACE_THREADS 16
+/* The size of the text of a debug message */
+#define GTK_SHOT_TRACE_TEXT_SIZE 40
+/* The maximum depth of nested spans kept by each thread */
+#define GTK_SHOT_TRACE_DEPTH 16
+
+typedef struct _GtkShotTraceEvent GtkShotTraceEvent;
+
+/** 记录的事件(64字节),名称须为静态字符串,仅保存其指针 */
+struct _GtkShotTraceEvent {
+  gint64 time; // 单调时钟(纳秒)
+  const gchar *name;
+  gchar phase; // 'B': 开始, 'E': 结束, 'i': 消息
+  gchar text[GTK_SHOT_TRACE_TEXT_SIZE]; // 消息的文本(截断)
+};
+
+/**
+ * 追踪: 每个线程将带时间戳的事件写入自己的环形缓冲区,
+ * 记录时无锁且不分配内存,缓冲区满后覆盖最早的事件.
+ * 可随时导出为Chrome trace viewer/Perfetto可加载的JSON
+ */
+#define trace_begin_at(level, name) \
+          do { \
+            if ((level) <= GTK_SHOT_TRACE_LEVEL) \
+              gtk_shot_trace_record('B', (name)); \
+          } while (0)
+#define trace_end_at(level, name) \
+          do { \
+            if ((level) <= GTK_SHOT_TRACE_LEVEL) \
+              gtk_shot_trace_record('E', (name)); \
+          } while (0)
+#define trace_message_at(level, name, fmt, args...) \
+          do { \
+            if ((level) <= GTK_SHOT_TRACE_LEVEL) \
+              gtk_shot_trace_message((name), fmt, ##args); \
+          } while (0)
+/** 截屏/重绘/编码/保存等耗时操作的区间 */
+#define trace_begin(name) trace_begin_at(GTK_SHOT_TRACE_SPAN, name)
+#define trace_end(name) trace_end_at(GTK_SHOT_TRACE_SPAN, name)
+/** 调试消息(截断),debug()即记录为此类消息 */
+#define trace_message(name, fmt, args...) \
+          trace_message_at(GTK_SHOT_TRACE_DEBUG, name, fmt, ##args)
+
+void gtk_shot_trace_set_thread_name(const gchar *name);
+void gtk_shot_trace_record(gchar phase, const gchar *name);
+void gtk_shot_trace_message(const gchar *name, const gchar *fmt, ...)
+                              G_GNUC_PRINTF(2, 3);
+gboolean gtk_shot_trace_dump(const gchar *filename, GError **error);
+const gchar* gtk_shot_trace_get_span(const gchar *thread);
+gint64 gtk_shot_trace_time();
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -83,6 +83,16 @@ GtkToggleButton*
                                       , GtkToggleButton *btn);
 PangoLayout* pango_cairo_prepare_layout(cairo_t *cr, char *text
                                                     , char *fontname);
+/* The count of overlay text layouts kept by pango_cairo_get_cached_layout */
+#define TEXT_LAYOUT_CACHE_SIZE 16
+PangoLayout* pango_cairo_get_cached_layout(cairo_t *cr, const char *text
+                                              , const char *fontname);
+void pango_cairo_clear_layout_cache();
+/* The estimated bytes of a PangoLayout without its text */
+#define TEXT_LAYOUT_BASE_SIZE 512
+/* The estimated bytes of each character (glyph, attributes) in a layout */
+#define TEXT_LAYOUT_CHAR_SIZE 32
+gsize pango_cairo_get_layout_cache_memory();
 void cairo_draw_text(cairo_t *cr, char *text, char *fontname);
 void cairo_round_rect(cairo_t *cr, double x, double y
                                   , double width, double height
@@ -103,6 +113,12 @@ void cairo_round_msg_box(cairo_t *cr, char *text
             GTK_BUTTON(btn)->depressed = (act); \
             GTK_TOGGLE_BUTTON(btn)->active = (act); \
           } while(0)
+#ifdef GTK_SHOT_DEBUG
+/** 调试时统计主线程的堆分配次数 */
+gboolean gtk_shot_alloc_counter_install();
+gulong gtk_shot_alloc_count();
+void gtk_shot_alloc_exempt(gboolean exempt);
+#endif
 #define gdk_point_is_equal(p0, p1) \
           ((p0).x == (p1).x && (p0).y == (p1).y)
 #define gdk_point_assign(left, right) \
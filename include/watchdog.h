@@ -0,0 +1,81 @@
+/*
+ * GtkShot - A screen capture programme using GtkLib
+ * Copyright (C) 2012 flytreeleft @ CrazyDan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _GTK_SHOT_WATCHDOG_H_
+#define _GTK_SHOT_WATCHDOG_H_
+
+#include <gtk/gtk.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* The default stall threshold (ms) */
+#define GTK_SHOT_WATCHDOG_THRESHOLD 50
+/* The count of latency buckets, bucket i holds [2^(i-1), 2^i) ms */
+#define GTK_SHOT_WATCHDOG_BUCKETS 12
+/* The count of recent stalls kept */
+#define GTK_SHOT_WATCHDOG_STALLS 32
+
+typedef struct _GtkShotWatchdog GtkShotWatchdog;
+typedef struct _GtkShotWatchdogStall GtkShotWatchdogStall;
+
+#define GTK_SHOT_WATCHDOG(obj) ((GtkShotWatchdog*) obj)
+
+struct _GtkShotWatchdogStall {
+  const gchar *operation; // 主线程所处的追踪区间,未知时为NULL
+  gdouble ms;
+};
+
+/**
+ * 主循环卡顿监测:
+ * 监测线程定时向主循环投递心跳(高优先级的idle),
+ * 心跳的响应延时超过阈值即为一次卡顿,
+ * 并记录卡顿期间主线程所处的追踪区间(见trace.h).
+ * 仅在运行期间(如截图窗口显示时)唤醒主循环
+ */
+struct _GtkShotWatchdog {
+  guint threshold; // 卡顿的阈值(ms)
+  GThread *thread;
+  GMutex *mutex;
+  GCond *cond;
+  gboolean running;
+  gboolean pending; // 心跳已投递,主循环尚未响应
+  guint source; // 尚未响应的心跳
+  gint64 posted; // 心跳投递的时间(纳秒)
+  gint64 answered; // 心跳响应的时间(纳秒)
+
+  // 统计(由mutex保护)
+  guint beats;
+  guint histogram[GTK_SHOT_WATCHDOG_BUCKETS]; // 心跳延时的分布
+  guint stalls;
+  GtkShotWatchdogStall recent[GTK_SHOT_WATCHDOG_STALLS]; // 环形
+  gdouble worst; // 最长的卡顿(ms)
+  const gchar *worst_operation;
+};
+
+GtkShotWatchdog* gtk_shot_watchdog_new(guint threshold);
+void gtk_shot_watchdog_destroy(GtkShotWatchdog *watchdog);
+void gtk_shot_watchdog_start(GtkShotWatchdog *watchdog);
+void gtk_shot_watchdog_stop(GtkShotWatchdog *watchdog);
+gchar* gtk_shot_watchdog_report(GtkShotWatchdog *watchdog);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,58 @@
+/*
+ * GtkShot - A screen capture programme using GtkLib
+ * Copyright (C) 2012 flytreeleft @ CrazyDan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _GTK_SHOT_WINDOW_TREE_H_
+#define _GTK_SHOT_WINDOW_TREE_H_
+
+#include <gtk/gtk.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct _GtkShotWindowTree GtkShotWindowTree;
+
+#define GTK_SHOT_WINDOW_TREE(obj) ((GtkShotWindowTree*) obj)
+
+/**
+ * 顶层窗口的几何信息缓存:
+ * 截图时一次性获取根窗口所有子窗口的范围,按层叠顺序平铺保存,
+ * 此后通过SubstructureNotify事件增量更新,
+ * 鼠标移动时的窗口查找无需访问X服务器
+ */
+struct _GtkShotWindowTree {
+  GdkWindow *root;
+  GArray *nodes; // 由底层到顶层排列(与XQueryTree的顺序一致)
+  GdkNativeWindow ignore; // 不参与查找的窗口(截图窗口自身)
+  gboolean active; // 是否在监听窗口变化
+};
+
+GtkShotWindowTree* gtk_shot_window_tree_new(GdkWindow *root);
+void gtk_shot_window_tree_destroy(GtkShotWindowTree *tree);
+void gtk_shot_window_tree_snapshot(GtkShotWindowTree *tree);
+void gtk_shot_window_tree_stop(GtkShotWindowTree *tree);
+void gtk_shot_window_tree_set_ignore(GtkShotWindowTree *tree
+                                        , GdkNativeWindow xid);
+gboolean gtk_shot_window_tree_lookup(GtkShotWindowTree *tree
+                                        , gint x, gint y
+                                        , GdkRectangle *rect);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
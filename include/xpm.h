@@ -27,6 +27,8 @@
 #include "images/rectangle.xpm"
 #include "images/arrow.xpm"
 #include "images/text.xpm"
+#include "images/mosaic.xpm"
+#include "images/blur.xpm"
 #include "images/small.xpm"
 #include "images/normal.xpm"
 #include "images/big.xpm"
@@ -0,0 +1,335 @@
+/*
+ * GtkShot - A screen capture programme using GtkLib
+ * Copyright (C) 2012 flytreeleft @ CrazyDan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <config.h>
+
+#include <gtk/gtk.h>
+#include <gdk/gdkx.h>
+#ifdef HAVE_XCOMPOSITE
+# include <X11/extensions/Xcomposite.h>
+#endif
+#ifdef HAVE_XDAMAGE
+# include <poll.h>
+# include <X11/extensions/Xdamage.h>
+#endif
+
+#include "utils.h"
+#include "trace.h"
+
+#include "capture.h"
+
+static gboolean get_window_bounds(Display *dpy, Window xid
+                                      , GdkRectangle *bounds
+                                      , XWindowAttributes *attr);
+static GdkPixbuf* grab_root(GdkDisplay *display
+                                , GdkRectangle *bounds);
+#ifdef HAVE_XCOMPOSITE
+static gboolean composite_supported(GdkDisplay *display);
+static gboolean has_compositor(GdkDisplay *display);
+static GdkPixbuf* grab_window_pixmap(GdkDisplay *display, Window xid
+                                        , XWindowAttributes *attr);
+static GdkPixbuf* grab_pixmap(GdkDisplay *display, Pixmap pixmap
+                                  , XWindowAttributes *attr);
+# ifdef HAVE_XDAMAGE
+static GdkPixbuf* grab_redirected(GdkDisplay *display, Window xid
+                                      , XWindowAttributes *attr);
+static gboolean wait_repaint(Display *dpy, Window xid, gint event_base);
+# endif
+#endif
+
+static guint fallbacks = 0; // 未能取得离屏图像而提升窗口截取的次数
+
+/** 获取窗口的顶层窗口(根窗口的子窗口,通常为窗口管理器的边框) */
+GdkNativeWindow gtk_shot_capture_get_toplevel(GdkDisplay *display
+                                                  , GdkNativeWindow xid) {
+  Display *dpy = GDK_DISPLAY_XDISPLAY(display);
+  Window root = None, parent = None, *children = NULL;
+  guint n = 0;
+
+  gdk_error_trap_push();
+  while (XQueryTree(dpy, xid, &root, &parent, &children, &n)) {
+    if (children) XFree(children);
+    if (parent == root || parent == None) break;
+    xid = parent;
+  }
+  gdk_error_trap_pop();
+
+  return xid;
+}
+
+/**
+ * 通过XComposite截取窗口的离屏图像,
+ * 被遮挡的窗口也无需提升和重绘.
+ * 没有混成管理器时仅临时重定向该窗口并等待其重绘,
+ * 无法取得离屏图像时提升窗口后截取屏幕
+ * @param bounds 返回窗口在屏幕上的范围
+ * @return 窗口的图像,窗口不可见时返回NULL
+ */
+GdkPixbuf* gtk_shot_capture_window(GdkDisplay *display
+                                      , GdkNativeWindow xid
+                                      , GdkRectangle *bounds) {
+  Display *dpy = GDK_DISPLAY_XDISPLAY(display);
+  XWindowAttributes attr;
+  GdkPixbuf *pixbuf = NULL;
+
+  xid = gtk_shot_capture_get_toplevel(display, xid);
+  if (!get_window_bounds(dpy, xid, bounds, &attr)) {
+    return NULL;
+  }
+#ifdef HAVE_XCOMPOSITE
+  if (composite_supported(display)) {
+    if (has_compositor(display)) {
+      pixbuf = grab_window_pixmap(display, xid, &attr);
+    }
+# ifdef HAVE_XDAMAGE
+    else {
+      pixbuf = grab_redirected(display, xid, &attr);
+    }
+# endif
+  }
+#endif
+  if (!pixbuf) {
+    fallbacks++;
+    pixbuf = gtk_shot_capture_window_by_raise(display, xid, bounds);
+  }
+  return pixbuf;
+}
+
+/** gtk_shot_capture_window改为提升窗口截取的次数 */
+guint gtk_shot_capture_get_fallbacks() {
+  return fallbacks;
+}
+
+/**
+ * 提升窗口并等待其重绘后截取屏幕,
+ * 为gtk_shot_capture_window的后备方式及对比基准
+ */
+GdkPixbuf* gtk_shot_capture_window_by_raise(GdkDisplay *display
+                                              , GdkNativeWindow xid
+                                              , GdkRectangle *bounds) {
+  Display *dpy = GDK_DISPLAY_XDISPLAY(display);
+  XWindowAttributes attr;
+
+  xid = gtk_shot_capture_get_toplevel(display, xid);
+  if (!get_window_bounds(dpy, xid, bounds, &attr)) {
+    return NULL;
+  }
+  XRaiseWindow(dpy, xid);
+  XSync(dpy, False);
+  // 等待所有窗口(包括本进程的窗口)处理完重绘
+  while (gtk_events_pending()) {
+    gtk_main_iteration();
+  }
+  gdk_window_process_all_updates();
+  XSync(dpy, False);
+
+  return grab_root(display, bounds);
+}
+
+gboolean get_window_bounds(Display *dpy, Window xid
+                              , GdkRectangle *bounds
+                              , XWindowAttributes *attr) {
+  Status succ = 0;
+
+  gdk_error_trap_push();
+  succ = XGetWindowAttributes(dpy, xid, attr);
+  if (gdk_error_trap_pop() != 0 || !succ
+        || attr->map_state != IsViewable) {
+    return FALSE;
+  }
+  // 顶层窗口的坐标即为屏幕坐标,边框位于坐标之外
+  bounds->x = attr->x;
+  bounds->y = attr->y;
+  bounds->width = attr->width + 2 * attr->border_width;
+  bounds->height = attr->height + 2 * attr->border_width;
+
+  return TRUE;
+}
+
+GdkPixbuf* grab_root(GdkDisplay *display, GdkRectangle *bounds) {
+  GdkScreen *screen = gdk_display_get_default_screen(display);
+  GdkRectangle area = {.x = 0, .y = 0
+                        , .width = gdk_screen_get_width(screen)
+                        , .height = gdk_screen_get_height(screen)};
+  GdkRectangle rect;
+
+  if (!gdk_rectangle_intersect(bounds, &area, &rect)) {
+    return NULL;
+  }
+  *bounds = rect;
+  return gdk_pixbuf_get_from_drawable(NULL
+                                        , gdk_screen_get_root_window(screen)
+                                        , NULL
+                                        , rect.x, rect.y, 0, 0
+                                        , rect.width, rect.height);
+}
+
+#ifdef HAVE_XCOMPOSITE
+/** NameWindowPixmap需XComposite 0.2及以上版本 */
+gboolean composite_supported(GdkDisplay *display) {
+  static gint supported = -1;
+  Display *dpy = GDK_DISPLAY_XDISPLAY(display);
+
+  if (supported >= 0) return supported;
+
+  gint event_base = 0, error_base = 0, major = 0, minor = 2;
+  supported = XCompositeQueryExtension(dpy, &event_base, &error_base)
+                && XCompositeQueryVersion(dpy, &major, &minor)
+                && (major > 0 || minor >= 2);
+#ifdef GTK_SHOT_DEBUG
+  debug("XComposite supported: %d\n", supported);
+#endif
+  return supported;
+}
+
+/**
+ * 混成管理器运行时所有顶层窗口均已被重定向.
+ * 混成管理器可能随时启停,故每次截取时都需检查
+ */
+gboolean has_compositor(GdkDisplay *display) {
+  Display *dpy = GDK_DISPLAY_XDISPLAY(display);
+  GdkScreen *screen = gdk_display_get_default_screen(display);
+  gchar *name = g_strdup_printf("_NET_WM_CM_S%d"
+                                  , gdk_screen_get_number(screen));
+  Atom cm = XInternAtom(dpy, name, False);
+
+  g_free(name);
+  return XGetSelectionOwner(dpy, cm) != None;
+}
+
+GdkPixbuf* grab_window_pixmap(GdkDisplay *display, Window xid
+                                 , XWindowAttributes *attr) {
+  Display *dpy = GDK_DISPLAY_XDISPLAY(display);
+  GdkPixbuf *pixbuf = NULL;
+  Pixmap pixmap = None;
+
+  gdk_error_trap_push();
+  pixmap = XCompositeNameWindowPixmap(dpy, xid);
+  XSync(dpy, False);
+  if (gdk_error_trap_pop() == 0 && pixmap != None) {
+    pixbuf = grab_pixmap(display, pixmap, attr);
+  }
+  if (pixmap != None) {
+    XFreePixmap(dpy, pixmap);
+  }
+  return pixbuf;
+}
+
+# ifdef HAVE_XDAMAGE
+/**
+ * 没有混成管理器时仅重定向目标窗口(由X服务器负责绘制到屏幕),
+ * 新的离屏图像需等待窗口重绘后才完整,截取后立即撤销重定向.
+ * 注: 不可重定向根窗口的所有子窗口,否则在撤销前整个桌面都将被重定向
+ * @return 窗口未在GTK_SHOT_CAPTURE_TIMEOUT毫秒内重绘时返回NULL
+ */
+GdkPixbuf* grab_redirected(GdkDisplay *display, Window xid
+                              , XWindowAttributes *attr) {
+  Display *dpy = GDK_DISPLAY_XDISPLAY(display);
+  gint event_base = 0, error_base = 0, major = 1, minor = 0;
+  GdkPixbuf *pixbuf = NULL;
+  Damage damage = None;
+
+  if (!XDamageQueryExtension(dpy, &event_base, &error_base)
+        || !XDamageQueryVersion(dpy, &major, &minor)) {
+    return NULL;
+  }
+
+  gdk_error_trap_push();
+  // 需在重定向前开始监听,以免错过窗口的首次重绘
+  damage = XDamageCreate(dpy, xid, XDamageReportRawRectangles);
+  XCompositeRedirectWindow(dpy, xid, CompositeRedirectAutomatic);
+  XSync(dpy, False);
+  if (gdk_error_trap_pop() == 0 && wait_repaint(dpy, xid, event_base)) {
+    pixbuf = grab_window_pixmap(display, xid, attr);
+  }
+
+  // 重定向或创建失败时撤销也会出错,一并忽略
+  gdk_error_trap_push();
+  XCompositeUnredirectWindow(dpy, xid, CompositeRedirectAutomatic);
+  if (damage != None) {
+    XDamageDestroy(dpy, damage);
+  }
+  XSync(dpy, False);
+  gdk_error_trap_pop();
+
+  return pixbuf;
+}
+
+/**
+ * 等待窗口重绘: 收到首个更新后,
+ * 直到GTK_SHOT_CAPTURE_SETTLE毫秒内不再有更新为止.
+ * 仅取出该窗口的XDamage事件,其余事件仍留给GDK处理
+ * @return 超时仍未收到更新时返回FALSE
+ */
+gboolean wait_repaint(Display *dpy, Window xid, gint event_base) {
+  struct pollfd fd = {.fd = ConnectionNumber(dpy), .events = POLLIN};
+  gint64 now = gtk_shot_trace_time(), last = 0;
+  gint64 deadline = now + (gint64) GTK_SHOT_CAPTURE_TIMEOUT * 1000000;
+  gint64 settle = (gint64) GTK_SHOT_CAPTURE_SETTLE * 1000000;
+  gboolean damaged = FALSE;
+  XEvent xev;
+
+  while (now < deadline) {
+    // XDamageNotifyEvent的drawable与XAnyEvent的window位置相同
+    while (XCheckTypedWindowEvent(dpy, xid
+                                    , event_base + XDamageNotify
+                                    , &xev)) {
+      damaged = TRUE;
+      last = now;
+    }
+    if (damaged && now - last >= settle) break;
+
+    gint64 until = damaged ? MIN(last + settle, deadline) : deadline;
+    poll(&fd, 1, (until - now + 999999) / 1000000);
+    now = gtk_shot_trace_time();
+  }
+  return damaged;
+}
+# endif
+
+GdkPixbuf* grab_pixmap(GdkDisplay *display, Pixmap pixmap
+                          , XWindowAttributes *attr) {
+  GdkScreen *screen = gdk_display_get_default_screen(display);
+  gint width = attr->width + 2 * attr->border_width;
+  gint height = attr->height + 2 * attr->border_width;
+  GdkVisual *visual =
+        gdk_x11_screen_lookup_visual(screen
+                                      , XVisualIDFromVisual(attr->visual));
+  GdkPixmap *drawable =
+        gdk_pixmap_foreign_new_for_screen(screen, pixmap
+                                            , width, height
+                                            , attr->depth);
+  GdkColormap *colormap = NULL;
+  GdkPixbuf *pixbuf = NULL;
+
+  if (!visual || !drawable) {
+    if (drawable) g_object_unref(drawable);
+    return NULL;
+  }
+  if (visual == gdk_screen_get_system_visual(screen)) {
+    colormap = g_object_ref(gdk_screen_get_system_colormap(screen));
+  } else {
+    colormap = gdk_colormap_new(visual, FALSE);
+  }
+  pixbuf = gdk_pixbuf_get_from_drawable(NULL, drawable, colormap
+                                          , 0, 0, 0, 0, width, height);
+  g_object_unref(colormap);
+  g_object_unref(drawable);
+
+  return pixbuf;
+}
+#endif
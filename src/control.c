@@ -0,0 +1,288 @@
+/*
+ * GtkShot - A screen capture programme using GtkLib
+ * Copyright (C) 2012 flytreeleft @ CrazyDan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <config.h>
+
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/time.h>
+
+#include <gtk/gtk.h>
+
+#include "utils.h"
+#include "trace.h"
+
+#include "control.h"
+
+/** 一个尚未读完命令的连接 */
+typedef struct _Client {
+  GtkShotControl *control;
+  GIOChannel *channel;
+  GString *line;
+} Client;
+
+static gboolean on_accept(GIOChannel *channel, GIOCondition condition
+                            , GtkShotControl *control);
+static gboolean on_readable(GIOChannel *channel, GIOCondition condition
+                              , Client *client);
+
+static gboolean check_directory(const gchar *path, gboolean create
+                                  , GError **error);
+static gint open_socket(const gchar *path, struct sockaddr_un *addr
+                          , GError **error);
+static gboolean write_all(gint fd, const gchar *buf, gsize len);
+static void set_error(GError **error, const gchar *path);
+
+/**
+ * 在path上监听命令,已存在的套接字文件(如上次异常退出遗留的)被替换,
+ * 进程唯一性由锁文件保证.
+ * path所在的目录须为当前用户私有,不存在时创建
+ */
+GtkShotControl* gtk_shot_control_new(const gchar *path
+                                        , GtkShotControlFunc func
+                                        , gpointer data
+                                        , GError **error) {
+  g_return_val_if_fail(path != NULL && func != NULL, NULL);
+
+  struct sockaddr_un addr;
+  gint fd = -1;
+  mode_t mask = 0;
+  gboolean bound = FALSE;
+
+  if (!check_directory(path, TRUE, error)) return NULL;
+  fd = open_socket(path, &addr, error);
+  if (fd < 0) return NULL;
+  unlink(path);
+  // 套接字文件创建时即仅当前用户可访问,而非创建后再chmod
+  mask = umask(S_IRWXG | S_IRWXO);
+  bound = bind(fd, (struct sockaddr*) &addr, sizeof(addr)) == 0;
+  umask(mask);
+  if (!bound || listen(fd, 4) != 0) {
+    set_error(error, path);
+    close(fd);
+    return NULL;
+  }
+
+  GtkShotControl *control = g_new(GtkShotControl, 1);
+
+  control->path = g_strdup(path);
+  control->func = func;
+  control->data = data;
+  control->channel = g_io_channel_unix_new(fd);
+  g_io_channel_set_close_on_unref(control->channel, TRUE);
+  control->source = g_io_add_watch(control->channel, G_IO_IN
+                                      , (GIOFunc) on_accept, control);
+
+  return control;
+}
+
+void gtk_shot_control_destroy(GtkShotControl *control) {
+  g_return_if_fail(control != NULL);
+
+  g_source_remove(control->source);
+  g_io_channel_unref(control->channel);
+  unlink(control->path);
+  g_free(control->path);
+  g_free(control);
+}
+
+/**
+ * 当前用户的控制端口,返回的路径需释放:
+ * 优先位于$XDG_RUNTIME_DIR,未设置时位于临时目录下的私有目录
+ */
+gchar* gtk_shot_control_get_default_path() {
+  const gchar *runtime = g_getenv("XDG_RUNTIME_DIR");
+
+  if (runtime && runtime[0]) {
+    return g_build_filename(runtime, GTK_SHOT_CONTROL_SOCKET, NULL);
+  }
+
+  gchar *name = g_strdup_printf("gtkshot-%u", (guint) getuid());
+  gchar *path = g_build_filename(g_get_tmp_dir(), name
+                                    , GTK_SHOT_CONTROL_SOCKET, NULL);
+
+  g_free(name);
+  return path;
+}
+
+/**
+ * 向常驻进程发送一条命令并等待应答
+ * @return 应答文本(需释放),失败时返回NULL并设置error
+ */
+gchar* gtk_shot_control_send(const gchar *path, const gchar *command
+                                , GError **error) {
+  g_return_val_if_fail(path != NULL && command != NULL, NULL);
+
+  struct sockaddr_un addr;
+  struct timeval tv = {.tv_sec = GTK_SHOT_CONTROL_TIMEOUT / 1000
+                        , .tv_usec = GTK_SHOT_CONTROL_TIMEOUT % 1000 * 1000};
+  GString *reply = NULL;
+  gchar buf[1024];
+  gssize n = 0;
+  gint fd = -1;
+
+  // 不连接其他用户可能伪造的套接字
+  if (!check_directory(path, FALSE, error)) return NULL;
+  fd = open_socket(path, &addr, error);
+  if (fd < 0) return NULL;
+  setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+  if (connect(fd, (struct sockaddr*) &addr, sizeof(addr)) != 0
+        || !write_all(fd, command, strlen(command))
+        || !write_all(fd, "\n", 1)) {
+    set_error(error, path);
+    close(fd);
+    return NULL;
+  }
+  shutdown(fd, SHUT_WR);
+
+  reply = g_string_new(NULL);
+  while ((n = read(fd, buf, sizeof(buf))) != 0) {
+    if (n > 0) {
+      g_string_append_len(reply, buf, n);
+    } else if (errno != EINTR) {
+      set_error(error, path);
+      g_string_free(reply, TRUE);
+      close(fd);
+      return NULL;
+    }
+  }
+  close(fd);
+
+  return g_string_free(reply, FALSE);
+}
+
+gboolean on_accept(GIOChannel *channel, GIOCondition condition
+                      , GtkShotControl *control) {
+  gint fd = accept(g_io_channel_unix_get_fd(channel), NULL, NULL);
+
+  if (fd < 0) return TRUE;
+
+  Client *client = g_new(Client, 1);
+  client->control = control;
+  client->line = g_string_new(NULL);
+  client->channel = g_io_channel_unix_new(fd);
+  g_io_channel_set_close_on_unref(client->channel, TRUE);
+  g_io_add_watch(client->channel, G_IO_IN | G_IO_HUP | G_IO_ERR
+                    , (GIOFunc) on_readable, client);
+
+  return TRUE;
+}
+
+/**
+ * 命令可能分多次到达,读到换行或连接关闭时处理.
+ * 应答较短,直接写回
+ */
+gboolean on_readable(GIOChannel *channel, GIOCondition condition
+                        , Client *client) {
+  gint fd = g_io_channel_unix_get_fd(channel);
+  gchar buf[GTK_SHOT_CONTROL_LINE];
+  gchar *end = NULL;
+  gssize n = read(fd, buf, sizeof(buf));
+
+  if (n < 0 && errno == EINTR) return TRUE;
+  if (n > 0) g_string_append_len(client->line, buf, n);
+  end = memchr(client->line->str, '\n', client->line->len);
+  if (!end && n > 0 && client->line->len < GTK_SHOT_CONTROL_LINE) {
+    return TRUE;
+  }
+
+  if (end) *end = '\0';
+  if (end || n == 0) {
+    trace_begin("control");
+    gchar *reply = client->control->func(g_strstrip(client->line->str)
+                                            , client->control->data);
+    trace_end("control");
+    if (reply) write_all(fd, reply, strlen(reply));
+    g_free(reply);
+  }
+  g_io_channel_unref(channel);
+  g_string_free(client->line, TRUE);
+  g_free(client);
+
+  return FALSE;
+}
+
+/**
+ * 套接字所在的目录须为当前用户所有且仅其可访问(非符号链接),
+ * 否则其他用户可预先创建或替换套接字文件.
+ * create为TRUE时,目录不存在则以0700创建
+ */
+gboolean check_directory(const gchar *path, gboolean create
+                            , GError **error) {
+  gchar *dir = g_path_get_dirname(path);
+  struct stat st;
+  gboolean succ = FALSE;
+
+  if (create && mkdir(dir, S_IRWXU) != 0 && errno != EEXIST) {
+    set_error(error, dir);
+  } else if (lstat(dir, &st) != 0) {
+    set_error(error, dir);
+  } else if (!S_ISDIR(st.st_mode) || st.st_uid != getuid()
+                || (st.st_mode & (S_IRWXG | S_IRWXO)) != 0) {
+    g_set_error(error, G_FILE_ERROR, G_FILE_ERROR_PERM
+                  , "%s: %s", dir
+                  , "not a private directory of the current user");
+  } else {
+    succ = TRUE;
+  }
+  g_free(dir);
+
+  return succ;
+}
+
+gint open_socket(const gchar *path, struct sockaddr_un *addr
+                    , GError **error) {
+  gint fd = -1;
+
+  memset(addr, 0, sizeof(*addr));
+  addr->sun_family = AF_UNIX;
+  if (strlen(path) >= sizeof(addr->sun_path)) {
+    g_set_error(error, G_FILE_ERROR, G_FILE_ERROR_NAMETOOLONG
+                  , "%s: %s", path, g_strerror(ENAMETOOLONG));
+    return -1;
+  }
+  strcpy(addr->sun_path, path);
+  fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (fd < 0) set_error(error, path);
+
+  return fd;
+}
+
+/** 对端已关闭时返回失败,而不是收到SIGPIPE */
+gboolean write_all(gint fd, const gchar *buf, gsize len) {
+  while (len > 0) {
+    gssize n = send(fd, buf, len, MSG_NOSIGNAL);
+    if (n < 0) {
+      if (errno == EINTR) continue;
+      return FALSE;
+    }
+    buf += n;
+    len -= n;
+  }
+  return TRUE;
+}
+
+void set_error(GError **error, const gchar *path) {
+  g_set_error(error, G_FILE_ERROR
+                , g_file_error_from_errno(errno)
+                , "%s: %s", path, g_strerror(errno));
+}
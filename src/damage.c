@@ -0,0 +1,143 @@
+/*
+ * GtkShot - A screen capture programme using GtkLib
+ * Copyright (C) 2012 flytreeleft @ CrazyDan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <config.h>
+
+#include <gtk/gtk.h>
+#include <gdk/gdkx.h>
+#ifdef HAVE_XDAMAGE
+# include <X11/extensions/Xdamage.h>
+# include <X11/extensions/Xfixes.h>
+#endif
+
+#include "utils.h"
+
+#include "damage.h"
+
+#ifdef HAVE_XDAMAGE
+static GdkFilterReturn on_damage_filter(GdkXEvent *xevent
+                                          , GdkEvent *event
+                                          , GtkShotDamage *damage);
+#endif
+
+GtkShotDamage* gtk_shot_damage_new(GdkWindow *root
+                                      , GtkShotDamageFunc func
+                                      , gpointer data) {
+  GtkShotDamage *damage = g_new(GtkShotDamage, 1);
+
+  damage->root = root;
+  damage->damage = 0;
+  damage->region = 0;
+  damage->event_base = 0;
+  damage->supported = FALSE;
+  damage->active = FALSE;
+  damage->func = func;
+  damage->data = data;
+#ifdef HAVE_XDAMAGE
+  Display *dpy = GDK_WINDOW_XDISPLAY(root);
+  gint error_base = 0, major = 0, minor = 0;
+
+  if (XDamageQueryExtension(dpy, &damage->event_base, &error_base)
+        && XFixesQueryExtension(dpy, &major, &error_base)) {
+    // XFixes的请求需在协商版本后才可使用
+    XFixesQueryVersion(dpy, &major, &minor);
+    damage->supported = TRUE;
+  }
+#endif
+#ifdef GTK_SHOT_DEBUG
+  debug("XDamage supported: %d\n", damage->supported);
+#endif
+
+  return damage;
+}
+
+void gtk_shot_damage_destroy(GtkShotDamage *damage) {
+  g_return_if_fail(damage != NULL);
+
+  gtk_shot_damage_stop(damage);
+  g_free(damage);
+}
+
+/**
+ * 开始监听屏幕更新
+ * @return 不支持XDamage时返回FALSE
+ */
+gboolean gtk_shot_damage_start(GtkShotDamage *damage) {
+  g_return_val_if_fail(damage != NULL, FALSE);
+
+  if (!damage->supported) return FALSE;
+  if (damage->active) return TRUE;
+#ifdef HAVE_XDAMAGE
+  Display *dpy = GDK_WINDOW_XDISPLAY(damage->root);
+
+  // 仅在更新区域由空变为非空时通知,再一次性取出全部区域
+  damage->damage = XDamageCreate(dpy, GDK_WINDOW_XID(damage->root)
+                                    , XDamageReportNonEmpty);
+  damage->region = XFixesCreateRegion(dpy, NULL, 0);
+  gdk_window_add_filter(NULL, (GdkFilterFunc) on_damage_filter, damage);
+  damage->active = TRUE;
+#endif
+  return damage->active;
+}
+
+void gtk_shot_damage_stop(GtkShotDamage *damage) {
+  g_return_if_fail(damage != NULL);
+
+  if (!damage->active) return;
+#ifdef HAVE_XDAMAGE
+  Display *dpy = GDK_WINDOW_XDISPLAY(damage->root);
+
+  gdk_window_remove_filter(NULL, (GdkFilterFunc) on_damage_filter
+                              , damage);
+  XDamageDestroy(dpy, damage->damage);
+  XFixesDestroyRegion(dpy, damage->region);
+  damage->damage = damage->region = 0;
+#endif
+  damage->active = FALSE;
+}
+
+#ifdef HAVE_XDAMAGE
+GdkFilterReturn on_damage_filter(GdkXEvent *xevent
+                                    , GdkEvent *event
+                                    , GtkShotDamage *damage) {
+  XEvent *xev = (XEvent*) xevent;
+
+  if (xev->type != damage->event_base + XDamageNotify
+        || ((XDamageNotifyEvent*) xev)->damage != damage->damage) {
+    return GDK_FILTER_CONTINUE;
+  }
+  Display *dpy = GDK_WINDOW_XDISPLAY(damage->root);
+  XRectangle *rects = NULL;
+  GdkRectangle rect;
+  gint i = 0, n = 0;
+
+  XDamageSubtract(dpy, damage->damage, None, damage->region);
+  rects = XFixesFetchRegion(dpy, damage->region, &n);
+  for (i = 0; i < n; i++) {
+    rect.x = rects[i].x;
+    rect.y = rects[i].y;
+    rect.width = rects[i].width;
+    rect.height = rects[i].height;
+    if (damage->func) {
+      damage->func(&rect, damage->data);
+    }
+  }
+  if (rects) XFree(rects);
+
+  return GDK_FILTER_REMOVE;
+}
+#endif
@@ -0,0 +1,238 @@
+/*
+ * GtkShot - A screen capture programme using GtkLib
+ * Copyright (C) 2012 flytreeleft @ CrazyDan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <config.h>
+
+#include <math.h>
+#include <gtk/gtk.h>
+
+#include "utils.h"
+
+#include "doodle.h"
+
+typedef enum _BatchKind {
+  BATCH_STROKE, // 描边缓存的路径
+  BATCH_FILL, // 填充缓存的填充路径
+  BATCH_SINGLE // 无缓存路径,单独调用draw_track
+} BatchKind;
+
+typedef struct _Batch {
+  BatchKind kind;
+  gint size, color;
+  GdkRectangle bounds; // 批次内所有画笔的范围
+  gboolean unbounded; // 含范围未知的画笔(如文本)
+  GPtrArray *pens;
+} Batch;
+
+#define BATCH(doodle, i) \
+          ((Batch*) g_ptr_array_index((doodle)->batches, (i)))
+
+static void build_batches(GtkShotDoodle *doodle, GSList *pens);
+static void add_item(GtkShotDoodle *doodle, GtkShotPen *pen
+                        , BatchKind kind);
+static gboolean batch_overlaps(Batch *batch, GtkShotPen *pen);
+static void free_batch(Batch *batch);
+
+GtkShotDoodle* gtk_shot_doodle_new() {
+  GtkShotDoodle *doodle = g_new0(GtkShotDoodle, 1);
+
+  doodle->batches = g_ptr_array_new();
+  doodle->dirty = TRUE;
+
+  return doodle;
+}
+
+void gtk_shot_doodle_destroy(GtkShotDoodle *doodle) {
+  g_return_if_fail(doodle != NULL);
+
+  gtk_shot_doodle_invalidate(doodle);
+  g_ptr_array_free(doodle->batches, TRUE);
+  g_free(doodle);
+}
+
+/** 画笔被添加/删除/修改后调用,下次绘制时重新分组 */
+void gtk_shot_doodle_invalidate(GtkShotDoodle *doodle) {
+  g_return_if_fail(doodle != NULL);
+
+  guint i = 0;
+  for (i = 0; i < doodle->batches->len; i++) {
+    free_batch(BATCH(doodle, i));
+  }
+  g_ptr_array_set_size(doodle->batches, 0);
+  doodle->dirty = TRUE;
+}
+
+/** 按批次绘制pens(按层叠顺序排列的已提交画笔) */
+void gtk_shot_doodle_draw(GtkShotDoodle *doodle, GSList *pens
+                            , cairo_t *cr) {
+  g_return_if_fail(doodle != NULL && cr != NULL);
+
+  GtkShotDoodleStats *stats = &doodle->stats;
+  gint size = -1, color = -1; // 当前的线宽和颜色(-1为未知)
+  guint i = 0, j = 0;
+  gdouble x0 = 0, y0 = 0, x1 = 0, y1 = 0;
+  GdkRectangle clip, rect;
+
+  if (doodle->dirty) {
+    build_batches(doodle, pens);
+    doodle->dirty = FALSE;
+    doodle->rebuilds++;
+  }
+  stats->pens = g_slist_length(pens);
+  stats->batches = doodle->batches->len;
+  stats->calls = stats->state_changes = stats->draws = 0;
+  // 仅绘制与重绘区域相交的批次(如拖动画笔时)
+  cairo_clip_extents(cr, &x0, &y0, &x1, &y1);
+  clip.x = floor(x0); clip.y = floor(y0);
+  clip.width = ceil(x1) - clip.x;
+  clip.height = ceil(y1) - clip.y;
+
+  for (i = 0; i < doodle->batches->len; i++) {
+    Batch *batch = BATCH(doodle, i);
+
+    if (!batch->unbounded
+          && !gdk_rectangle_intersect(&batch->bounds, &clip, &rect)) {
+      stats->batches--;
+      continue;
+    }
+    if (batch->kind == BATCH_SINGLE) {
+      for (j = 0; j < batch->pens->len; j++) {
+        GtkShotPen *pen = GTK_SHOT_PEN(g_ptr_array_index(batch->pens, j));
+        pen->draw_track(pen, cr);
+        stats->draws++;
+      }
+      size = color = -1;
+      continue;
+    }
+    if (batch->kind == BATCH_STROKE && batch->size != size) {
+      size = batch->size;
+      cairo_set_line_width(cr, size);
+      stats->state_changes++;
+    }
+    if (batch->color != color) {
+      color = batch->color;
+      SET_CAIRO_RGB(cr, color);
+      stats->state_changes++;
+    }
+    for (j = 0; j < batch->pens->len; j++) {
+      GtkShotPen *pen = GTK_SHOT_PEN(g_ptr_array_index(batch->pens, j));
+      cairo_append_path(cr, batch->kind == BATCH_STROKE ?
+                              pen->path : pen->fill_path);
+      stats->calls++;
+    }
+    if (batch->kind == BATCH_STROKE) {
+      cairo_stroke(cr);
+    } else {
+      cairo_fill(cr);
+    }
+    stats->draws++;
+  }
+  stats->calls += stats->state_changes + stats->draws;
+#ifdef GTK_SHOT_DEBUG
+  debug("doodle: %u pens, %u batches, %u cairo calls" \
+          " (%u state changes, %u draws)\n"
+            , stats->pens, stats->batches, stats->calls
+            , stats->state_changes, stats->draws);
+#endif
+}
+
+/** 批次占用的内存(字节),画笔本身计入画笔 */
+gsize gtk_shot_doodle_get_memory(GtkShotDoodle *doodle) {
+  g_return_val_if_fail(doodle != NULL, 0);
+
+  gsize size = sizeof(GtkShotDoodle) + sizeof(GPtrArray)
+                + doodle->batches->len * sizeof(gpointer);
+  guint i = 0;
+
+  for (i = 0; i < doodle->batches->len; i++) {
+    size += sizeof(Batch) + sizeof(GPtrArray)
+              + BATCH(doodle, i)->pens->len * sizeof(gpointer);
+  }
+  return size;
+}
+
+void build_batches(GtkShotDoodle *doodle, GSList *pens) {
+  GSList *l = pens;
+  for (l; l; l = l->next) {
+    GtkShotPen *pen = GTK_SHOT_PEN(l->data);
+
+    if (!pen->path) {
+      add_item(doodle, pen, BATCH_SINGLE);
+      continue;
+    }
+    add_item(doodle, pen, BATCH_STROKE);
+    if (pen->fill_path) {
+      add_item(doodle, pen, BATCH_FILL);
+    }
+  }
+}
+
+/**
+ * 由后向前查找样式相同的批次,
+ * 遇到与画笔重叠的批次时停止(不可越过该批次向下合并).
+ * 填充路径重叠时合并可能因环绕规则产生空洞,故填充仅合并不重叠者
+ */
+void add_item(GtkShotDoodle *doodle, GtkShotPen *pen, BatchKind kind) {
+  Batch *target = NULL;
+  gint i = 0;
+
+  if (kind != BATCH_SINGLE) {
+    for (i = (gint) doodle->batches->len - 1; i >= 0; i--) {
+      Batch *batch = BATCH(doodle, i);
+      gboolean overlaps = batch_overlaps(batch, pen);
+
+      if (batch->kind == kind && batch->color == pen->color
+            && (kind != BATCH_STROKE || batch->size == pen->size)
+            && (kind != BATCH_FILL || !overlaps)) {
+        target = batch;
+        break;
+      }
+      if (overlaps) break;
+    }
+  }
+  if (!target) {
+    target = g_new(Batch, 1);
+    target->kind = kind;
+    target->size = pen->size;
+    target->color = pen->color;
+    target->bounds = pen->bounds;
+    target->unbounded = FALSE;
+    target->pens = g_ptr_array_new();
+    g_ptr_array_add(doodle->batches, target);
+  } else {
+    gdk_rectangle_union(&target->bounds, &pen->bounds, &target->bounds);
+  }
+  if (pen->bounds.width <= 0 || pen->bounds.height <= 0) {
+    target->unbounded = TRUE;
+  }
+  g_ptr_array_add(target->pens, pen);
+}
+
+gboolean batch_overlaps(Batch *batch, GtkShotPen *pen) {
+  GdkRectangle rect;
+
+  if (batch->unbounded
+        || pen->bounds.width <= 0 || pen->bounds.height <= 0) {
+    return TRUE;
+  }
+  return gdk_rectangle_intersect(&batch->bounds, &pen->bounds, &rect);
+}
+
+void free_batch(Batch *batch) {
+  g_ptr_array_free(batch->pens, TRUE);
+  g_free(batch);
+}
@@ -0,0 +1,341 @@
+/*
+ * GtkShot - A screen capture programme using GtkLib
+ * Copyright (C) 2012 flytreeleft @ CrazyDan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <config.h>
+
+#include <gtk/gtk.h>
+
+#include "utils.h"
+#include "trace.h"
+
+#include "edges.h"
+
+/** 位于第pos行(列)的边缘线段[start, end) */
+typedef struct _EdgeRun {
+  gint pos;
+  gint start, end;
+} EdgeRun;
+
+/**
+ * 一次边缘计算: 被取代后仍由后台线程持有,
+ * 其截图可能已被原地修改,结果直接丢弃
+ */
+struct _GtkShotEdgesJob {
+  GtkShotEdges *edges;
+  GdkPixbuf *pixbuf; // 正在分析的截图,计算结束后释放
+  gint x, y; // 截图原点的屏幕坐标
+  GArray *rows; // 水平边缘(屏幕坐标)
+  GArray *cols; // 垂直边缘(屏幕坐标)
+  volatile gint cancel; // 是否已被取代
+};
+
+#define RUN(runs, i) (g_array_index((runs), EdgeRun, (i)))
+
+static gpointer build_edges(GtkShotEdgesJob *job);
+static void finish_job(GtkShotEdgesJob *job);
+static void free_job(GtkShotEdgesJob *job);
+static void get_luma(const guchar *pixels, gint n_channels
+                        , guchar *luma, gint width);
+static void add_run(GArray *runs, gint pos, gint start, gint length);
+static void add_row_runs(GArray *runs, const guchar *flags, gint width
+                            , gint pos, gint offset);
+static gint compare_run(const EdgeRun *a, const EdgeRun *b);
+static gboolean snap(GArray *runs, gint pos, gint start, gint end
+                        , gint *snapped);
+
+GtkShotEdges* gtk_shot_edges_new() {
+  GtkShotEdges *edges = g_new(GtkShotEdges, 1);
+
+  edges->mutex = g_mutex_new();
+  edges->cond = g_cond_new();
+  edges->job = NULL;
+  edges->index = NULL;
+  edges->running = 0;
+  edges->ready = FALSE;
+
+  return edges;
+}
+
+/** 等待所有后台线程(含已取代的)结束后释放 */
+void gtk_shot_edges_destroy(GtkShotEdges *edges) {
+  g_return_if_fail(edges != NULL);
+
+  gtk_shot_edges_clear(edges);
+  gtk_shot_edges_wait(edges);
+  g_mutex_free(edges->mutex);
+  g_cond_free(edges->cond);
+  g_free(edges);
+}
+
+/**
+ * 在后台线程中建立截图(原点为屏幕坐标(x, y))的边缘索引.
+ * 截图被修改前需先调用gtk_shot_edges_clear使其失效
+ */
+void gtk_shot_edges_build(GtkShotEdges *edges, GdkPixbuf *pixbuf
+                            , gint x, gint y) {
+  g_return_if_fail(edges != NULL);
+
+  gtk_shot_edges_clear(edges);
+  if (!pixbuf) return;
+
+  GtkShotEdgesJob *job = g_new(GtkShotEdgesJob, 1);
+
+  job->edges = edges;
+  job->pixbuf = g_object_ref(pixbuf);
+  job->x = x;
+  job->y = y;
+  job->rows = g_array_new(FALSE, FALSE, sizeof(EdgeRun));
+  job->cols = g_array_new(FALSE, FALSE, sizeof(EdgeRun));
+  job->cancel = FALSE;
+
+  g_mutex_lock(edges->mutex);
+  edges->job = job;
+  edges->running++;
+  g_mutex_unlock(edges->mutex);
+
+  if (!g_thread_create((GThreadFunc) build_edges, job, FALSE, NULL)) {
+    g_mutex_lock(edges->mutex);
+    edges->job = NULL;
+    edges->running--;
+    g_mutex_unlock(edges->mutex);
+    free_job(job);
+  }
+}
+
+/**
+ * 清空边缘索引,并取代尚未完成的计算.
+ * 不等待后台线程,可在每次屏幕更新时调用
+ */
+void gtk_shot_edges_clear(GtkShotEdges *edges) {
+  g_return_if_fail(edges != NULL);
+
+  GtkShotEdgesJob *index = NULL;
+
+  g_mutex_lock(edges->mutex);
+  if (edges->job) {
+    g_atomic_int_set(&edges->job->cancel, TRUE);
+    edges->job = NULL;
+  }
+  index = edges->index;
+  edges->index = NULL;
+  g_atomic_int_set(&edges->ready, FALSE);
+  g_mutex_unlock(edges->mutex);
+
+  if (index) free_job(index);
+}
+
+/** 等待所有后台线程结束,仅用于销毁和基准测试 */
+void gtk_shot_edges_wait(GtkShotEdges *edges) {
+  g_return_if_fail(edges != NULL);
+
+  g_mutex_lock(edges->mutex);
+  while (edges->running > 0) {
+    g_cond_wait(edges->cond, edges->mutex);
+  }
+  g_mutex_unlock(edges->mutex);
+}
+
+/**
+ * 查找x附近且与[y0, y1)相交的垂直边缘
+ * @return 找到时返回TRUE,并将边缘所在的列保存到snapped中
+ */
+gboolean gtk_shot_edges_snap_x(GtkShotEdges *edges, gint x
+                                , gint y0, gint y1, gint *snapped) {
+  g_return_val_if_fail(edges != NULL, FALSE);
+
+  if (!g_atomic_int_get(&edges->ready)) return FALSE;
+  return snap(edges->index->cols, x, y0, y1, snapped);
+}
+
+/**
+ * 查找y附近且与[x0, x1)相交的水平边缘
+ * @return 找到时返回TRUE,并将边缘所在的行保存到snapped中
+ */
+gboolean gtk_shot_edges_snap_y(GtkShotEdges *edges, gint y
+                                , gint x0, gint x1, gint *snapped) {
+  g_return_val_if_fail(edges != NULL, FALSE);
+
+  if (!g_atomic_int_get(&edges->ready)) return FALSE;
+  return snap(edges->index->rows, y, x0, x1, snapped);
+}
+
+/**
+ * 逐行扫描截图,内存占用仅与截图宽度相关:
+ * 当前行与上一行比较得到水平边缘,
+ * 与左侧像素比较的结果按列累计得到垂直边缘.
+ * 每行检查一次是否已被取代
+ */
+gpointer build_edges(GtkShotEdgesJob *job) {
+  GdkPixbuf *pixbuf = job->pixbuf;
+  gint width = gdk_pixbuf_get_width(pixbuf);
+  gint height = gdk_pixbuf_get_height(pixbuf);
+  gint n_channels = gdk_pixbuf_get_n_channels(pixbuf);
+  gint rowstride = gdk_pixbuf_get_rowstride(pixbuf);
+  const guchar *pixels = gdk_pixbuf_get_pixels(pixbuf);
+  guchar *prev = g_new(guchar, width);
+  guchar *cur = g_new(guchar, width);
+  guchar *flags = g_new0(guchar, width);
+  gint *col_start = g_new0(gint, width);
+  gint *col_length = g_new0(gint, width);
+  gint x = 0, y = 0;
+#ifdef GTK_SHOT_DEBUG
+  GTimer *timer = g_timer_new();
+#endif
+
+  gtk_shot_trace_set_thread_name("edges");
+  trace_begin("edges");
+
+  for (y = 0; y < height; y++) {
+    if (g_atomic_int_get(&job->cancel)) break;
+
+    get_luma(pixels + y * rowstride, n_channels, cur, width);
+    if (y > 0) {
+      for (x = 0; x < width; x++) {
+        flags[x] = ABS(cur[x] - prev[x]) > GTK_SHOT_EDGES_THRESHOLD;
+      }
+      add_row_runs(job->rows, flags, width, job->y + y, job->x);
+    }
+    for (x = 1; x < width; x++) {
+      flags[x] = ABS(cur[x] - cur[x - 1]) > GTK_SHOT_EDGES_THRESHOLD;
+    }
+    for (x = 1; x < width; x++) {
+      if (flags[x]) {
+        if (col_length[x]++ == 0) col_start[x] = y;
+      } else if (col_length[x] > 0) {
+        add_run(job->cols, job->x + x
+                  , job->y + col_start[x], col_length[x]);
+        col_length[x] = 0;
+      }
+    }
+    guchar *tmp = prev; prev = cur; cur = tmp;
+  }
+  for (x = 1; x < width; x++) {
+    if (col_length[x] > 0) {
+      add_run(job->cols, job->x + x
+                , job->y + col_start[x], col_length[x]);
+    }
+  }
+  // 水平边缘已按行有序,垂直边缘按结束的行加入,需重新排序
+  g_array_sort(job->cols, (GCompareFunc) compare_run);
+
+  g_free(prev);
+  g_free(cur);
+  g_free(flags);
+  g_free(col_start);
+  g_free(col_length);
+
+  trace_end("edges");
+#ifdef GTK_SHOT_DEBUG
+  debug("edges of %dx%d: %u rows, %u cols in %.1fms\n"
+            , width, height, job->rows->len, job->cols->len
+            , g_timer_elapsed(timer, NULL) * 1000);
+  g_timer_destroy(timer);
+#endif
+  finish_job(job);
+  return NULL;
+}
+
+/** 任务仍未被取代时发布为边缘索引,否则丢弃 */
+void finish_job(GtkShotEdgesJob *job) {
+  GtkShotEdges *edges = job->edges;
+
+  g_object_unref(job->pixbuf);
+  job->pixbuf = NULL;
+
+  g_mutex_lock(edges->mutex);
+  if (edges->job == job) {
+    edges->job = NULL;
+    edges->index = job;
+    job = NULL;
+    g_atomic_int_set(&edges->ready, TRUE);
+  }
+  edges->running--;
+  g_cond_broadcast(edges->cond);
+  g_mutex_unlock(edges->mutex);
+
+  if (job) free_job(job);
+}
+
+void free_job(GtkShotEdgesJob *job) {
+  if (job->pixbuf) g_object_unref(job->pixbuf);
+  g_array_free(job->rows, TRUE);
+  g_array_free(job->cols, TRUE);
+  g_free(job);
+}
+
+/** 亮度近似值: (77R + 150G + 29B) / 256 */
+void get_luma(const guchar *pixels, gint n_channels
+                , guchar *luma, gint width) {
+  gint x = 0;
+  for (x = 0; x < width; x++, pixels += n_channels) {
+    luma[x] = (pixels[0] * 77 + pixels[1] * 150 + pixels[2] * 29) >> 8;
+  }
+}
+
+void add_run(GArray *runs, gint pos, gint start, gint length) {
+  if (length < GTK_SHOT_EDGES_MIN_RUN) return;
+
+  EdgeRun run = {.pos = pos, .start = start, .end = start + length};
+  g_array_append_val(runs, run);
+}
+
+void add_row_runs(GArray *runs, const guchar *flags, gint width
+                    , gint pos, gint offset) {
+  gint x = 0, start = -1;
+  for (x = 0; x < width; x++) {
+    if (flags[x]) {
+      if (start < 0) start = x;
+    } else if (start >= 0) {
+      add_run(runs, pos, offset + start, x - start);
+      start = -1;
+    }
+  }
+  if (start >= 0) {
+    add_run(runs, pos, offset + start, width - start);
+  }
+}
+
+gint compare_run(const EdgeRun *a, const EdgeRun *b) {
+  if (a->pos != b->pos) return a->pos - b->pos;
+  return a->start - b->start;
+}
+
+/** 二分定位距离范围内的第一条边缘,再取与[start, end)相交的最近者 */
+gboolean snap(GArray *runs, gint pos, gint start, gint end
+                , gint *snapped) {
+  guint lo = 0, hi = runs->len, mid = 0, i = 0;
+  gint best = GTK_SHOT_SNAP_DISTANCE + 1;
+
+  while (lo < hi) {
+    mid = (lo + hi) / 2;
+    if (RUN(runs, mid).pos < pos - GTK_SHOT_SNAP_DISTANCE) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  for (i = lo; i < runs->len
+                && RUN(runs, i).pos <= pos + GTK_SHOT_SNAP_DISTANCE; i++) {
+    EdgeRun *run = &RUN(runs, i);
+    if (run->start < end && run->end > start
+          && ABS(run->pos - pos) < best) {
+      best = ABS(run->pos - pos);
+      *snapped = run->pos;
+    }
+  }
+  return best <= GTK_SHOT_SNAP_DISTANCE;
+}
@@ -0,0 +1,203 @@
+/*
+ * GtkShot - A screen capture programme using GtkLib
+ * Copyright (C) 2012 flytreeleft @ CrazyDan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <config.h>
+
+#include <gtk/gtk.h>
+#include <gdk/gdkx.h>
+#include <X11/keysym.h>
+
+#include "utils.h"
+#include "trace.h"
+
+#include "hotkey.h"
+
+typedef struct _Hotkey {
+  guint id;
+  KeyCode keycode;
+  guint modifiers; // X的修饰键掩码
+} Hotkey;
+
+/** 可与按键组合的修饰键 */
+#define MODIFIER_MASKS (ShiftMask | ControlMask | Mod1Mask | Mod2Mask \
+                          | Mod3Mask | Mod4Mask | Mod5Mask)
+
+#define HOTKEY(hotkeys, i) (g_array_index((hotkeys)->keys, Hotkey, (i)))
+
+static GdkFilterReturn on_root_filter(GdkXEvent *xevent
+                                        , GdkEvent *event
+                                        , GtkShotHotkeys *hotkeys);
+
+static gboolean grab_key(GtkShotHotkeys *hotkeys, Hotkey *key
+                            , gboolean grab);
+static guint find_num_lock(Display *dpy);
+
+GtkShotHotkeys* gtk_shot_hotkeys_new(GdkWindow *root
+                                        , GtkShotHotkeyFunc func
+                                        , gpointer data) {
+  GtkShotHotkeys *hotkeys = g_new(GtkShotHotkeys, 1);
+
+  hotkeys->root = root;
+  hotkeys->keys = g_array_new(FALSE, FALSE, sizeof(Hotkey));
+  hotkeys->func = func;
+  hotkeys->data = data;
+  hotkeys->pressed = 0;
+  hotkeys->num_lock = find_num_lock(GDK_WINDOW_XDISPLAY(root));
+  // 被抓取的按键总是发送到根窗口,无需修改其事件掩码
+  gdk_window_add_filter(root, (GdkFilterFunc) on_root_filter, hotkeys);
+
+  return hotkeys;
+}
+
+void gtk_shot_hotkeys_destroy(GtkShotHotkeys *hotkeys) {
+  g_return_if_fail(hotkeys != NULL);
+
+  gtk_shot_hotkeys_unbind_all(hotkeys);
+  gdk_window_remove_filter(hotkeys->root
+                            , (GdkFilterFunc) on_root_filter, hotkeys);
+  g_array_free(hotkeys->keys, TRUE);
+  g_free(hotkeys);
+}
+
+/**
+ * 绑定热键,accelerator的格式同gtk_accelerator_parse,如"<Control><Alt>a"
+ * @return 格式错误或热键已被其他程序占用时返回FALSE
+ */
+gboolean gtk_shot_hotkeys_bind(GtkShotHotkeys *hotkeys, guint id
+                                  , const gchar *accelerator
+                                  , GError **error) {
+  g_return_val_if_fail(hotkeys != NULL && accelerator != NULL, FALSE);
+
+  Display *dpy = GDK_WINDOW_XDISPLAY(hotkeys->root);
+  GdkModifierType modifiers = 0;
+  guint keyval = 0;
+  Hotkey key;
+
+  gtk_accelerator_parse(accelerator, &keyval, &modifiers);
+  key.id = id;
+  key.keycode = keyval ? XKeysymToKeycode(dpy, keyval) : 0;
+  if (!key.keycode) {
+    g_set_error(error, G_FILE_ERROR, G_FILE_ERROR_INVAL
+                  , "%s: %s", accelerator, "invalid hotkey");
+    return FALSE;
+  }
+  // Super/Hyper/Meta等虚拟修饰键映射为实际的Mod2~Mod5
+  gdk_keymap_map_virtual_modifiers(gdk_keymap_get_default(), &modifiers);
+  key.modifiers = modifiers & MODIFIER_MASKS & ~hotkeys->num_lock;
+
+  if (!grab_key(hotkeys, &key, TRUE)) {
+    grab_key(hotkeys, &key, FALSE);
+    g_set_error(error, G_FILE_ERROR, G_FILE_ERROR_EXIST
+                  , "%s: %s", accelerator
+                  , "hotkey is grabbed by another client");
+    return FALSE;
+  }
+  g_array_append_val(hotkeys->keys, key);
+
+  return TRUE;
+}
+
+void gtk_shot_hotkeys_unbind_all(GtkShotHotkeys *hotkeys) {
+  g_return_if_fail(hotkeys != NULL);
+
+  guint i = 0;
+  for (i = 0; i < hotkeys->keys->len; i++) {
+    grab_key(hotkeys, &HOTKEY(hotkeys, i), FALSE);
+  }
+  g_array_set_size(hotkeys->keys, 0);
+}
+
+GdkFilterReturn on_root_filter(GdkXEvent *xevent
+                                  , GdkEvent *event
+                                  , GtkShotHotkeys *hotkeys) {
+  XEvent *xev = (XEvent*) xevent;
+  guint i = 0;
+
+  if (xev->type != KeyPress && xev->type != KeyRelease) {
+    return GDK_FILTER_CONTINUE;
+  }
+  for (i = 0; i < hotkeys->keys->len; i++) {
+    Hotkey *key = &HOTKEY(hotkeys, i);
+
+    if (key->keycode != xev->xkey.keycode
+          || key->modifiers != (xev->xkey.state & MODIFIER_MASKS
+                                  & ~hotkeys->num_lock)) {
+      continue;
+    }
+    if (xev->type == KeyPress) {
+      hotkeys->pressed = gtk_shot_trace_time();
+      trace_begin("hotkey");
+      hotkeys->func(key->id, hotkeys->data);
+      trace_end("hotkey");
+    }
+    return GDK_FILTER_REMOVE;
+  }
+  return GDK_FILTER_CONTINUE;
+}
+
+/**
+ * 抓取/释放按键及其与各锁定键(CapsLock, NumLock)的组合,
+ * NumLock未映射到修饰键时仅需CapsLock的组合
+ * @return 抓取失败(如已被占用)时返回FALSE
+ */
+gboolean grab_key(GtkShotHotkeys *hotkeys, Hotkey *key, gboolean grab) {
+  Display *dpy = GDK_WINDOW_XDISPLAY(hotkeys->root);
+  Window root = GDK_WINDOW_XID(hotkeys->root);
+  guint locks[] = {0, LockMask, hotkeys->num_lock
+                    , LockMask | hotkeys->num_lock};
+  guint i = 0, n = hotkeys->num_lock ? G_N_ELEMENTS(locks) : 2;
+
+  gdk_error_trap_push();
+  for (i = 0; i < n; i++) {
+    if (grab) {
+      XGrabKey(dpy, key->keycode, key->modifiers | locks[i], root
+                  , False, GrabModeAsync, GrabModeAsync);
+    } else {
+      XUngrabKey(dpy, key->keycode, key->modifiers | locks[i], root);
+    }
+  }
+  gdk_flush();
+
+  return gdk_error_trap_pop() == 0;
+}
+
+/**
+ * 查找NumLock所在的修饰键(Mod1~Mod5之一,取决于键盘映射)
+ * @return 修饰键掩码,NumLock未映射到修饰键时返回0
+ */
+guint find_num_lock(Display *dpy) {
+  KeyCode keycode = XKeysymToKeycode(dpy, XK_Num_Lock);
+  XModifierKeymap *map = NULL;
+  guint mask = 0;
+  gint i = 0, j = 0;
+
+  if (!keycode) return 0;
+
+  map = XGetModifierMapping(dpy);
+  // 各修饰键依次占max_keypermod个键码,空位为0
+  for (i = Mod1MapIndex; i <= Mod5MapIndex && !mask; i++) {
+    for (j = 0; j < map->max_keypermod; j++) {
+      if (map->modifiermap[i * map->max_keypermod + j] == keycode) {
+        mask = 1 << i;
+        break;
+      }
+    }
+  }
+  XFreeModifiermap(map);
+
+  return mask;
+}
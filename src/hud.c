@@ -0,0 +1,195 @@
+/*
+ * GtkShot - A screen capture programme using GtkLib
+ * Copyright (C) 2012 flytreeleft @ CrazyDan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <config.h>
+
+#include <gtk/gtk.h>
+
+#include "utils.h"
+
+#include "hud.h"
+
+/* The padding of the HUD panel */
+#define PADDING 6
+
+static gdouble last_frame(GtkShotHud *hud);
+static gdouble max_frame(GtkShotHud *hud);
+static void draw_sparkline(GtkShotHud *hud, cairo_t *cr
+                              , gdouble x, gdouble y, gdouble scale);
+
+GtkShotHud* gtk_shot_hud_new() {
+  GtkShotHud *hud = g_new0(GtkShotHud, 1);
+
+  hud->visible = FALSE;
+  hud->timer = g_timer_new();
+  hud->layout = NULL;
+
+  return hud;
+}
+
+void gtk_shot_hud_destroy(GtkShotHud *hud) {
+  g_return_if_fail(hud != NULL);
+
+  g_timer_destroy(hud->timer);
+  if (hud->layout) g_object_unref(hud->layout);
+  g_free(hud);
+}
+
+void gtk_shot_hud_toggle(GtkShotHud *hud) {
+  g_return_if_fail(hud != NULL);
+
+  hud->visible = !hud->visible;
+  hud->rect.width = hud->rect.height = 0;
+}
+
+void gtk_shot_hud_begin_capture(GtkShotHud *hud) {
+  g_return_if_fail(hud != NULL);
+
+  hud->capture_start = g_timer_elapsed(hud->timer, NULL);
+}
+
+void gtk_shot_hud_end_capture(GtkShotHud *hud) {
+  g_return_if_fail(hud != NULL);
+
+  hud->capture_ms =
+    (g_timer_elapsed(hud->timer, NULL) - hud->capture_start) * 1000;
+}
+
+/** 帧开始时结算上一帧以来的事件数 */
+void gtk_shot_hud_begin_frame(GtkShotHud *hud) {
+  g_return_if_fail(hud != NULL);
+
+  hud->events_per_frame = hud->events;
+  hud->events = 0;
+  hud->frame_start = g_timer_elapsed(hud->timer, NULL);
+}
+
+/** 帧结束时记录耗时(需在绘制浮层之前调用) */
+void gtk_shot_hud_end_frame(GtkShotHud *hud) {
+  g_return_if_fail(hud != NULL);
+
+  hud->frames[hud->frame_pos] =
+    (g_timer_elapsed(hud->timer, NULL) - hud->frame_start) * 1000;
+  hud->frame_pos = (hud->frame_pos + 1) % GTK_SHOT_HUD_FRAMES;
+  hud->frame_count = MIN(hud->frame_count + 1, GTK_SHOT_HUD_FRAMES);
+}
+
+/**
+ * 以(x, y)为左下角绘制浮层: 计时信息,调用方提供的附加信息(extra),
+ * 以及帧耗时的走势图(虚线为每帧的时间预算).
+ * cr的坐标与(x, y)一致,绘制时不改变cr的状态
+ */
+void gtk_shot_hud_draw(GtkShotHud *hud, cairo_t *cr
+                          , gint x, gint y, const gchar *extra) {
+  g_return_if_fail(hud != NULL && cr != NULL);
+
+  if (!hud->visible) return;
+
+  g_snprintf(hud->text, GTK_SHOT_HUD_TEXT_SIZE
+              , "capture: %7.2f ms\n"
+                "frame:   %7.2f ms (max %.2f)\n"
+                "events:  %7u /frame\n"
+                "%s"
+              , hud->capture_ms
+              , last_frame(hud), max_frame(hud)
+              , hud->events_per_frame
+              , extra ? extra : "");
+
+  if (!hud->layout) {
+    PangoFontDescription *desc =
+      pango_font_description_from_string(GTK_SHOT_HUD_FONT);
+    hud->layout = pango_cairo_create_layout(cr);
+    pango_layout_set_font_description(hud->layout, desc);
+    pango_font_description_free(desc);
+  } else {
+    pango_cairo_update_layout(cr, hud->layout);
+  }
+  pango_layout_set_text(hud->layout, hud->text, -1);
+
+  gint width = 0, height = 0;
+  pango_layout_get_pixel_size(hud->layout, &width, &height);
+  width = MAX(width, GTK_SHOT_HUD_FRAMES);
+  y -= height + GTK_SHOT_HUD_SPARKLINE_HEIGHT + PADDING * 3;
+  hud->rect.x = x;
+  hud->rect.y = y;
+  hud->rect.width = width + PADDING * 2;
+  hud->rect.height = height + GTK_SHOT_HUD_SPARKLINE_HEIGHT + PADDING * 3;
+
+  // 走势图的纵轴至少容纳两倍的帧预算
+  gdouble scale = GTK_SHOT_HUD_SPARKLINE_HEIGHT
+                    / MAX(max_frame(hud), GTK_SHOT_HUD_FRAME_BUDGET * 2);
+
+  cairo_save(cr);
+  cairo_set_operator(cr, CAIRO_OPERATOR_OVER);
+  SET_CAIRO_RGBA(cr, 0x000000, 0.7);
+  cairo_rectangle(cr, x, y, hud->rect.width, hud->rect.height);
+  cairo_fill(cr);
+
+  SET_CAIRO_RGB(cr, 0xFFFFFF);
+  cairo_move_to(cr, x + PADDING, y + PADDING);
+  pango_cairo_show_layout(cr, hud->layout);
+
+  draw_sparkline(hud, cr, x + PADDING
+                    , y + height + PADDING * 2
+                        + GTK_SHOT_HUD_SPARKLINE_HEIGHT
+                    , scale);
+  cairo_restore(cr);
+}
+
+gdouble last_frame(GtkShotHud *hud) {
+  if (hud->frame_count == 0) return 0;
+
+  return hud->frames[(hud->frame_pos + GTK_SHOT_HUD_FRAMES - 1)
+                        % GTK_SHOT_HUD_FRAMES];
+}
+
+gdouble max_frame(GtkShotHud *hud) {
+  gdouble max = 0;
+  guint i = 0;
+
+  for (i = 0; i < hud->frame_count; i++) {
+    max = MAX(max, hud->frames[i]);
+  }
+  return max;
+}
+
+/** 走势图以(x, y)为左下角,由旧到新从左向右绘制 */
+void draw_sparkline(GtkShotHud *hud, cairo_t *cr
+                        , gdouble x, gdouble y, gdouble scale) {
+  guint n = hud->frame_count, i = 0;
+  guint first = (hud->frame_pos + GTK_SHOT_HUD_FRAMES - n)
+                  % GTK_SHOT_HUD_FRAMES;
+  gdouble dash = 2.0;
+
+  cairo_set_line_width(cr, 1);
+  SET_CAIRO_RGBA(cr, 0xFFFFFF, 0.5);
+  cairo_set_dash(cr, &dash, 1, 0);
+  cairo_move_to(cr, x, y - GTK_SHOT_HUD_FRAME_BUDGET * scale + 0.5);
+  cairo_rel_line_to(cr, GTK_SHOT_HUD_FRAMES, 0);
+  cairo_stroke(cr);
+  cairo_set_dash(cr, NULL, 0, 0);
+
+  if (n == 0) return;
+
+  SET_CAIRO_RGB(cr, 0x00ff00);
+  for (i = 0; i < n; i++) {
+    gdouble ms = hud->frames[(first + i) % GTK_SHOT_HUD_FRAMES];
+    cairo_line_to(cr, x + GTK_SHOT_HUD_FRAMES - n + i + 0.5
+                    , y - ms * scale);
+  }
+  cairo_stroke(cr);
+}
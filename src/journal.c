@@ -0,0 +1,351 @@
+/*
+ * GtkShot - A screen capture programme using GtkLib
+ * Copyright (C) 2012 flytreeleft @ CrazyDan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <config.h>
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+
+#include <gtk/gtk.h>
+
+#include "utils.h"
+
+#include "journal.h"
+
+#define HEADER_SIZE 8
+
+static gboolean on_event(GtkWidget *widget, GdkEvent *event
+                            , GtkShotJournal *journal);
+static gboolean on_map(GtkWidget *widget, GdkEvent *event
+                          , GtkShotJournal *journal);
+static gboolean on_step(GtkShotJournal *journal);
+static void schedule(GtkShotJournal *journal);
+static void encode_event(GtkShotJournalEvent *e, guchar *buf);
+static void decode_event(const guchar *buf, GtkShotJournalEvent *e);
+static void put16(guchar *buf, guint16 v);
+static void put32(guchar *buf, guint32 v);
+static guint16 get16(const guchar *buf);
+static guint32 get32(const guchar *buf);
+
+GtkShotJournal* gtk_shot_journal_new(GtkWidget *widget) {
+  GtkShotJournal *journal = g_new0(GtkShotJournal, 1);
+
+  journal->widget = widget;
+  journal->events = g_array_new(FALSE, FALSE
+                                  , sizeof(GtkShotJournalEvent));
+  journal->timer = g_timer_new();
+
+  return journal;
+}
+
+void gtk_shot_journal_destroy(GtkShotJournal *journal) {
+  g_return_if_fail(journal != NULL);
+
+  if (journal->handler) {
+    g_signal_handler_disconnect(journal->widget, journal->handler);
+  }
+  if (journal->source) g_source_remove(journal->source);
+  if (journal->file) fclose(journal->file);
+  g_array_free(journal->events, TRUE);
+  g_timer_destroy(journal->timer);
+  g_free(journal);
+}
+
+/** 开始将到达窗口的事件记录到文件filename中 */
+gboolean gtk_shot_journal_record(GtkShotJournal *journal
+                                    , const char *filename
+                                    , GError **error) {
+  g_return_val_if_fail(journal != NULL && filename != NULL, FALSE);
+
+  FILE *file = fopen(filename, "wb");
+  guchar header[HEADER_SIZE];
+
+  if (!file) {
+    g_set_error(error, G_FILE_ERROR
+                  , g_file_error_from_errno(errno)
+                  , "%s: %s", filename, g_strerror(errno));
+    return FALSE;
+  }
+  memcpy(header, GTK_SHOT_JOURNAL_MAGIC, 4);
+  put32(header + 4, GTK_SHOT_JOURNAL_VERSION);
+  fwrite(header, 1, HEADER_SIZE, file);
+
+  if (journal->file) fclose(journal->file);
+  journal->file = file;
+  journal->started = FALSE;
+  journal->recorded = 0;
+  if (!journal->handler) {
+    journal->handler = g_signal_connect(journal->widget, "event"
+                                          , G_CALLBACK(on_event)
+                                          , journal);
+  }
+  return TRUE;
+}
+
+/** 窗口隐藏等时机将已记录的事件写入文件 */
+void gtk_shot_journal_flush(GtkShotJournal *journal) {
+  g_return_if_fail(journal != NULL);
+
+  if (journal->file) fflush(journal->file);
+}
+
+/**
+ * 将文件filename中记录的事件送入窗口,
+ * realtime为TRUE时按记录时的间隔回放,否则每次空闲时回放一个事件
+ * (窗口的重绘优先于空闲回调,故每个事件后均完成重绘).
+ * 回放结束后调用done
+ */
+gboolean gtk_shot_journal_play(GtkShotJournal *journal
+                                  , const char *filename
+                                  , gboolean realtime
+                                  , GtkShotJournalFunc done
+                                  , gpointer data
+                                  , GError **error) {
+  g_return_val_if_fail(journal != NULL && filename != NULL, FALSE);
+
+  gchar *contents = NULL;
+  gsize length = 0, offset = 0;
+
+  if (!g_file_get_contents(filename, &contents, &length, error)) {
+    return FALSE;
+  }
+  if (length < HEADER_SIZE
+        || memcmp(contents, GTK_SHOT_JOURNAL_MAGIC, 4) != 0
+        || get32((guchar*) contents + 4) != GTK_SHOT_JOURNAL_VERSION
+        || (length - HEADER_SIZE) % GTK_SHOT_JOURNAL_EVENT_SIZE != 0) {
+    g_set_error(error, G_FILE_ERROR, G_FILE_ERROR_INVAL
+                  , "%s: not an event journal of version %d"
+                  , filename, GTK_SHOT_JOURNAL_VERSION);
+    g_free(contents);
+    return FALSE;
+  }
+  g_array_set_size(journal->events, 0);
+  for (offset = HEADER_SIZE; offset < length
+          ; offset += GTK_SHOT_JOURNAL_EVENT_SIZE) {
+    GtkShotJournalEvent e;
+    decode_event((guchar*) contents + offset, &e);
+    g_array_append_val(journal->events, e);
+  }
+  g_free(contents);
+
+  journal->next = 0;
+  journal->realtime = realtime;
+  journal->done = done;
+  journal->data = data;
+  if (journal->source) {
+    g_source_remove(journal->source);
+    journal->source = 0;
+  }
+  // 窗口显示后才开始回放
+  if (gtk_widget_get_mapped(journal->widget)) {
+    g_timer_start(journal->timer);
+    schedule(journal);
+  } else {
+    g_signal_connect(journal->widget, "map-event"
+                        , G_CALLBACK(on_map), journal);
+  }
+  return TRUE;
+}
+
+void gtk_shot_journal_report(GtkShotJournal *journal) {
+  g_return_if_fail(journal != NULL);
+
+  if (journal->file) {
+    g_print("journal: %u event(s) recorded\n", journal->recorded);
+  }
+  if (journal->events->len > 0) {
+    g_print("journal: %u/%u event(s) played in %.3f s (%s)\n"
+            , journal->next, journal->events->len
+            , g_timer_elapsed(journal->timer, NULL)
+            , journal->realtime ? "realtime" : "fast");
+  }
+}
+
+gboolean on_event(GtkWidget *widget, GdkEvent *event
+                    , GtkShotJournal *journal) {
+  GtkShotJournalEvent e;
+  guchar buf[GTK_SHOT_JOURNAL_EVENT_SIZE];
+  GdkModifierType state = 0;
+  gdouble x = 0, y = 0;
+  guint32 time = gdk_event_get_time(event);
+
+  switch(event->type) {
+    case GDK_BUTTON_PRESS:
+    case GDK_2BUTTON_PRESS:
+    case GDK_BUTTON_RELEASE:
+    case GDK_MOTION_NOTIFY:
+    case GDK_KEY_PRESS:
+    case GDK_KEY_RELEASE:
+      break;
+    default:
+      return FALSE;
+  }
+  // 回放的事件不再记录
+  if (event->any.send_event || !journal->file) return FALSE;
+  if (!journal->started) {
+    journal->origin = time;
+    journal->started = TRUE;
+  }
+  gdk_event_get_state(event, &state);
+  gdk_event_get_root_coords(event, &x, &y);
+
+  memset(&e, 0, sizeof(e));
+  e.time = time - journal->origin;
+  e.type = event->type;
+  e.state = state & 0xffff;
+  e.x = (gint16) x;
+  e.y = (gint16) y;
+  if (event->type == GDK_KEY_PRESS || event->type == GDK_KEY_RELEASE) {
+    e.keyval = event->key.keyval;
+  } else if (event->type != GDK_MOTION_NOTIFY) {
+    e.button = event->button.button;
+  }
+  encode_event(&e, buf);
+  fwrite(buf, 1, GTK_SHOT_JOURNAL_EVENT_SIZE, journal->file);
+  journal->recorded++;
+
+  return FALSE;
+}
+
+gboolean on_map(GtkWidget *widget, GdkEvent *event
+                  , GtkShotJournal *journal) {
+  g_signal_handlers_disconnect_by_func(widget, G_CALLBACK(on_map)
+                                          , journal);
+  g_timer_start(journal->timer);
+  schedule(journal);
+  return FALSE;
+}
+
+/** 安排下一个事件的回放 */
+void schedule(GtkShotJournal *journal) {
+  if (journal->next >= journal->events->len) {
+    journal->source = 0;
+    g_timer_stop(journal->timer);
+    if (journal->done) journal->done(journal, journal->data);
+    return;
+  }
+  if (journal->realtime) {
+    GtkShotJournalEvent *e = &g_array_index(journal->events
+                                              , GtkShotJournalEvent
+                                              , journal->next);
+    gdouble now = g_timer_elapsed(journal->timer, NULL) * 1000;
+    guint delay = e->time > now ? (guint) (e->time - now) : 0;
+    journal->source = g_timeout_add(delay, (GSourceFunc) on_step
+                                      , journal);
+  } else {
+    journal->source = g_idle_add((GSourceFunc) on_step, journal);
+  }
+}
+
+gboolean on_step(GtkShotJournal *journal) {
+  GtkShotJournalEvent *e = &g_array_index(journal->events
+                                            , GtkShotJournalEvent
+                                            , journal->next);
+  journal->next++;
+  gtk_shot_journal_send(journal, e);
+  schedule(journal);
+
+  return FALSE;
+}
+
+/**
+ * 构造事件并直接送入窗口(基准测试也以此模拟操作),
+ * send_event标记为TRUE,处理函数据此使用事件中的鼠标坐标
+ */
+void gtk_shot_journal_send(GtkShotJournal *journal
+                              , GtkShotJournalEvent *e) {
+  g_return_if_fail(journal != NULL && e != NULL);
+
+  GdkWindow *window = journal->widget->window;
+  GdkEvent *event = NULL;
+  gint ox = 0, oy = 0;
+
+  if (!window) return;
+  gdk_window_get_origin(window, &ox, &oy);
+  event = gdk_event_new((GdkEventType) e->type);
+  event->any.window = g_object_ref(window);
+  event->any.send_event = TRUE;
+  switch(e->type) {
+    case GDK_BUTTON_PRESS:
+    case GDK_2BUTTON_PRESS:
+    case GDK_BUTTON_RELEASE:
+      event->button.time = e->time;
+      event->button.x = e->x - ox;
+      event->button.y = e->y - oy;
+      event->button.x_root = e->x;
+      event->button.y_root = e->y;
+      event->button.state = e->state;
+      event->button.button = e->button;
+      event->button.device = gdk_device_get_core_pointer();
+      break;
+    case GDK_MOTION_NOTIFY:
+      event->motion.time = e->time;
+      event->motion.x = e->x - ox;
+      event->motion.y = e->y - oy;
+      event->motion.x_root = e->x;
+      event->motion.y_root = e->y;
+      event->motion.state = e->state;
+      event->motion.is_hint = FALSE;
+      event->motion.device = gdk_device_get_core_pointer();
+      break;
+    case GDK_KEY_PRESS:
+    case GDK_KEY_RELEASE:
+      event->key.time = e->time;
+      event->key.state = e->state;
+      event->key.keyval = e->keyval;
+      break;
+  }
+  gtk_widget_event(journal->widget, event);
+  gdk_event_free(event);
+}
+
+void encode_event(GtkShotJournalEvent *e, guchar *buf) {
+  put32(buf, e->time);
+  buf[4] = e->type;
+  buf[5] = e->button;
+  put16(buf + 6, e->state);
+  put16(buf + 8, (guint16) e->x);
+  put16(buf + 10, (guint16) e->y);
+  put32(buf + 12, e->keyval);
+}
+
+void decode_event(const guchar *buf, GtkShotJournalEvent *e) {
+  e->time = get32(buf);
+  e->type = buf[4];
+  e->button = buf[5];
+  e->state = get16(buf + 6);
+  e->x = (gint16) get16(buf + 8);
+  e->y = (gint16) get16(buf + 10);
+  e->keyval = get32(buf + 12);
+}
+
+void put16(guchar *buf, guint16 v) {
+  buf[0] = v & 0xff; buf[1] = v >> 8;
+}
+
+void put32(guchar *buf, guint32 v) {
+  put16(buf, v & 0xffff); put16(buf + 2, v >> 16);
+}
+
+guint16 get16(const guchar *buf) {
+  return buf[0] | (buf[1] << 8);
+}
+
+guint32 get32(const guchar *buf) {
+  return get16(buf) | ((guint32) get16(buf + 2) << 16);
+}
@@ -0,0 +1,162 @@
+/*
+ * GtkShot - A screen capture programme using GtkLib
+ * Copyright (C) 2012 flytreeleft @ CrazyDan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <config.h>
+
+#include <string.h>
+
+#include <gtk/gtk.h>
+
+#include "utils.h"
+
+#include "loupe.h"
+
+/* The color of the pixels out of the screenshot */
+#define OUTER_PIXEL 0xff808080
+
+static void sample(GtkShotLoupe *loupe, GdkPixbuf *pixbuf
+                      , gint x, gint y);
+static void place(GtkShotLoupe *loupe, gint x, gint y
+                    , GdkRectangle *bounds);
+
+GtkShotLoupe* gtk_shot_loupe_new() {
+  GtkShotLoupe *loupe = g_new(GtkShotLoupe, 1);
+
+  loupe->surface =
+      cairo_image_surface_create(CAIRO_FORMAT_ARGB32
+                                  , GTK_SHOT_LOUPE_SIZE
+                                  , GTK_SHOT_LOUPE_SIZE);
+  loupe->rect.x = loupe->rect.y = 0;
+  loupe->rect.width = loupe->rect.height =
+                  GTK_SHOT_LOUPE_SIZE + 2 * GTK_SHOT_LOUPE_BORDER;
+  loupe->visible = FALSE;
+
+  return loupe;
+}
+
+void gtk_shot_loupe_destroy(GtkShotLoupe *loupe) {
+  g_return_if_fail(loupe != NULL);
+
+  cairo_surface_destroy(loupe->surface);
+  g_free(loupe);
+}
+
+/**
+ * 放大截图(原点为屏幕坐标(ox, oy))中(x, y)附近的区域,
+ * 并将放大镜放在鼠标右下方,超出bounds时移到另一侧
+ */
+void gtk_shot_loupe_update(GtkShotLoupe *loupe, GdkPixbuf *pixbuf
+                              , gint ox, gint oy
+                              , gint x, gint y
+                              , GdkRectangle *bounds) {
+  g_return_if_fail(loupe != NULL && pixbuf != NULL);
+
+  sample(loupe, pixbuf, x - ox, y - oy);
+  place(loupe, x, y, bounds);
+  loupe->visible = TRUE;
+}
+
+void gtk_shot_loupe_hide(GtkShotLoupe *loupe) {
+  g_return_if_fail(loupe != NULL);
+
+  loupe->visible = FALSE;
+}
+
+/** 绘制放大镜,cr需使用屏幕坐标 */
+void gtk_shot_loupe_draw(GtkShotLoupe *loupe, cairo_t *cr, gint color) {
+  g_return_if_fail(loupe != NULL);
+
+  if (!loupe->visible) return;
+
+  gint b = GTK_SHOT_LOUPE_BORDER;
+  gint x = loupe->rect.x + b, y = loupe->rect.y + b;
+  gint center = GTK_SHOT_LOUPE_RADIUS * GTK_SHOT_LOUPE_ZOOM;
+
+  cairo_save(cr);
+  cairo_set_operator(cr, CAIRO_OPERATOR_OVER);
+  cairo_set_source_surface(cr, loupe->surface, x, y);
+  cairo_rectangle(cr, x, y, GTK_SHOT_LOUPE_SIZE, GTK_SHOT_LOUPE_SIZE);
+  cairo_fill(cr);
+
+  cairo_set_line_width(cr, b);
+  SET_CAIRO_RGB(cr, 0x232126);
+  cairo_rectangle(cr, x - b / 2.0, y - b / 2.0
+                    , GTK_SHOT_LOUPE_SIZE + b
+                    , GTK_SHOT_LOUPE_SIZE + b);
+  cairo_stroke(cr);
+  // 标出鼠标所在的像素
+  cairo_set_line_width(cr, 1);
+  SET_CAIRO_RGB(cr, color);
+  cairo_rectangle(cr, x + center + 0.5, y + center + 0.5
+                    , GTK_SHOT_LOUPE_ZOOM - 1, GTK_SHOT_LOUPE_ZOOM - 1);
+  cairo_stroke(cr);
+  cairo_restore(cr);
+}
+
+/**
+ * 最近邻放大: 每个源像素先展开为目标画布中的一段,
+ * 再将整行复制GTK_SHOT_LOUPE_ZOOM次
+ */
+void sample(GtkShotLoupe *loupe, GdkPixbuf *pixbuf, gint x, gint y) {
+  gint width = gdk_pixbuf_get_width(pixbuf);
+  gint height = gdk_pixbuf_get_height(pixbuf);
+  gint n_channels = gdk_pixbuf_get_n_channels(pixbuf);
+  gint rowstride = gdk_pixbuf_get_rowstride(pixbuf);
+  const guchar *pixels = gdk_pixbuf_get_pixels(pixbuf);
+  gint stride = cairo_image_surface_get_stride(loupe->surface);
+  guchar *data = NULL;
+  gint i = 0, j = 0, k = 0;
+
+  cairo_surface_flush(loupe->surface);
+  data = cairo_image_surface_get_data(loupe->surface);
+  for (j = 0; j <= GTK_SHOT_LOUPE_RADIUS * 2; j++) {
+    guint32 *row = (guint32*) (data + j * GTK_SHOT_LOUPE_ZOOM * stride);
+    gint sy = y - GTK_SHOT_LOUPE_RADIUS + j;
+
+    for (i = 0; i <= GTK_SHOT_LOUPE_RADIUS * 2; i++) {
+      gint sx = x - GTK_SHOT_LOUPE_RADIUS + i;
+      guint32 pixel = OUTER_PIXEL;
+
+      if (sx >= 0 && sx < width && sy >= 0 && sy < height) {
+        const guchar *p = pixels + sy * rowstride + sx * n_channels;
+        pixel = 0xff000000 | (p[0] << 16) | (p[1] << 8) | p[2];
+      }
+      for (k = 0; k < GTK_SHOT_LOUPE_ZOOM; k++) {
+        *row++ = pixel;
+      }
+    }
+    row = (guint32*) (data + j * GTK_SHOT_LOUPE_ZOOM * stride);
+    for (k = 1; k < GTK_SHOT_LOUPE_ZOOM; k++) {
+      memcpy(data + (j * GTK_SHOT_LOUPE_ZOOM + k) * stride
+              , row, GTK_SHOT_LOUPE_SIZE * sizeof(guint32));
+    }
+  }
+  cairo_surface_mark_dirty(loupe->surface);
+}
+
+void place(GtkShotLoupe *loupe, gint x, gint y, GdkRectangle *bounds) {
+  gint size = loupe->rect.width;
+
+  loupe->rect.x = x + GTK_SHOT_LOUPE_OFFSET;
+  loupe->rect.y = y + GTK_SHOT_LOUPE_OFFSET;
+  if (loupe->rect.x + size > bounds->x + bounds->width) {
+    loupe->rect.x = x - GTK_SHOT_LOUPE_OFFSET - size;
+  }
+  if (loupe->rect.y + size > bounds->y + bounds->height) {
+    loupe->rect.y = y - GTK_SHOT_LOUPE_OFFSET - size;
+  }
+}
@@ -22,74 +22,612 @@
 #include <signal.h>
 #include <errno.h>
 #include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
 
 #include <gtk/gtk.h>
 #include <glib/gi18n.h>
 
 #include "utils.h"
+#include "trace.h"
 #include "xpm.h"
 
 #include "shot.h"
+#include "replay.h"
+#include "journal.h"
+#include "watchdog.h"
+#include "control.h"
+#include "memory.h"
+#include "hotkey.h"
 
 #define WAKE_UP_SIGNAL    SIGUSR1
+#define REPLAY_SIGNAL    SIGUSR2
+#define TRACE_SIGNAL    (SIGRTMIN + 1)
 #define LOCK_FILE ("/tmp/gtkshot.lock")
 
+/** 信号处理函数写入自管道的消息,由主循环处理 */
+typedef struct _SignalMessage {
+  gint signo;
+  gint value; // sigqueue附带的值,未附带时为0
+} SignalMessage;
+
+/* The actions bound to global hotkeys */
+enum {
+  HOTKEY_REGION = 0, // 截取区域(显示截图窗口)
+  HOTKEY_SCREEN, // 截取整个显示器到剪贴板
+  HOTKEY_REPEAT, // 重复截取上次保存的选区
+  HOTKEY_RECORD, // 导出即时回放
+  HOTKEY_ACTIONS
+};
+
 static GtkShot *shot = NULL;
+static GtkShotReplay *replay = NULL;
+static GtkShotJournal *journal = NULL;
+static GtkShotWatchdog *watchdog = NULL;
+static gint signal_pipe[2] = {-1, -1};
+static GtkShotControl *control = NULL;
+static GtkShotHotkeys *hotkeys = NULL;
+
+static gint replay_seconds = 0;
+static gint replay_budget = GTK_SHOT_REPLAY_BUDGET;
+static gint replay_back = -1;
+static gboolean replay_export = FALSE;
+static gchar *window_id = NULL;
+static gchar *record_events = NULL;
+static gchar *play_events = NULL;
+static gboolean play_realtime = FALSE;
+static gchar *trace_file = NULL;
+static gboolean dump_trace = FALSE;
+static gchar *trace_path = NULL; // 收到信号时导出追踪的文件
+static gint watchdog_threshold = 0;
+static gboolean show_memory = FALSE;
+static gboolean release_memory = FALSE;
+static gint idle_timeout = GTK_SHOT_IDLE_TIMEOUT;
+static gboolean idle_compress = FALSE;
+static gboolean daemon_mode = FALSE;
+static gchar *control_command = NULL;
+static gchar *hotkey_accels[HOTKEY_ACTIONS] = {NULL};
+static const gchar *hotkey_names[HOTKEY_ACTIONS] = {
+  "region", "screen", "repeat", "record"
+};
+static gint64 hotkey_pressed = 0; // 等待截图窗口绘制的热键的按下时间
+static guint hotkey_action = 0;
+
+static GOptionEntry entries[] = {
+  {"replay", 0, 0, G_OPTION_ARG_INT, &replay_seconds
+    , N_("keep the screen of the last SECONDS seconds for instant replay")
+    , N_("SECONDS")},
+  {"replay-budget", 0, 0, G_OPTION_ARG_INT, &replay_budget
+    , N_("memory budget of instant replay")
+    , N_("MIB")},
+  {"replay-back", 0, 0, G_OPTION_ARG_INT, &replay_back
+    , N_("capture the screen of SECONDS seconds ago")
+    , N_("SECONDS")},
+  {"replay-export", 0, 0, G_OPTION_ARG_NONE, &replay_export
+    , N_("export the instant replay as PNG images to home directory")
+    , NULL},
+  {"window", 0, 0, G_OPTION_ARG_STRING, &window_id
+    , N_("capture the window even if it is covered")
+    , N_("ID")},
+  {"record-events", 0, 0, G_OPTION_ARG_FILENAME, &record_events
+    , N_("record mouse and key events of capture window to FILE")
+    , N_("FILE")},
+  {"play-events", 0, 0, G_OPTION_ARG_FILENAME, &play_events
+    , N_("play events recorded in FILE as fast as possible and exit")
+    , N_("FILE")},
+  {"play-realtime", 0, 0, G_OPTION_ARG_NONE, &play_realtime
+    , N_("play events with their recorded intervals")
+    , NULL},
+  {"trace", 0, 0, G_OPTION_ARG_FILENAME, &trace_file
+    , N_("dump the trace to FILE on exit or on signal")
+    , N_("FILE")},
+  {"dump-trace", 0, 0, G_OPTION_ARG_NONE, &dump_trace
+    , N_("let the running process dump its trace")
+    , NULL},
+  {"watchdog", 0, 0, G_OPTION_ARG_INT, &watchdog_threshold
+    , N_("report main loop stalls longer than MS milliseconds on exit"
+            " or on --control watchdog")
+    , N_("MS")},
+  {"memory", 0, 0, G_OPTION_ARG_NONE, &show_memory
+    , N_("print the memory usage of the running process")
+    , NULL},
+  {"release", 0, 0, G_OPTION_ARG_NONE, &release_memory
+    , N_("let the running process release its capture now")
+    , NULL},
+  {"idle-timeout", 0, 0, G_OPTION_ARG_INT, &idle_timeout
+    , N_("release the capture SECONDS seconds after hiding, 0 to keep it")
+    , N_("SECONDS")},
+  {"idle-compress", 0, 0, G_OPTION_ARG_NONE, &idle_compress
+    , N_("keep the released capture compressed instead of dropping it")
+    , NULL},
+  {"daemon", 0, 0, G_OPTION_ARG_NONE, &daemon_mode
+    , N_("stay resident without showing the capture window")
+    , NULL},
+  {"control", 0, 0, G_OPTION_ARG_STRING, &control_command
+    , N_("send COMMAND (show, hide, memory, release or watchdog)"
+            " to the running process")
+    , N_("COMMAND")},
+  {"hotkey-region", 0, 0, G_OPTION_ARG_STRING, &hotkey_accels[HOTKEY_REGION]
+    , N_("global hotkey to capture a region, e.g. \"<Control><Alt>a\"")
+    , N_("ACCEL")},
+  {"hotkey-screen", 0, 0, G_OPTION_ARG_STRING, &hotkey_accels[HOTKEY_SCREEN]
+    , N_("global hotkey to copy the monitor under pointer to clipboard")
+    , N_("ACCEL")},
+  {"hotkey-repeat", 0, 0, G_OPTION_ARG_STRING, &hotkey_accels[HOTKEY_REPEAT]
+    , N_("global hotkey to capture the last saved region again")
+    , N_("ACCEL")},
+  {"hotkey-record", 0, 0, G_OPTION_ARG_STRING, &hotkey_accels[HOTKEY_RECORD]
+    , N_("global hotkey to export the instant replay")
+    , N_("ACCEL")},
+  {NULL}
+};
 
-static void wake_up(gint signo);
-static void exit_clean(gint signo);
+static void on_signal(gint signo, siginfo_t *info, void *context);
+static gboolean on_signal_message(GIOChannel *channel
+                                    , GIOCondition condition
+                                    , gpointer data);
+static void open_signal_pipe();
+static void wake_up(gint xid);
+static void on_replay(gint seconds);
+static void on_trace();
+static void on_shot_show(GtkWidget *widget, gpointer data);
+static void on_shot_hide(GtkWidget *widget, gpointer data);
+static void on_watchdog_show(GtkWidget *widget, gpointer data);
+static void on_watchdog_hide(GtkWidget *widget, gpointer data);
+static void on_journal_hide(GtkWidget *widget, gpointer data);
+static void on_journal_done(GtkShotJournal *journal, gpointer data);
+static void on_hotkey(guint action, gpointer data);
+static gboolean on_hotkey_expose(GtkWidget *widget, GdkEvent *event
+                                    , gpointer data);
+static void bind_hotkeys();
+static void export_replay();
+static gchar* on_control(const gchar *command, gpointer data);
+static gint query_process(const gchar *command);
+static gint notify_process(gint pid);
+static void show_shot(GdkNativeWindow xid);
+static GdkNativeWindow parse_window_id();
 static void quit();
 static void save_to_clipboard();
 static void remove_lock_file();
 static gint new_lock_file();
 
 int main(int argc, char *argv[]) {
+#ifdef GTK_SHOT_DEBUG
+  if (!gtk_shot_alloc_counter_install()) {
+    g_warning("heap allocations can not be counted on this libc");
+  }
+#endif
+  gtk_shot_trace_set_thread_name("main");
 #ifdef ENABLE_NLS
   bindtextdomain(GETTEXT_PACKAGE, PACKAGE_LOCALE_DIR);
   bind_textdomain_codeset(GETTEXT_PACKAGE, "UTF-8");
   textdomain(GETTEXT_PACKAGE);
 #endif
 
+  // 仅解析自身的参数,GTK的参数留给gtk_init处理
+  GError *error = NULL;
+  GOptionContext *context = g_option_context_new(NULL);
+  g_option_context_add_main_entries(context, entries, GETTEXT_PACKAGE);
+  g_option_context_set_ignore_unknown_options(context, TRUE);
+  if (!g_option_context_parse(context, &argc, &argv, &error)) {
+    g_printerr("%s\n", error->message);
+    exit(-1);
+  }
+  g_option_context_free(context);
+  // 预先确定文件名,每次导出均写入同一文件
+  if (trace_file) {
+    trace_path = g_strdup(trace_file);
+  } else {
+    gchar *name = g_strdup_printf("gtkshot-trace-%d.json", getpid());
+    trace_path = g_build_filename(g_get_tmp_dir(), name, NULL);
+    g_free(name);
+  }
+  // 查询已存在的进程,不启动新进程
+  if (control_command) {
+    exit(query_process(control_command));
+  } else if (show_memory || release_memory) {
+    exit(query_process(release_memory ? "release" : "memory"));
+  }
+
   gint pid = new_lock_file();
 
   if (pid > 0) {
-    if (kill(pid, WAKE_UP_SIGNAL) == 0) {
+    if (notify_process(pid) == 0) {
       exit(0); // 进程确已存在,则退出新进程
     } else { // 否则,重新创建锁定文件
       remove_lock_file();
       new_lock_file();
     }
   }
-  signal(WAKE_UP_SIGNAL, wake_up);
-  signal(SIGINT, exit_clean);
+  // 信号处理函数中仅写入自管道,截屏等在主循环中进行
+  open_signal_pipe();
+  struct sigaction act;
+  memset(&act, 0, sizeof(act));
+  act.sa_flags = SA_SIGINFO | SA_RESTART;
+  act.sa_sigaction = on_signal;
+  sigaction(WAKE_UP_SIGNAL, &act, NULL);
+  sigaction(REPLAY_SIGNAL, &act, NULL);
+  sigaction(TRACE_SIGNAL, &act, NULL);
+  // 退出时需停止监测线程(持有其锁),不可在信号处理函数中进行
+  sigaction(SIGINT, &act, NULL);
 
+  // 边缘索引等在后台线程中计算
+  if (!g_thread_supported()) g_thread_init(NULL);
   gtk_init(&argc, &argv);
 
   shot = gtk_shot_new();
   shot->quit = quit;
   shot->dblclick = save_to_clipboard;
+  gtk_shot_set_idle_policy(shot, MAX(idle_timeout, 0), idle_compress);
 
   gtk_window_set_title(GTK_WINDOW(shot), GTK_SHOT_NAME);
   GdkPixbuf *icon = gdk_pixbuf_new_from_xpm_data(gtkshot_xpm);
   gtk_window_set_icon(GTK_WINDOW(shot), icon);
   g_object_unref(icon);
 
-  gtk_shot_show(shot, TRUE);
+  gchar *control_path = gtk_shot_control_get_default_path();
+  control = gtk_shot_control_new(control_path, on_control, NULL, &error);
+  if (!control) {
+    // 无控制端口时仍可通过信号唤醒
+    g_printerr("%s\n", error->message);
+    g_clear_error(&error);
+  }
+  g_free(control_path);
+  bind_hotkeys();
+
+  if (replay_seconds > 0) {
+    replay = gtk_shot_replay_new(gdk_get_default_root_window()
+                                    , replay_seconds, replay_budget);
+    gtk_shot_memory_add_probe(GTK_SHOT_MEMORY_REPLAY
+                          , (GtkShotMemoryProbe) gtk_shot_replay_get_memory
+                          , replay);
+    // 截图窗口显示期间暂停采样,防止截取到窗口自身
+    g_signal_connect(shot, "show", G_CALLBACK(on_shot_show), NULL);
+    g_signal_connect(shot, "hide", G_CALLBACK(on_shot_hide), NULL);
+  }
+  if (record_events || play_events) {
+    journal = gtk_shot_journal_new(GTK_WIDGET(shot));
+    if (record_events
+          && !gtk_shot_journal_record(journal, record_events, &error)) {
+      g_printerr("%s\n", error->message);
+      exit(-1);
+    }
+    if (play_events
+          && !gtk_shot_journal_play(journal, play_events, play_realtime
+                                      , on_journal_done, NULL, &error)) {
+      g_printerr("%s\n", error->message);
+      exit(-1);
+    }
+    g_signal_connect(shot, "hide", G_CALLBACK(on_journal_hide), NULL);
+  }
+  if (watchdog_threshold > 0) {
+    // 仅在截图窗口显示期间监测,隐藏后不再唤醒进程
+    watchdog = gtk_shot_watchdog_new(watchdog_threshold);
+    g_signal_connect(shot, "show", G_CALLBACK(on_watchdog_show), NULL);
+    g_signal_connect(shot, "hide", G_CALLBACK(on_watchdog_hide), NULL);
+  }
+  // 常驻时没有周期性的定时器或轮询(即时回放除外),
+  // 仅在收到信号,控制端口的命令,全局热键或屏幕布局变化(RandR)时被唤醒
+  if (!daemon_mode) show_shot(parse_window_id());
   gtk_main();
 
   return 0;
 }
 
-void wake_up(gint signo) {
-  gtk_shot_show(shot, TRUE);
+/**
+ * 信号处理函数: 仅将信号及其附带的值写入自管道(异步信号安全).
+ * 管道已满时丢弃该信号
+ */
+void on_signal(gint signo, siginfo_t *info, void *context) {
+  SignalMessage msg = {.signo = signo, .value = 0};
+  gint saved = errno;
+
+  if (info->si_code == SI_QUEUE) msg.value = info->si_value.sival_int;
+  if (write(signal_pipe[1], &msg, sizeof(msg)) < 0) {
+    // 无法在信号处理函数中报告错误
+  }
+  errno = saved;
+}
+
+/** 在主循环中处理信号 */
+gboolean on_signal_message(GIOChannel *channel
+                              , GIOCondition condition
+                              , gpointer data) {
+  SignalMessage msg;
+
+  // 消息小于PIPE_BUF,写入和读取均为原子操作
+  while (read(signal_pipe[0], &msg, sizeof(msg)) == sizeof(msg)) {
+    if (msg.signo == WAKE_UP_SIGNAL) {
+      wake_up(msg.value);
+    } else if (msg.signo == REPLAY_SIGNAL) {
+      on_replay(msg.value);
+    } else if (msg.signo == TRACE_SIGNAL) {
+      on_trace();
+    } else if (msg.signo == SIGINT) {
+      quit();
+    }
+  }
+  return TRUE;
+}
+
+/** 创建非阻塞的自管道,并在主循环中监听其读端 */
+void open_signal_pipe() {
+  gint i = 0;
+
+  if (pipe(signal_pipe) != 0) {
+    g_printerr("create signal pipe failed: %s\n", g_strerror(errno));
+    exit(-1);
+  }
+  for (i = 0; i < 2; i++) {
+    fcntl(signal_pipe[i], F_SETFL
+            , fcntl(signal_pipe[i], F_GETFL) | O_NONBLOCK);
+    fcntl(signal_pipe[i], F_SETFD, FD_CLOEXEC);
+  }
+  GIOChannel *channel = g_io_channel_unix_new(signal_pipe[0]);
+  g_io_add_watch(channel, G_IO_IN, on_signal_message, NULL);
+  g_io_channel_unref(channel);
+}
+
+/** xid不为0时,为需截取的窗口 */
+void wake_up(gint xid) {
+  show_shot((GdkNativeWindow) xid);
   debug("GtkShot has been wake up...\n");
 }
 
-void exit_clean(gint signo) {
+/**
+ * 即时回放: seconds为回溯的秒数,
+ * 为负数时导出全部画面
+ */
+void on_replay(gint seconds) {
+  if (!replay) {
+    show_shot(0);
+    return;
+  }
+  if (seconds < 0) {
+    export_replay();
+  } else {
+    GdkPixbuf *pixbuf = gtk_shot_replay_get_frame(replay, seconds);
+    if (pixbuf) {
+      gtk_shot_show_pixbuf(shot, pixbuf);
+      g_object_unref(pixbuf);
+    } else {
+      show_shot(0);
+    }
+  }
+  gtk_shot_replay_report(replay);
+}
+
+/** 将即时回放的全部画面导出到主目录下 */
+void export_replay() {
+  GError *error = NULL;
+  gchar *name = g_strdup_printf("gtkshot-replay-%ld", (long) time(NULL));
+  gchar *dir = g_build_filename(g_get_home_dir(), name, NULL);
+  gint count = gtk_shot_replay_export(replay, dir, &error);
+
+  if (count < 0) {
+    g_printerr("export instant replay failed: %s\n", error->message);
+    g_error_free(error);
+  } else {
+    g_print("export %d frame(s) to [%s]...\n", count, dir);
+  }
+  g_free(dir);
+  g_free(name);
+}
+
+/** 绑定参数中指定的全局热键,绑定失败不影响其他热键 */
+void bind_hotkeys() {
+  GError *error = NULL;
+  guint i = 0;
+
+  for (i = 0; i < HOTKEY_ACTIONS; i++) {
+    if (!hotkey_accels[i]) continue;
+    if (!hotkeys) {
+      hotkeys = gtk_shot_hotkeys_new(gdk_get_default_root_window()
+                                        , on_hotkey, NULL);
+      // 在截图窗口绘制完成后记录热键的响应延时
+      g_signal_connect_after(shot, "expose-event"
+                                , G_CALLBACK(on_hotkey_expose), NULL);
+    }
+    if (!gtk_shot_hotkeys_bind(hotkeys, i, hotkey_accels[i], &error)) {
+      g_printerr("%s\n", error->message);
+      g_clear_error(&error);
+    }
+  }
+}
+
+/**
+ * 热键直接在常驻进程中截屏,
+ * 不显示截图窗口的动作在完成时记录延时
+ */
+void on_hotkey(guint action, gpointer data) {
+  gdouble ms = 0;
+
+  // 截图窗口显示期间仅响应导出即时回放
+  if (gtk_shot_visible(shot) && action != HOTKEY_RECORD) return;
+  switch (action) {
+    case HOTKEY_REGION:
+      show_shot(0);
+      break;
+    case HOTKEY_REPEAT:
+      if (watchdog) gtk_shot_watchdog_start(watchdog);
+      gtk_shot_show_last_section(shot);
+      break;
+    case HOTKEY_SCREEN:
+      gtk_shot_save_screen_to_clipboard(shot);
+      break;
+    case HOTKEY_RECORD:
+      if (replay) {
+        export_replay();
+      } else {
+        g_printerr("instant replay is not enabled, see --replay\n");
+      }
+      break;
+  }
+  if (action == HOTKEY_REGION || action == HOTKEY_REPEAT) {
+    hotkey_pressed = hotkeys->pressed;
+    hotkey_action = action;
+  } else {
+    ms = (gtk_shot_trace_time() - hotkeys->pressed) / 1e6;
+    g_print("hotkey %s: %.1f ms\n", hotkey_names[action], ms);
+  }
+}
+
+gboolean on_hotkey_expose(GtkWidget *widget, GdkEvent *event
+                            , gpointer data) {
+  if (hotkey_pressed) {
+    gdouble ms = (gtk_shot_trace_time() - hotkey_pressed) / 1e6;
+
+    g_print("hotkey %s: %.1f ms to overlay\n"
+              , hotkey_names[hotkey_action], ms);
+    trace_message("hotkey", "%s %.1f ms"
+                    , hotkey_names[hotkey_action], ms);
+    hotkey_pressed = 0;
+  }
+  return FALSE;
+}
+
+/** 导出追踪(格式化浮点数并非异步信号安全,故在主循环中进行) */
+void on_trace() {
+  GError *error = NULL;
+
+  if (!gtk_shot_trace_dump(trace_path, &error)) {
+    g_printerr("%s\n", error->message);
+    g_error_free(error);
+  }
+}
+
+void on_shot_show(GtkWidget *widget, gpointer data) {
+  gtk_shot_replay_stop(replay);
+}
+
+void on_shot_hide(GtkWidget *widget, gpointer data) {
+  gtk_shot_replay_start(replay);
+}
+
+void on_watchdog_show(GtkWidget *widget, gpointer data) {
+  gtk_shot_watchdog_start(watchdog);
+}
+
+void on_watchdog_hide(GtkWidget *widget, gpointer data) {
+  gtk_shot_watchdog_stop(watchdog);
+}
+
+void on_journal_hide(GtkWidget *widget, gpointer data) {
+  gtk_shot_journal_flush(journal);
+}
+
+/** 事件回放结束后退出,便于在脚本中重现操作 */
+void on_journal_done(GtkShotJournal *journal, gpointer data) {
   quit();
 }
 
+/** 控制端口的命令 */
+gchar* on_control(const gchar *command, gpointer data) {
+  if (strcmp(command, "memory") == 0) {
+    return gtk_shot_memory_report();
+  } else if (strcmp(command, "show") == 0) {
+    show_shot(0);
+    return g_strdup("ok\n");
+  } else if (strcmp(command, "hide") == 0) {
+    gtk_shot_hide(shot);
+    return g_strdup("ok\n");
+  } else if (strcmp(command, "release") == 0) {
+    // 立即释放缓存,便于对比释放前后的内存
+    gtk_shot_release(shot);
+    return gtk_shot_memory_report();
+  } else if (strcmp(command, "watchdog") == 0) {
+    // 常驻进程无需退出即可查看卡顿的分布
+    if (!watchdog) {
+      return g_strdup("watchdog is not enabled, see --watchdog\n");
+    }
+    return gtk_shot_watchdog_report(watchdog);
+  }
+  return g_strdup_printf("unknown command: %s\n", command);
+}
+
+/**
+ * 通过控制端口向已存在的进程发送命令并打印应答
+ * @return 进程的退出码
+ */
+gint query_process(const gchar *command) {
+  GError *error = NULL;
+  gchar *path = gtk_shot_control_get_default_path();
+  gchar *reply = gtk_shot_control_send(path, command, &error);
+
+  g_free(path);
+  if (!reply) {
+    g_printerr("no running GtkShot: %s\n", error->message);
+    g_error_free(error);
+    return -1;
+  }
+  g_print("%s", reply);
+  g_free(reply);
+
+  return 0;
+}
+
+/** 通知已存在的进程显示截图窗口或处理即时回放 */
+gint notify_process(gint pid) {
+  union sigval value;
+
+  if (dump_trace) {
+    return kill(pid, TRACE_SIGNAL);
+  } else if (replay_export || replay_back >= 0) {
+    value.sival_int = replay_export ? -1 : replay_back;
+    return sigqueue(pid, REPLAY_SIGNAL, value);
+  } else if (parse_window_id()) {
+    // X窗口ID仅使用低29位,可直接作为整数传递
+    value.sival_int = (gint) parse_window_id();
+    return sigqueue(pid, WAKE_UP_SIGNAL, value);
+  }
+  return kill(pid, WAKE_UP_SIGNAL);
+}
+
+/**
+ * 截屏并显示截图窗口,xid不为0时截取该窗口.
+ * 截屏在窗口显示之前进行,故提前启动卡顿监测
+ */
+void show_shot(GdkNativeWindow xid) {
+  if (watchdog) gtk_shot_watchdog_start(watchdog);
+  if (xid) {
+    gtk_shot_show_window(shot, xid);
+  } else {
+    gtk_shot_show(shot, TRUE);
+  }
+}
+
+/** 窗口ID可为十进制或十六进制(0x开头),如xwininfo的输出 */
+GdkNativeWindow parse_window_id() {
+  return window_id ? (GdkNativeWindow) strtoul(window_id, NULL, 0) : 0;
+}
+
 void quit() {
+  if (journal) {
+    gtk_shot_journal_flush(journal);
+    gtk_shot_journal_report(journal);
+  }
+  if (watchdog) {
+    gtk_shot_watchdog_stop(watchdog);
+    gchar *report = gtk_shot_watchdog_report(watchdog);
+    g_print("%s", report);
+    g_free(report);
+  }
+  if (trace_file) {
+    GError *error = NULL;
+    if (!gtk_shot_trace_dump(trace_file, &error)) {
+      g_printerr("%s\n", error->message);
+      g_error_free(error);
+    }
+  }
+  if (control) {
+    gtk_shot_control_destroy(control);
+    control = NULL;
+  }
+  if (hotkeys) {
+    gtk_shot_hotkeys_destroy(hotkeys);
+    hotkeys = NULL;
+  }
   debug("GtkShot has exit" \
                   ", you will not get shot image any more...\n");
 
@@ -111,7 +649,7 @@ void remove_lock_file() {
   if (remove(LOCK_FILE) == 0) {
     debug("clean lock file [%s] successfully...\n", LOCK_FILE);
   } else {
-    debug("can not remove lock file [%s]: %s" \
+    g_printerr("can not remove lock file [%s]: %s" \
               ", please remove it by yourself...\n"
                                   , LOCK_FILE, strerror(errno));
   }
@@ -142,7 +680,7 @@ gint new_lock_file() {
 #endif
     pid = 0;
   } else {
-    debug("no lock file and create lock file failed[%s]: %s\n"
+    g_printerr("no lock file and create lock file failed[%s]: %s\n"
                                 , LOCK_FILE, strerror(errno));
     exit(-1);
   }
@@ -0,0 +1,144 @@
+/*
+ * GtkShot - A screen capture programme using GtkLib
+ * Copyright (C) 2012 flytreeleft @ CrazyDan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <config.h>
+
+#include <stdio.h>
+#include <unistd.h>
+
+#include <glib.h>
+
+#include "memory.h"
+
+typedef struct _Probe {
+  GtkShotMemoryCategory category;
+  GtkShotMemoryProbe probe;
+  gpointer data;
+} Probe;
+
+static const gchar *names[GTK_SHOT_MEMORY_CATEGORIES] = {
+  "capture", "overlay", "doodle", "pens", "layouts", "encoder", "replay"
+};
+
+static GSList *probes = NULL;
+static gsize current[GTK_SHOT_MEMORY_CATEGORIES];
+static gsize peak[GTK_SHOT_MEMORY_CATEGORIES];
+// 各类别之和的峰值
+static gsize total_peak = 0;
+// 最近一次释放缓存前后的常驻内存,未释放过时均为0
+static gsize release_before = 0, release_after = 0;
+
+/** 同一类别可有多个探针,采样时累加 */
+void gtk_shot_memory_add_probe(GtkShotMemoryCategory category
+                                  , GtkShotMemoryProbe probe
+                                  , gpointer data) {
+  g_return_if_fail(category < GTK_SHOT_MEMORY_CATEGORIES && probe);
+
+  Probe *p = g_new(Probe, 1);
+  p->category = category;
+  p->probe = probe;
+  p->data = data;
+  probes = g_slist_append(probes, p);
+}
+
+/** 移除以data注册的所有探针(如对象销毁时) */
+void gtk_shot_memory_remove_probes(gpointer data) {
+  GSList *l = probes, *next = NULL;
+
+  for (l; l; l = next) {
+    next = l->next;
+    if (((Probe*) l->data)->data == data) {
+      g_free(l->data);
+      probes = g_slist_delete_link(probes, l);
+    }
+  }
+}
+
+void gtk_shot_memory_sample() {
+  gsize total = 0;
+  gint i = 0;
+  GSList *l = probes;
+
+  for (i = 0; i < GTK_SHOT_MEMORY_CATEGORIES; i++) {
+    current[i] = 0;
+  }
+  for (l; l; l = l->next) {
+    Probe *p = (Probe*) l->data;
+    current[p->category] += p->probe(p->data);
+  }
+  for (i = 0; i < GTK_SHOT_MEMORY_CATEGORIES; i++) {
+    peak[i] = MAX(peak[i], current[i]);
+    total += current[i];
+  }
+  total_peak = MAX(total_peak, total);
+}
+
+/** 最近一次采样的字节数,peak不为NULL时同时返回其峰值 */
+gsize gtk_shot_memory_get(GtkShotMemoryCategory category, gsize *max) {
+  g_return_val_if_fail(category < GTK_SHOT_MEMORY_CATEGORIES, 0);
+
+  if (max) *max = peak[category];
+  return current[category];
+}
+
+/** 记录释放缓存前后的常驻内存(字节),在报告中列出 */
+void gtk_shot_memory_note_release(gsize before, gsize after) {
+  release_before = before;
+  release_after = after;
+}
+
+/**
+ * 采样并返回各类别当前和峰值的大小(KiB),
+ * 以及最近一次释放缓存前后的常驻内存,返回的文本需释放
+ */
+gchar* gtk_shot_memory_report() {
+  GString *report = g_string_new(NULL);
+  gsize total = 0;
+  gint i = 0;
+
+  gtk_shot_memory_sample();
+  g_string_append_printf(report, "%-8s %12s %12s\n"
+                            , "memory", "current KiB", "peak KiB");
+  for (i = 0; i < GTK_SHOT_MEMORY_CATEGORIES; i++) {
+    g_string_append_printf(report, "%-8s %12.1f %12.1f\n", names[i]
+                              , current[i] / 1024.0, peak[i] / 1024.0);
+    total += current[i];
+  }
+  g_string_append_printf(report, "%-8s %12.1f %12.1f\n", "total"
+                            , total / 1024.0, total_peak / 1024.0);
+  g_string_append_printf(report, "%-8s %12.1f\n", "rss"
+                            , gtk_shot_memory_get_rss() / 1024.0);
+  if (release_before > 0) {
+    g_string_append_printf(report, "%-8s %12.1f -> %.1f KiB rss\n"
+                              , "released", release_before / 1024.0
+                              , release_after / 1024.0);
+  }
+
+  return g_string_free(report, FALSE);
+}
+
+/** 进程的常驻内存(字节),含未统计的部分(如GTK,X及malloc的空闲内存) */
+gsize gtk_shot_memory_get_rss() {
+  FILE *file = fopen("/proc/self/statm", "r");
+  unsigned long size = 0, resident = 0;
+
+  if (!file) return 0;
+  if (fscanf(file, "%lu %lu", &size, &resident) != 2) resident = 0;
+  fclose(file);
+
+  return (gsize) resident * sysconf(_SC_PAGESIZE);
+}
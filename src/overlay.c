@@ -0,0 +1,116 @@
+/*
+ * GtkShot - A screen capture programme using GtkLib
+ * Copyright (C) 2012 flytreeleft @ CrazyDan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <config.h>
+
+#include <math.h>
+
+#include <gtk/gtk.h>
+
+#include "utils.h"
+
+#include "overlay.h"
+
+/** 绘制屏幕(screen)中挖去hole区域后剩余部分的遮罩 */
+void gtk_shot_overlay_draw_mask(cairo_t *cr, const GdkRectangle *screen
+                                  , const GdkRectangle *hole
+                                  , gint color, gdouble alpha) {
+  g_return_if_fail(cr && screen && hole);
+
+  gint x0 = hole->x, y0 = hole->y;
+  gint x1 = x0 + hole->width, y1 = y0 + hole->height;
+
+  SET_CAIRO_RGBA(cr, color, alpha);
+  cairo_rectangle(cr, screen->x, screen->y
+                    , screen->width, y0 - screen->y);
+  cairo_rectangle(cr, screen->x, y1
+                    , screen->width, screen->height + screen->y - y1);
+  cairo_rectangle(cr, screen->x, y0
+                    , x0 - screen->x, y1 - y0);
+  cairo_rectangle(cr, x1, y0
+                    , screen->width + screen->x - x1, y1 - y0);
+  cairo_fill(cr);
+}
+
+void gtk_shot_overlay_draw_border(cairo_t *cr, const GdkRectangle *rect
+                                    , gint border, gint color) {
+  g_return_if_fail(cr && rect);
+
+  cairo_set_line_width(cr, border);
+  SET_CAIRO_RGB(cr, color);
+  cairo_rectangle(cr, rect->x, rect->y, rect->width, rect->height);
+  cairo_stroke(cr);
+}
+
+/** 锚点坐标为直径为size的圆点的左上角 */
+void gtk_shot_overlay_draw_anchors(cairo_t *cr, const GdkPoint anchor[8]
+                                    , gint size, gint color) {
+  g_return_if_fail(cr && anchor);
+
+  SET_CAIRO_RGB(cr, color);
+
+  gint i = 0;
+  gfloat b = size / 2.0;
+  for (i = 0; i < 8; i++) {
+    cairo_arc(cr, anchor[i].x + b
+                , anchor[i].y + b
+                , b, 0, 2 * M_PI);
+    cairo_fill(cr);
+  }
+}
+
+/**
+ * 在选区(section,不含边框)的左上方绘制信息窗口(文本已排版于layout中),
+ * margin为信息窗口与选区的最小间距.
+ * 上方超出屏幕时,若flip为TRUE则移至选区内部,否则不绘制
+ */
+void gtk_shot_overlay_draw_message(cairo_t *cr, PangoLayout *layout
+                                    , const GdkRectangle *screen
+                                    , const GdkRectangle *section
+                                    , gint border, gint margin
+                                    , gdouble opacity, gboolean flip) {
+  g_return_if_fail(cr && layout && screen && section);
+
+  gint width = 0, height = 0;
+  pango_layout_get_pixel_size(layout, &width, &height);
+
+  gint radius = GTK_SHOT_OVERLAY_MESSAGE_RADIUS, padding = radius / 2;
+  gint x0 = section->x, y0 = section->y;
+  gint x1 = x0 + section->width;
+  gint x = x0 + border + padding;
+  gint y = y0 - margin - height - padding;
+
+  if (x1 >= screen->x + screen->width && x + width > x1) {
+    x = x1 - width - margin - padding; // 保持在屏幕内
+  }
+  if (y < screen->y) {
+    if (!flip) return;
+    y = y0 + border + padding * 2;
+  }
+
+  SET_CAIRO_RGBA(cr, GTK_SHOT_OVERLAY_MESSAGE_COLOR, opacity);
+  cairo_round_rect(cr, x - padding * 2
+                      , y - padding
+                      , width + padding * 4
+                      , height + padding * 2
+                      , radius);
+  cairo_fill(cr);
+
+  SET_CAIRO_RGB(cr, 0xFFFFFF);
+  cairo_move_to(cr, x, y);
+  pango_cairo_show_layout(cr, layout);
+}
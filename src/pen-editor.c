@@ -149,7 +149,7 @@ void gtk_shot_pen_editor_set_pen(GtkShotPenEditor *editor
   if (pen) {
     pen->color = editor->color;
     if (pen->type == GTK_SHOT_PEN_TEXT) {
-      pen->text.fontname = g_strdup(editor->fontname);
+      gtk_shot_pen_set_font(pen, editor->fontname);
     } else {
       pen->size = editor->size;
     }
@@ -307,13 +307,10 @@ void on_set_pen_size(GtkToggleButton *btn, GtkShotPenEditor *editor) {
 void on_set_pen_font(GtkFontButton *btn, GParamSpec *pspec
                             , GtkShotPenEditor *editor) {
   if (editor->pen) {
-    // 从FontButton中获取的字体不能被free,故将其复制一份
-    if (editor->pen->text.fontname) {
-      g_free(editor->pen->text.fontname);
-    }
+    // 从FontButton中获取的字体不能被free,由画笔复制一份
     editor->fontname =
             gtk_font_button_get_font_name(GTK_FONT_BUTTON(btn));
-    editor->pen->text.fontname = g_strdup(editor->fontname);
+    gtk_shot_pen_set_font(editor->pen, editor->fontname);
     gtk_widget_set_tooltip_text(GTK_WIDGET(btn), editor->fontname);
 #ifdef GTK_SHOT_DEBUG
     debug("font: %s\n", editor->pen->text.fontname);
@@ -0,0 +1,215 @@
+/*
+ * GtkShot - A screen capture programme using GtkLib
+ * Copyright (C) 2012 flytreeleft @ CrazyDan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <config.h>
+
+#include <gtk/gtk.h>
+
+#include "utils.h"
+
+#include "pen-index.h"
+
+typedef struct _Entry {
+  GtkShotPen *pen;
+  guint serial;
+  GdkRectangle bounds; // 登记时的范围(含拾取偏差)
+  gboolean unbounded;
+} Entry;
+
+/** 哈希表每项的大小(键,值及哈希值),仅用于估算内存 */
+#define NODE_SIZE (2 * sizeof(gpointer) + sizeof(guint))
+
+/** 网格坐标(带符号,各16位)合并为哈希键 */
+#define CELL_KEY(cx, cy) \
+          GUINT_TO_POINTER((((guint) (cx) & 0xffff) << 16) \
+                              | ((guint) (cy) & 0xffff))
+
+static void link_entry(GtkShotPenIndex *index, Entry *entry);
+static void unlink_entry(GtkShotPenIndex *index, Entry *entry);
+static gint cell_of(gint v);
+static void free_cell(gpointer list);
+
+GtkShotPenIndex* gtk_shot_pen_index_new() {
+  GtkShotPenIndex *index = g_new(GtkShotPenIndex, 1);
+
+  index->entries = g_hash_table_new_full(g_direct_hash, g_direct_equal
+                                            , NULL, g_free);
+  index->cells = g_hash_table_new_full(g_direct_hash, g_direct_equal
+                                          , NULL, free_cell);
+  index->unbounded = NULL;
+  index->serial = 0;
+
+  return index;
+}
+
+void gtk_shot_pen_index_destroy(GtkShotPenIndex *index) {
+  g_return_if_fail(index != NULL);
+
+  gtk_shot_pen_index_clear(index);
+  g_hash_table_destroy(index->cells);
+  g_hash_table_destroy(index->entries);
+  g_free(index);
+}
+
+/** 画笔需已编译(gtk_shot_pen_compile),以确定其范围 */
+void gtk_shot_pen_index_insert(GtkShotPenIndex *index, GtkShotPen *pen) {
+  g_return_if_fail(index != NULL && pen != NULL);
+
+  Entry *entry = g_new(Entry, 1);
+
+  entry->pen = pen;
+  entry->serial = index->serial++;
+  g_hash_table_replace(index->entries, pen, entry);
+  link_entry(index, entry);
+}
+
+void gtk_shot_pen_index_remove(GtkShotPenIndex *index, GtkShotPen *pen) {
+  g_return_if_fail(index != NULL && pen != NULL);
+
+  Entry *entry = g_hash_table_lookup(index->entries, pen);
+
+  if (entry) {
+    unlink_entry(index, entry);
+    g_hash_table_remove(index->entries, pen);
+  }
+}
+
+/** 画笔被移动或修改后重新登记,保持其层叠序号不变 */
+void gtk_shot_pen_index_update(GtkShotPenIndex *index, GtkShotPen *pen) {
+  g_return_if_fail(index != NULL && pen != NULL);
+
+  Entry *entry = g_hash_table_lookup(index->entries, pen);
+
+  if (entry) {
+    unlink_entry(index, entry);
+    link_entry(index, entry);
+  } else {
+    gtk_shot_pen_index_insert(index, pen);
+  }
+}
+
+void gtk_shot_pen_index_clear(GtkShotPenIndex *index) {
+  g_return_if_fail(index != NULL);
+
+  g_hash_table_remove_all(index->cells);
+  g_hash_table_remove_all(index->entries);
+  g_slist_free(index->unbounded);
+  index->unbounded = NULL;
+  index->serial = 0;
+}
+
+/** 拾取点(x, y)(屏幕坐标)处最上层的画笔 */
+GtkShotPen* gtk_shot_pen_index_pick(GtkShotPenIndex *index
+                                      , gint x, gint y) {
+  g_return_val_if_fail(index != NULL, NULL);
+
+  GSList *lists[2], *l;
+  Entry *best = NULL;
+  gint i = 0;
+
+  lists[0] = g_hash_table_lookup(index->cells
+                                    , CELL_KEY(cell_of(x), cell_of(y)));
+  lists[1] = index->unbounded;
+  for (i = 0; i < 2; i++) {
+    for (l = lists[i]; l; l = l->next) {
+      Entry *entry = (Entry*) l->data;
+      // 先比较序号,仅对可能更靠上的画笔做精确检测
+      if (best && entry->serial < best->serial) continue;
+      if (gtk_shot_pen_hit(entry->pen, x, y
+                            , GTK_SHOT_PEN_INDEX_TOLERANCE)) {
+        best = entry;
+      }
+    }
+  }
+
+  return best ? best->pen : NULL;
+}
+
+/** 索引项及网格链表占用的内存(字节,估算) */
+gsize gtk_shot_pen_index_get_memory(GtkShotPenIndex *index) {
+  g_return_val_if_fail(index != NULL, 0);
+
+  GHashTableIter iter;
+  gpointer list = NULL;
+  gsize size = sizeof(GtkShotPenIndex)
+                + g_hash_table_size(index->entries)
+                    * (NODE_SIZE + sizeof(Entry))
+                + g_hash_table_size(index->cells) * NODE_SIZE
+                + g_slist_length(index->unbounded) * sizeof(GSList);
+
+  g_hash_table_iter_init(&iter, index->cells);
+  while (g_hash_table_iter_next(&iter, NULL, &list)) {
+    size += g_slist_length((GSList*) list) * sizeof(GSList);
+  }
+  return size;
+}
+
+void link_entry(GtkShotPenIndex *index, Entry *entry) {
+  GdkRectangle *b = &entry->bounds;
+  gint cx = 0, cy = 0;
+
+  *b = entry->pen->bounds;
+  entry->unbounded = b->width <= 0 || b->height <= 0;
+  if (entry->unbounded) {
+    index->unbounded = g_slist_prepend(index->unbounded, entry);
+    return;
+  }
+  b->x -= GTK_SHOT_PEN_INDEX_TOLERANCE;
+  b->y -= GTK_SHOT_PEN_INDEX_TOLERANCE;
+  b->width += 2 * GTK_SHOT_PEN_INDEX_TOLERANCE;
+  b->height += 2 * GTK_SHOT_PEN_INDEX_TOLERANCE;
+  for (cy = cell_of(b->y); cy <= cell_of(b->y + b->height - 1); cy++) {
+    for (cx = cell_of(b->x); cx <= cell_of(b->x + b->width - 1); cx++) {
+      gpointer key = CELL_KEY(cx, cy);
+      GSList *list = g_hash_table_lookup(index->cells, key);
+      // 链表头可能变化,先取出再放回(不释放链表)
+      g_hash_table_steal(index->cells, key);
+      g_hash_table_insert(index->cells, key
+                            , g_slist_prepend(list, entry));
+    }
+  }
+}
+
+void unlink_entry(GtkShotPenIndex *index, Entry *entry) {
+  GdkRectangle *b = &entry->bounds;
+  gint cx = 0, cy = 0;
+
+  if (entry->unbounded) {
+    index->unbounded = g_slist_remove(index->unbounded, entry);
+    return;
+  }
+  for (cy = cell_of(b->y); cy <= cell_of(b->y + b->height - 1); cy++) {
+    for (cx = cell_of(b->x); cx <= cell_of(b->x + b->width - 1); cx++) {
+      gpointer key = CELL_KEY(cx, cy);
+      GSList *list = g_hash_table_lookup(index->cells, key);
+
+      g_hash_table_steal(index->cells, key);
+      list = g_slist_remove(list, entry);
+      if (list) g_hash_table_insert(index->cells, key, list);
+    }
+  }
+}
+
+/** 向下取整的网格坐标(屏幕坐标可为负) */
+gint cell_of(gint v) {
+  return v >= 0 ? v / GTK_SHOT_PEN_INDEX_CELL
+                  : (v + 1) / GTK_SHOT_PEN_INDEX_CELL - 1;
+}
+
+void free_cell(gpointer list) {
+  g_slist_free((GSList*) list);
+}
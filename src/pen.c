@@ -24,6 +24,7 @@
 #include "utils.h"
 
 #include "pen.h"
+#include "redact.h"
 
 #define PREPARE_PEN_AND_CAIRO(pen, cr) \
         do { \
@@ -32,6 +33,24 @@
           SET_CAIRO_RGB((cr), (pen)->color); \
         } while(0)
 
+typedef void (*PathFunc) (GtkShotPen *pen, cairo_t *cr);
+
+static void redact_rect(GtkShotPen *pen, GdkRectangle *rect);
+static void update_patch(GtkShotPen *pen, GdkRectangle *rect
+                            , gint scale);
+static void append_path(GtkShotPen *pen, cairo_t *cr
+                          , cairo_path_t *path, PathFunc func);
+static void rectangle_path(GtkShotPen *pen, cairo_t *cr);
+static void ellipse_path(GtkShotPen *pen, cairo_t *cr);
+static void arrow_geometry(GtkShotPen *pen, gfloat points[6]);
+static void arrow_body_path(GtkShotPen *pen, cairo_t *cr);
+static void arrow_head_path(GtkShotPen *pen, cairo_t *cr);
+static void line_path(GtkShotPen *pen, cairo_t *cr);
+static void box_bounds(GtkShotPen *pen);
+static PangoLayout* text_layout(GtkShotPen *pen, cairo_t *cr);
+static void clear_layout(GtkShotPen *pen);
+static void translate_path(cairo_path_t *path, gint dx, gint dy);
+
 GtkShotPen* gtk_shot_pen_new(GtkShotPenType type) {
   GtkShotPen *pen = g_new(GtkShotPen, 1);
 
@@ -40,6 +59,9 @@ GtkShotPen* gtk_shot_pen_new(GtkShotPenType type) {
   pen->start.x = pen->start.y = -pen->size;
   gdk_point_assign(pen->end, pen->start);
   pen->square = FALSE;
+  pen->path = pen->fill_path = NULL;
+  pen->bounds.x = pen->bounds.y = 0;
+  pen->bounds.width = pen->bounds.height = 0;
   pen->tracks = NULL;
   pen->text.fontname = pen->text.content = NULL;
   pen->type = type;
@@ -61,8 +83,19 @@ GtkShotPen* gtk_shot_pen_new(GtkShotPenType type) {
     case GTK_SHOT_PEN_TEXT:
       pen->size = 0;
       pen->text.fontname = g_strdup(GTK_SHOT_DEFAULT_PEN_FONT);
+      pen->text.layout = NULL;
       pen->draw_track = gtk_shot_pen_draw_text;
       break;
+    case GTK_SHOT_PEN_MOSAIC:
+    case GTK_SHOT_PEN_BLUR:
+      pen->redact.source = NULL;
+      pen->redact.x = pen->redact.y = 0;
+      pen->redact.snapshot = FALSE;
+      pen->redact.patch = NULL;
+      pen->redact.size = 0;
+      pen->redact.scale = 0;
+      pen->draw_track = gtk_shot_pen_draw_redaction;
+      break;
   }
 
   return pen;
@@ -71,6 +104,7 @@ GtkShotPen* gtk_shot_pen_new(GtkShotPenType type) {
 void gtk_shot_pen_free(GtkShotPen *pen) {
   g_return_if_fail(pen != NULL);
 
+  gtk_shot_pen_invalidate(pen);
   if (pen->type == GTK_SHOT_PEN_LINE) {
     GSList *l = pen->tracks;
     for (l; l; l = l->next) {
@@ -80,6 +114,10 @@ void gtk_shot_pen_free(GtkShotPen *pen) {
   } else if (pen->type == GTK_SHOT_PEN_TEXT) {
     g_free(pen->text.fontname);
     g_free(pen->text.content);
+    clear_layout(pen);
+  } else if (gtk_shot_pen_is_redaction(pen)) {
+    if (pen->redact.source) g_object_unref(pen->redact.source);
+    if (pen->redact.patch) cairo_surface_destroy(pen->redact.patch);
   }
   g_free(pen);
 }
@@ -89,10 +127,19 @@ void gtk_shot_pen_reset(GtkShotPen *pen) {
   g_return_if_fail(pen != NULL);
 
   pen->square = FALSE;
+  // 路径缓存归拷贝所有
+  pen->path = pen->fill_path = NULL;
   if (pen->type == GTK_SHOT_PEN_TEXT) {
     // 新建引用,便于资源正确释放
     pen->text.fontname = g_strdup(pen->text.fontname);
     pen->text.content = NULL;
+    pen->text.layout = NULL;
+  } else if (gtk_shot_pen_is_redaction(pen)) {
+    // 原始截图和打码后的图像归拷贝所有,
+    // 开始绘制时再重新设置原始截图
+    pen->redact.source = NULL;
+    pen->redact.snapshot = FALSE;
+    pen->redact.patch = NULL;
   } else {
     pen->tracks = NULL;
   }
@@ -133,6 +180,462 @@ void gtk_shot_pen_save_line_track(GtkShotPen *pen
 void gtk_shot_pen_draw_rectangle(GtkShotPen *pen, cairo_t *cr) {
   PREPARE_PEN_AND_CAIRO(pen, cr);
 
+  append_path(pen, cr, pen->path, rectangle_path);
+  cairo_stroke(cr);
+}
+
+void gtk_shot_pen_draw_ellipse(GtkShotPen *pen, cairo_t *cr) {
+  PREPARE_PEN_AND_CAIRO(pen, cr);
+
+  append_path(pen, cr, pen->path, ellipse_path);
+  cairo_stroke(cr);
+}
+
+void gtk_shot_pen_draw_arrow(GtkShotPen *pen, cairo_t *cr) {
+  PREPARE_PEN_AND_CAIRO(pen, cr);
+
+  // 绘制线身
+  append_path(pen, cr, pen->path, arrow_body_path);
+  cairo_stroke(cr);
+  // 绘制箭头(填充)
+  cairo_set_line_width(cr, 1);
+  append_path(pen, cr, pen->fill_path, arrow_head_path);
+  cairo_fill(cr);
+}
+
+void gtk_shot_pen_draw_line(GtkShotPen *pen, cairo_t *cr) {
+  PREPARE_PEN_AND_CAIRO(pen, cr);
+
+  append_path(pen, cr, pen->path, line_path);
+  cairo_stroke(cr);
+}
+
+void gtk_shot_pen_draw_text(GtkShotPen *pen, cairo_t *cr) {
+  PREPARE_PEN_AND_CAIRO(pen, cr);
+
+  if (pen->text.content) {
+    cairo_move_to(cr, pen->start.x, pen->start.y - SYSTEM_CURSOR_SIZE / 2);
+    pango_cairo_show_layout(cr, text_layout(pen, cr));
+  }
+}
+
+/** 设置文字画笔的内容(text归画笔所有),已缓存的文本布局随之失效 */
+void gtk_shot_pen_set_text(GtkShotPen *pen, gchar *text) {
+  g_return_if_fail(pen != NULL && pen->type == GTK_SHOT_PEN_TEXT);
+
+  g_free(pen->text.content);
+  pen->text.content = text;
+  clear_layout(pen);
+}
+
+/** 设置文字画笔的字体,已缓存的文本布局随之失效 */
+void gtk_shot_pen_set_font(GtkShotPen *pen, const gchar *fontname) {
+  g_return_if_fail(pen != NULL && pen->type == GTK_SHOT_PEN_TEXT);
+
+  gchar *old = pen->text.fontname;
+  pen->text.fontname = g_strdup(fontname);
+  g_free(old);
+  clear_layout(pen);
+}
+
+/**
+ * 设置打码所用的原始截图(原点为屏幕坐标(x, y)).
+ * 截图缓存会被下次截取原地复用,仅在绘制或拖动期间引用,
+ * 结束时需调用gtk_shot_pen_snapshot_source
+ */
+void gtk_shot_pen_set_source(GtkShotPen *pen, GdkPixbuf *source
+                                , gint x, gint y) {
+  g_return_if_fail(pen != NULL && gtk_shot_pen_is_redaction(pen));
+
+  if (source) g_object_ref(source);
+  if (pen->redact.source) g_object_unref(pen->redact.source);
+  pen->redact.source = source;
+  pen->redact.x = x;
+  pen->redact.y = y;
+  pen->redact.snapshot = FALSE;
+  pen->redact.size = 0; // 强制重新生成
+}
+
+/**
+ * 将原始截图替换为画笔当前范围内的私有副本,
+ * 之后修改画笔大小时仍可由副本重新生成打码图像
+ */
+void gtk_shot_pen_snapshot_source(GtkShotPen *pen) {
+  g_return_if_fail(pen != NULL && gtk_shot_pen_is_redaction(pen));
+
+  GdkPixbuf *source = pen->redact.source, *copy = NULL;
+  GdkRectangle rect;
+
+  if (!source || pen->redact.snapshot) return;
+
+  redact_rect(pen, &rect);
+  if (rect.width > 0 && rect.height > 0) {
+    GdkPixbuf *sub = gdk_pixbuf_new_subpixbuf(source
+                                  , rect.x - pen->redact.x
+                                  , rect.y - pen->redact.y
+                                  , rect.width, rect.height);
+    copy = gdk_pixbuf_copy(sub);
+    g_object_unref(sub);
+  }
+  g_object_unref(source);
+  pen->redact.source = copy;
+  pen->redact.x = rect.x;
+  pen->redact.y = rect.y;
+  pen->redact.snapshot = copy != NULL;
+}
+
+/**
+ * 打码: 绘制由原始截图生成的不透明区域图像,
+ * 保存的截图中该区域仅包含打码后的像素,原始内容不可还原.
+ * 区域不变时直接复用已生成的图像.
+ * 绘制和拖动期间(原始截图尚未截取副本)每次移动都需重新生成,
+ * 此时在缩小GTK_SHOT_REDACT_PREVIEW_SCALE倍的图像上打码并放大绘制,
+ * 截取副本(松开鼠标)后再以原始分辨率生成
+ */
+void gtk_shot_pen_draw_redaction(GtkShotPen *pen, cairo_t *cr) {
+  g_return_if_fail(pen && cr);
+
+  GdkRectangle rect;
+  gint scale = pen->redact.snapshot ? 1 : GTK_SHOT_REDACT_PREVIEW_SCALE;
+
+  if (pen->redact.source) {
+    redact_rect(pen, &rect);
+    if (rect.width <= 0 || rect.height <= 0) return;
+    if (!pen->redact.patch || pen->redact.size != pen->size
+          || pen->redact.scale != scale
+          || pen->redact.rect.x != rect.x
+          || pen->redact.rect.y != rect.y
+          || pen->redact.rect.width != rect.width
+          || pen->redact.rect.height != rect.height) {
+      update_patch(pen, &rect, scale);
+    }
+  }
+  if (!pen->redact.patch) return;
+
+  cairo_save(cr);
+  cairo_set_operator(cr, CAIRO_OPERATOR_SOURCE);
+  cairo_rectangle(cr, pen->redact.rect.x, pen->redact.rect.y
+                    , pen->redact.rect.width, pen->redact.rect.height);
+  cairo_translate(cr, pen->redact.rect.x, pen->redact.rect.y);
+  cairo_scale(cr, pen->redact.scale, pen->redact.scale);
+  cairo_set_source_surface(cr, pen->redact.patch, 0, 0);
+  if (pen->redact.scale > 1) {
+    cairo_pattern_t *pattern = cairo_get_source(cr);
+    // 马赛克的块放大后仍为方块,模糊则需平滑插值
+    cairo_pattern_set_filter(pattern, pen->type == GTK_SHOT_PEN_MOSAIC ?
+                                          CAIRO_FILTER_NEAREST
+                                          : CAIRO_FILTER_BILINEAR);
+    cairo_pattern_set_extend(pattern, CAIRO_EXTEND_PAD);
+  }
+  cairo_fill(cr);
+  cairo_restore(cr);
+}
+
+/** 画笔范围与原始截图的交集(屏幕坐标),不相交时宽高为0 */
+void redact_rect(GtkShotPen *pen, GdkRectangle *rect) {
+  GdkRectangle bounds = {.x = pen->redact.x, .y = pen->redact.y
+                  , .width = gdk_pixbuf_get_width(pen->redact.source)
+                  , .height = gdk_pixbuf_get_height(pen->redact.source)};
+
+  rect->x = MIN(pen->start.x, pen->end.x);
+  rect->y = MIN(pen->start.y, pen->end.y);
+  rect->width = ABS(pen->end.x - pen->start.x);
+  rect->height = ABS(pen->end.y - pen->start.y);
+  if (!gdk_rectangle_intersect(rect, &bounds, rect)) {
+    rect->width = rect->height = 0;
+  }
+}
+
+/**
+ * 将原始截图中的区域转换为不透明的ARGB32图像,并就地打码.
+ * scale大于1时图像缩小scale倍,打码的块大小和半径随之缩小
+ */
+void update_patch(GtkShotPen *pen, GdkRectangle *rect, gint scale) {
+  GdkPixbuf *source = pen->redact.source;
+  gint n_channels = gdk_pixbuf_get_n_channels(source);
+  gint rowstride = gdk_pixbuf_get_rowstride(source);
+  const guchar *pixels = gdk_pixbuf_get_pixels(source)
+                          + (rect->y - pen->redact.y) * rowstride
+                          + (rect->x - pen->redact.x) * n_channels;
+  cairo_surface_t *patch = pen->redact.patch;
+  gint width = (rect->width + scale - 1) / scale;
+  gint height = (rect->height + scale - 1) / scale;
+
+  // 尺寸不变时复用原图像的空间
+  if (!patch || cairo_image_surface_get_width(patch) != width
+        || cairo_image_surface_get_height(patch) != height) {
+    if (patch) cairo_surface_destroy(patch);
+    patch = cairo_image_surface_create(CAIRO_FORMAT_RGB24
+                                        , width, height);
+    pen->redact.patch = patch;
+  }
+  cairo_surface_flush(patch);
+
+  guchar *data = cairo_image_surface_get_data(patch);
+  gint stride = cairo_image_surface_get_stride(patch);
+
+  gtk_shot_redact_import(data, stride, pixels, rowstride, n_channels
+                          , rect->width, rect->height, scale);
+  if (pen->type == GTK_SHOT_PEN_MOSAIC) {
+    gtk_shot_redact_pixelate(data, width, height, stride
+                              , MAX(pen->size * 4 / scale, 1));
+  } else if (scale >= GTK_SHOT_REDACT_BLUR_BLOCK) {
+    // 缩小时的平均已去除了细节
+    gtk_shot_redact_box_blur(data, width, height, stride
+                              , MAX(pen->size * 3 / scale, 1));
+  } else {
+    gtk_shot_redact_blur(data, width, height
+                          , stride, pen->size * 3);
+  }
+  cairo_surface_mark_dirty(patch);
+
+  pen->redact.rect = *rect;
+  pen->redact.size = pen->size;
+  pen->redact.scale = scale;
+  pen->bounds = *rect;
+}
+
+/**
+ * 编译已提交画笔的路径及其范围:
+ * 几何计算仅在提交时进行一次,重绘时直接回放缓存的路径.
+ * 画笔属性被修改后,需调用gtk_shot_pen_invalidate
+ */
+void gtk_shot_pen_compile(GtkShotPen *pen) {
+  g_return_if_fail(pen != NULL);
+
+  PathFunc stroke = NULL, fill = NULL;
+  switch(pen->type) {
+    case GTK_SHOT_PEN_RECT: stroke = rectangle_path; break;
+    case GTK_SHOT_PEN_ELLIPSE: stroke = ellipse_path; break;
+    case GTK_SHOT_PEN_ARROW:
+      stroke = arrow_body_path;
+      fill = arrow_head_path;
+      break;
+    case GTK_SHOT_PEN_LINE: stroke = line_path; break;
+    default:
+      // 文本和打码没有路径,仅计算其范围
+      gtk_shot_pen_invalidate(pen);
+      box_bounds(pen);
+      return;
+  }
+  gtk_shot_pen_invalidate(pen);
+
+  cairo_surface_t *surface =
+        cairo_image_surface_create(CAIRO_FORMAT_A8, 1, 1);
+  cairo_t *cr = cairo_create(surface);
+  gdouble x0 = 0, y0 = 0, x1 = 0, y1 = 0;
+  gdouble fx0 = 0, fy0 = 0, fx1 = 0, fy1 = 0;
+
+  cairo_set_line_width(cr, pen->size);
+  stroke(pen, cr);
+  pen->path = cairo_copy_path(cr);
+  cairo_stroke_extents(cr, &x0, &y0, &x1, &y1);
+  cairo_new_path(cr);
+  if (fill) {
+    fill(pen, cr);
+    pen->fill_path = cairo_copy_path(cr);
+    cairo_fill_extents(cr, &fx0, &fy0, &fx1, &fy1);
+    x0 = MIN(x0, fx0); y0 = MIN(y0, fy0);
+    x1 = MAX(x1, fx1); y1 = MAX(y1, fy1);
+  }
+  pen->bounds.x = floor(x0);
+  pen->bounds.y = floor(y0);
+  pen->bounds.width = ceil(x1) - pen->bounds.x;
+  pen->bounds.height = ceil(y1) - pen->bounds.y;
+
+  cairo_destroy(cr);
+  cairo_surface_destroy(surface);
+}
+
+/** 平移已提交的画笔,路径缓存和范围随之平移 */
+void gtk_shot_pen_translate(GtkShotPen *pen, gint dx, gint dy) {
+  g_return_if_fail(pen != NULL);
+
+  pen->start.x += dx; pen->start.y += dy;
+  pen->end.x += dx; pen->end.y += dy;
+  if (pen->type == GTK_SHOT_PEN_LINE) {
+    GSList *l = pen->tracks;
+    for (l; l; l = l->next) {
+      GdkPoint *p = (GdkPoint*) l->data;
+      p->x += dx; p->y += dy;
+    }
+  }
+  translate_path(pen->path, dx, dy);
+  translate_path(pen->fill_path, dx, dy);
+  pen->bounds.x += dx;
+  pen->bounds.y += dy;
+}
+
+/** 将画笔style的颜色/大小/字体应用到已提交的画笔上 */
+void gtk_shot_pen_restyle(GtkShotPen *pen, GtkShotPen *style) {
+  g_return_if_fail(pen != NULL && style != NULL);
+
+  pen->color = style->color;
+  if (pen->type == GTK_SHOT_PEN_TEXT) {
+    if (style->type == GTK_SHOT_PEN_TEXT && style->text.fontname) {
+      gtk_shot_pen_set_font(pen, style->text.fontname);
+    }
+  } else if (style->type != GTK_SHOT_PEN_TEXT) {
+    pen->size = style->size;
+  }
+  gtk_shot_pen_compile(pen);
+}
+
+/**
+ * 点(x, y)是否落在已提交的画笔上,tolerance为允许的偏差.
+ * 图形仅其线条可被选中,文本和打码为其整个范围
+ */
+gboolean gtk_shot_pen_hit(GtkShotPen *pen, gint x, gint y
+                            , gint tolerance) {
+  g_return_val_if_fail(pen != NULL, FALSE);
+
+  if (x < pen->bounds.x - tolerance
+        || x >= pen->bounds.x + pen->bounds.width + tolerance
+        || y < pen->bounds.y - tolerance
+        || y >= pen->bounds.y + pen->bounds.height + tolerance) {
+    return FALSE;
+  }
+  if (!pen->path) return TRUE;
+
+  cairo_surface_t *surface =
+        cairo_image_surface_create(CAIRO_FORMAT_A8, 1, 1);
+  cairo_t *cr = cairo_create(surface);
+  gboolean hit = FALSE;
+
+  cairo_set_line_width(cr, pen->size + 2 * tolerance);
+  cairo_append_path(cr, pen->path);
+  hit = cairo_in_stroke(cr, x + 0.5, y + 0.5);
+  cairo_new_path(cr);
+  if (!hit && pen->fill_path) {
+    cairo_append_path(cr, pen->fill_path);
+    hit = cairo_in_fill(cr, x + 0.5, y + 0.5)
+            || cairo_in_stroke(cr, x + 0.5, y + 0.5);
+  }
+  cairo_destroy(cr);
+  cairo_surface_destroy(surface);
+
+  return hit;
+}
+
+/**
+ * 画笔占用的内存(字节): 画笔自身,缓存的路径,
+ * 手绘轨迹,文本和打码图像(不含共享的原始截图)
+ */
+gsize gtk_shot_pen_get_memory(GtkShotPen *pen) {
+  g_return_val_if_fail(pen != NULL, 0);
+
+  gsize size = sizeof(GtkShotPen);
+  if (pen->path) {
+    size += pen->path->num_data * sizeof(cairo_path_data_t);
+  }
+  if (pen->fill_path) {
+    size += pen->fill_path->num_data * sizeof(cairo_path_data_t);
+  }
+  if (pen->type == GTK_SHOT_PEN_LINE) {
+    size += g_slist_length(pen->tracks)
+              * (sizeof(GSList) + sizeof(GdkPoint));
+  } else if (pen->type == GTK_SHOT_PEN_TEXT) {
+    if (pen->text.fontname) size += strlen(pen->text.fontname) + 1;
+    if (pen->text.content) size += strlen(pen->text.content) + 1;
+    // PangoLayout的内部结构不公开,按字符数估算
+    if (pen->text.layout) {
+      size += TEXT_LAYOUT_BASE_SIZE
+                + g_utf8_strlen(pen->text.content, -1)
+                    * TEXT_LAYOUT_CHAR_SIZE;
+    }
+  } else if (gtk_shot_pen_is_redaction(pen)) {
+    if (pen->redact.patch) {
+      size += cairo_image_surface_get_stride(pen->redact.patch)
+                * cairo_image_surface_get_height(pen->redact.patch);
+    }
+    // 绘制期间引用的整屏截图已计入截图缓存
+    if (pen->redact.snapshot) {
+      size += gdk_pixbuf_get_rowstride(pen->redact.source)
+                * gdk_pixbuf_get_height(pen->redact.source);
+    }
+  }
+  return size;
+}
+
+/** 释放路径缓存,重绘时重新计算路径 */
+void gtk_shot_pen_invalidate(GtkShotPen *pen) {
+  g_return_if_fail(pen != NULL);
+
+  if (pen->path) cairo_path_destroy(pen->path);
+  if (pen->fill_path) cairo_path_destroy(pen->fill_path);
+  pen->path = pen->fill_path = NULL;
+  pen->bounds.width = pen->bounds.height = 0;
+}
+
+/** 无路径画笔(文本/打码)的范围 */
+void box_bounds(GtkShotPen *pen) {
+  if (pen->type == GTK_SHOT_PEN_TEXT) {
+    if (!pen->text.content) return;
+
+    cairo_surface_t *surface =
+          cairo_image_surface_create(CAIRO_FORMAT_A8, 1, 1);
+    cairo_t *cr = cairo_create(surface);
+    PangoLayout *layout = text_layout(pen, cr);
+
+    pango_layout_get_pixel_size(layout, &pen->bounds.width
+                                  , &pen->bounds.height);
+    pen->bounds.x = pen->start.x;
+    pen->bounds.y = pen->start.y - SYSTEM_CURSOR_SIZE / 2;
+    cairo_destroy(cr);
+    cairo_surface_destroy(surface);
+  } else if (gtk_shot_pen_is_redaction(pen)) {
+    // 绘制时更新为与截图相交后的范围
+    pen->bounds.x = MIN(pen->start.x, pen->end.x);
+    pen->bounds.y = MIN(pen->start.y, pen->end.y);
+    pen->bounds.width = ABS(pen->end.x - pen->start.x);
+    pen->bounds.height = ABS(pen->end.y - pen->start.y);
+  }
+}
+
+/**
+ * 文字画笔的文本布局: 缓存在画笔上并使用其自身的PangoContext,
+ * 文本或字体不变时不再重新解析字体,
+ * 仅在cr的字体选项或变换变化时重新排版
+ */
+PangoLayout* text_layout(GtkShotPen *pen, cairo_t *cr) {
+  if (!pen->text.layout) {
+    pen->text.layout = pango_cairo_prepare_layout(cr, pen->text.content
+                                                    , pen->text.fontname);
+  } else {
+    pango_cairo_update_layout(cr, pen->text.layout);
+  }
+  return pen->text.layout;
+}
+
+void clear_layout(GtkShotPen *pen) {
+  if (pen->text.layout) g_object_unref(pen->text.layout);
+  pen->text.layout = NULL;
+}
+
+void translate_path(cairo_path_t *path, gint dx, gint dy) {
+  gint i = 0, j = 0;
+
+  if (!path) return;
+  for (i = 0; i < path->num_data; i += path->data[i].header.length) {
+    cairo_path_data_t *data = &path->data[i];
+    for (j = 1; j < data->header.length; j++) {
+      data[j].point.x += dx;
+      data[j].point.y += dy;
+    }
+  }
+}
+
+/** 有缓存时回放缓存的路径,否则计算路径 */
+void append_path(GtkShotPen *pen, cairo_t *cr
+                    , cairo_path_t *path, PathFunc func) {
+  if (path) {
+    cairo_append_path(cr, path);
+  } else {
+    func(pen, cr);
+  }
+}
+
+void rectangle_path(GtkShotPen *pen, cairo_t *cr) {
   if (!pen->square) {
     cairo_rectangle(cr, pen->start.x, pen->start.y
                       , pen->end.x - pen->start.x
@@ -152,11 +655,9 @@ void gtk_shot_pen_draw_rectangle(GtkShotPen *pen, cairo_t *cr) {
     cairo_line_to(cr, x0, y0);
     cairo_close_path(cr);
   }
-  cairo_stroke(cr);
 }
 
-void gtk_shot_pen_draw_ellipse(GtkShotPen *pen, cairo_t *cr) {
-  PREPARE_PEN_AND_CAIRO(pen, cr);
+void ellipse_path(GtkShotPen *pen, cairo_t *cr) {
   // 椭圆/圆的绘制路径终点在直径的右侧,故移动到该位置
   // 防止多余线条的绘制
   // 绘制起点见: http://www.cairographics.org/manual/cairo-Paths.html#cairo-arc
@@ -174,20 +675,17 @@ void gtk_shot_pen_draw_ellipse(GtkShotPen *pen, cairo_t *cr) {
   cairo_scale(cr, 1.0, pen->square ? 1.0 : ((gfloat) dy) / dx);
   cairo_arc(cr, 0, 0, dx / 2.0, 0, 2 * M_PI);
   cairo_restore(cr);
-
-  cairo_stroke(cr);
 }
 
 /**
- * 绘制箭头线(由箭头和线身两部分构成)<br>
+ * 计算箭头线(由箭头和线身两部分构成)的几何信息<br>
  * 箭头为等腰三角形,其顶点为箭头线的终点,
  * 腰长为sqrt(2)倍线宽(实际绘制时,线宽为指定size的2倍),
  * 高度等于线宽.
  * 箭头线的线身长为整个箭头线的长度减去1/2线宽
+ * @param points 线身的终点,箭头另外两点的坐标
  */
-void gtk_shot_pen_draw_arrow(GtkShotPen *pen, cairo_t *cr) {
-  PREPARE_PEN_AND_CAIRO(pen, cr);
-
+void arrow_geometry(GtkShotPen *pen, gfloat points[6]) {
   gfloat alpha = 45 * (M_PI / 180); // 箭头腰与直线的夹角
   gfloat l = sqrt(2) * (2 * pen->size); // 箭头腰长
   // (a,b)为起点到终点的方向向量
@@ -219,27 +717,34 @@ void gtk_shot_pen_draw_arrow(GtkShotPen *pen, cairo_t *cr) {
     x = a - (a*pen->size/(sqrt(a2b2))) + pen->start.x;
     y = b - (b*pen->size/(sqrt(a2b2))) + pen->start.y;
   }
+  points[0] = x;
+  points[1] = y;
   // 箭头另外两点坐标
-  x0 = pen->end.x - x0;
-  y0 = pen->end.y - y0;
-  x1 = pen->end.x - x1;
-  y1 = pen->end.y - y1;
+  points[2] = pen->end.x - x0;
+  points[3] = pen->end.y - y0;
+  points[4] = pen->end.x - x1;
+  points[5] = pen->end.y - y1;
+}
 
-  // 绘制线身
+void arrow_body_path(GtkShotPen *pen, cairo_t *cr) {
+  gfloat points[6];
+
+  arrow_geometry(pen, points);
   cairo_move_to(cr, pen->start.x, pen->start.y);
-  cairo_line_to(cr, x, y);
-  cairo_stroke(cr);
-  // 绘制箭头(填充)
-  cairo_set_line_width(cr, 1);
+  cairo_line_to(cr, points[0], points[1]);
+}
+
+void arrow_head_path(GtkShotPen *pen, cairo_t *cr) {
+  gfloat points[6];
+
+  arrow_geometry(pen, points);
   cairo_move_to(cr, pen->end.x, pen->end.y);
-  cairo_line_to(cr, x0, y0);
-  cairo_line_to(cr, x1, y1);
+  cairo_line_to(cr, points[2], points[3]);
+  cairo_line_to(cr, points[4], points[5]);
   cairo_close_path(cr);
-  cairo_fill(cr);
 }
 
-void gtk_shot_pen_draw_line(GtkShotPen *pen, cairo_t *cr) {
-  PREPARE_PEN_AND_CAIRO(pen, cr);
+void line_path(GtkShotPen *pen, cairo_t *cr) {
   // 从尾部到头部画线
   cairo_move_to(cr, pen->end.x, pen->end.y);
 
@@ -251,14 +756,4 @@ void gtk_shot_pen_draw_line(GtkShotPen *pen, cairo_t *cr) {
     }
   }
   cairo_line_to(cr, pen->start.x, pen->start.y);
-  cairo_stroke(cr);
-}
-
-void gtk_shot_pen_draw_text(GtkShotPen *pen, cairo_t *cr) {
-  PREPARE_PEN_AND_CAIRO(pen, cr);
-
-  if (pen->text.content) {
-    cairo_move_to(cr, pen->start.x, pen->start.y - SYSTEM_CURSOR_SIZE / 2);
-    cairo_draw_text(cr, pen->text.content, pen->text.fontname);
-  }
 }
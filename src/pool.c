@@ -0,0 +1,274 @@
+/*
+ * GtkShot - A screen capture programme using GtkLib
+ * Copyright (C) 2012 flytreeleft @ CrazyDan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <config.h>
+
+#include <gtk/gtk.h>
+
+#include "utils.h"
+#include "memory.h"
+
+#include "pool.h"
+
+typedef struct _PoolEntry {
+  gpointer data; // GdkPixbuf或cairo_surface_t
+  gint width, height;
+  glong released; // 放入缓存池的时间(秒)
+} PoolEntry;
+
+static void on_screen_changed(GdkScreen *screen, GtkShotPool *pool);
+static gboolean on_trim(GtkShotPool *pool);
+
+static glong now_seconds();
+static void schedule_trim(GtkShotPool *pool);
+static PoolEntry* take_entry(GSList **list, gint width, gint height);
+static GSList* put_entry(GSList *list, gpointer data
+                            , gint width, gint height);
+static GSList* trim_entries(GSList *list, glong before
+                              , GDestroyNotify free_func);
+
+GtkShotPool* gtk_shot_pool_new(GdkScreen *screen) {
+  GtkShotPool *pool = g_new(GtkShotPool, 1);
+
+  pool->screen = screen;
+  pool->pixbufs = NULL;
+  pool->surfaces = NULL;
+  pool->trim_timeout = GTK_SHOT_POOL_TRIM_TIMEOUT;
+  pool->trim_source = 0;
+  // 屏幕分辨率或显示器布局发生变化(RandR)
+  g_signal_connect(screen, "size-changed"
+                      , G_CALLBACK(on_screen_changed), pool);
+  g_signal_connect(screen, "monitors-changed"
+                      , G_CALLBACK(on_screen_changed), pool);
+
+  return pool;
+}
+
+void gtk_shot_pool_destroy(GtkShotPool *pool) {
+  g_return_if_fail(pool != NULL);
+
+  g_signal_handlers_disconnect_by_func(pool->screen
+                                          , on_screen_changed, pool);
+  gtk_shot_pool_clean(pool);
+  g_free(pool);
+}
+
+/**
+ * 获取指定尺寸的截图缓存,无可复用的缓存时新建.
+ * 注: 缓存内容未定义,使用前需完全覆盖
+ */
+GdkPixbuf* gtk_shot_pool_acquire_pixbuf(GtkShotPool *pool
+                                            , gint width, gint height) {
+  g_return_val_if_fail(pool != NULL, NULL);
+
+  PoolEntry *entry = take_entry(&pool->pixbufs, width, height);
+  GdkPixbuf *pixbuf = NULL;
+
+  if (entry) {
+    pixbuf = GDK_PIXBUF(entry->data);
+    g_free(entry);
+  } else {
+    pixbuf = gdk_pixbuf_new(GDK_COLORSPACE_RGB, FALSE, 8
+                                , width, height);
+  }
+  return pixbuf;
+}
+
+void gtk_shot_pool_release_pixbuf(GtkShotPool *pool
+                                      , GdkPixbuf *pixbuf) {
+  g_return_if_fail(pool != NULL);
+
+  if (!pixbuf) return;
+  pool->pixbufs = put_entry(pool->pixbufs, pixbuf
+                              , gdk_pixbuf_get_width(pixbuf)
+                              , gdk_pixbuf_get_height(pixbuf));
+  schedule_trim(pool);
+}
+
+/**
+ * 获取指定尺寸的ARGB32画布缓存,无可复用的缓存时新建.
+ * 注: 缓存内容未定义,使用前需完全覆盖
+ */
+cairo_surface_t* gtk_shot_pool_acquire_surface(GtkShotPool *pool
+                                                  , gint width
+                                                  , gint height) {
+  g_return_val_if_fail(pool != NULL, NULL);
+
+  PoolEntry *entry = take_entry(&pool->surfaces, width, height);
+  cairo_surface_t *surface = NULL;
+
+  if (entry) {
+    surface = (cairo_surface_t*) entry->data;
+    g_free(entry);
+  } else {
+    surface = cairo_image_surface_create(CAIRO_FORMAT_ARGB32
+                                            , width, height);
+  }
+  return surface;
+}
+
+void gtk_shot_pool_release_surface(GtkShotPool *pool
+                                      , cairo_surface_t *surface) {
+  g_return_if_fail(pool != NULL);
+
+  if (!surface) return;
+  pool->surfaces = put_entry(pool->surfaces, surface
+                              , cairo_image_surface_get_width(surface)
+                              , cairo_image_surface_get_height(surface));
+  schedule_trim(pool);
+}
+
+/** 释放所有闲置的缓存 */
+void gtk_shot_pool_clean(GtkShotPool *pool) {
+  g_return_if_fail(pool != NULL);
+
+  pool->pixbufs = trim_entries(pool->pixbufs, G_MAXLONG
+                                  , (GDestroyNotify) g_object_unref);
+  pool->surfaces = trim_entries(pool->surfaces, G_MAXLONG
+                                  , (GDestroyNotify) cairo_surface_destroy);
+  if (pool->trim_source) {
+    g_source_remove(pool->trim_source);
+    pool->trim_source = 0;
+  }
+}
+
+/** 闲置的截图和画布占用的内存(字节) */
+void gtk_shot_pool_get_memory(GtkShotPool *pool
+                                , gsize *pixbufs, gsize *surfaces) {
+  g_return_if_fail(pool != NULL);
+
+  GSList *l = NULL;
+
+  if (pixbufs) {
+    *pixbufs = 0;
+    for (l = pool->pixbufs; l; l = l->next) {
+      GdkPixbuf *pixbuf = GDK_PIXBUF(((PoolEntry*) l->data)->data);
+      *pixbufs += (gsize) gdk_pixbuf_get_rowstride(pixbuf)
+                    * gdk_pixbuf_get_height(pixbuf);
+    }
+  }
+  if (surfaces) {
+    *surfaces = 0;
+    for (l = pool->surfaces; l; l = l->next) {
+      cairo_surface_t *surface = (cairo_surface_t*) ((PoolEntry*) l->data)->data;
+      *surfaces += (gsize) cairo_image_surface_get_stride(surface)
+                      * cairo_image_surface_get_height(surface);
+    }
+  }
+}
+
+void on_screen_changed(GdkScreen *screen, GtkShotPool *pool) {
+#ifdef GTK_SHOT_DEBUG
+  debug("screen changed to %dx%d, %d monitor(s)\n"
+              , gdk_screen_get_width(screen)
+              , gdk_screen_get_height(screen)
+              , gdk_screen_get_n_monitors(screen));
+#endif
+  // 布局变化后,原尺寸的缓存基本不会再被使用
+  gtk_shot_pool_clean(pool);
+}
+
+gboolean on_trim(GtkShotPool *pool) {
+  glong before = now_seconds() - pool->trim_timeout;
+
+  pool->pixbufs = trim_entries(pool->pixbufs, before
+                                  , (GDestroyNotify) g_object_unref);
+  pool->surfaces = trim_entries(pool->surfaces, before
+                                  , (GDestroyNotify) cairo_surface_destroy);
+  gtk_shot_memory_sample();
+  pool->trim_source = 0;
+  schedule_trim(pool);
+
+  return FALSE;
+}
+
+glong now_seconds() {
+  GTimeVal tv;
+  g_get_current_time(&tv);
+
+  return tv.tv_sec;
+}
+
+/**
+ * 在最早放入的闲置缓存到期时清理(单次定时),
+ * 无闲置缓存时不定时,空闲进程不会被周期性唤醒
+ */
+void schedule_trim(GtkShotPool *pool) {
+  glong oldest = G_MAXLONG;
+  GSList *l = NULL;
+
+  if (pool->trim_source) return;
+  for (l = pool->pixbufs; l; l = l->next) {
+    oldest = MIN(oldest, ((PoolEntry*) l->data)->released);
+  }
+  for (l = pool->surfaces; l; l = l->next) {
+    oldest = MIN(oldest, ((PoolEntry*) l->data)->released);
+  }
+  if (oldest == G_MAXLONG) return;
+
+  glong delay = oldest + pool->trim_timeout - now_seconds();
+  pool->trim_source =
+      g_timeout_add_seconds(MAX(delay, 1), (GSourceFunc) on_trim, pool);
+}
+
+PoolEntry* take_entry(GSList **list, gint width, gint height) {
+  GSList *l = *list;
+  PoolEntry *entry = NULL;
+
+  for (; l; l = l->next) {
+    entry = (PoolEntry*) l->data;
+    if (entry->width == width && entry->height == height) {
+      *list = g_slist_delete_link(*list, l);
+      return entry;
+    }
+  }
+  return NULL;
+}
+
+GSList* put_entry(GSList *list, gpointer data
+                      , gint width, gint height) {
+  PoolEntry *entry = g_new(PoolEntry, 1);
+
+  entry->data = data;
+  entry->width = width;
+  entry->height = height;
+  entry->released = now_seconds();
+
+  return g_slist_prepend(list, entry);
+}
+
+/** 释放在before之前放入缓存池的缓存 */
+GSList* trim_entries(GSList *list, glong before
+                        , GDestroyNotify free_func) {
+  GSList *l = list, *next = NULL;
+  PoolEntry *entry = NULL;
+
+  while (l) {
+    next = l->next;
+    entry = (PoolEntry*) l->data;
+    if (entry->released <= before) {
+#ifdef GTK_SHOT_DEBUG
+      debug("free idle buffer(%dx%d)\n", entry->width, entry->height);
+#endif
+      free_func(entry->data);
+      g_free(entry);
+      list = g_slist_delete_link(list, l);
+    }
+    l = next;
+  }
+  return list;
+}
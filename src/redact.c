@@ -0,0 +1,286 @@
+/*
+ * GtkShot - A screen capture programme using GtkLib
+ * Copyright (C) 2012 flytreeleft @ CrazyDan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <config.h>
+
+#include <string.h>
+#ifdef __SSE2__
+# include <emmintrin.h>
+#endif
+
+#include <gtk/gtk.h>
+
+#include "utils.h"
+
+#include "redact.h"
+
+#define PIXEL_SIZE 4
+
+static void box_blur_rows(guchar *data, gint width, gint height
+                            , gint stride, gint radius);
+static void box_blur_columns(guchar *data, gint width, gint height
+                                , gint stride, gint radius);
+static void update_sums(guint16 *restrict sums, const guchar *add
+                          , const guchar *sub, gint n);
+static void average_sums(guchar *restrict dst, const guint16 *sums
+                            , gint n, guint16 inv);
+
+/**
+ * 将RGB(A)图像的区域转换为不透明的ARGB32图像,
+ * scale大于1时按scale x scale的块取平均值缩小,
+ * data的宽高为区域宽高除以scale(向上取整).
+ * 各行的块先在局部变量中累加,再按通道累加到同一个数组中
+ */
+void gtk_shot_redact_import(guchar *data, gint stride
+                              , const guchar *pixels, gint rowstride
+                              , gint n_channels, gint width, gint height
+                              , gint scale) {
+  g_return_if_fail(data != NULL && pixels != NULL && scale > 0);
+
+  gint cols = (width + scale - 1) / scale;
+  guint32 *sums = g_new(guint32, cols * 3);
+  gint x = 0, y = 0, i = 0, by = 0;
+
+  for (by = 0; by < height; by += scale) {
+    gint rows = MIN(scale, height - by);
+    guint32 *q = (guint32*) (data + by / scale * stride);
+
+    memset(sums, 0, cols * 3 * sizeof(guint32));
+    for (y = by; y < by + rows; y++) {
+      const guchar *p = pixels + y * rowstride;
+      for (i = 0; i < cols; i++) {
+        gint n = MIN(scale, width - i * scale);
+        guint32 r = 0, g = 0, b = 0;
+        for (x = 0; x < n; x++, p += n_channels) {
+          r += p[0];
+          g += p[1];
+          b += p[2];
+        }
+        sums[i * 3] += r;
+        sums[i * 3 + 1] += g;
+        sums[i * 3 + 2] += b;
+      }
+    }
+    for (i = 0; i < cols; i++) {
+      guint32 n = MIN(scale, width - i * scale) * rows;
+      const guint32 *s = sums + i * 3;
+      q[i] = 0xff000000 | ((s[0] + n / 2) / n << 16)
+                | ((s[1] + n / 2) / n << 8) | ((s[2] + n / 2) / n);
+    }
+  }
+  g_free(sums);
+}
+
+/**
+ * 马赛克: 每个block x block的块填充为块内的平均值.
+ * 块内各行按通道累加到同一个数组中
+ */
+void gtk_shot_redact_pixelate(guchar *data, gint width, gint height
+                                , gint stride, gint block) {
+  g_return_if_fail(data != NULL && block > 0);
+
+  gint blocks = (width + block - 1) / block;
+  guint32 *sums = g_new(guint32, blocks * PIXEL_SIZE);
+  guchar *avgs = g_new(guchar, blocks * PIXEL_SIZE);
+  gint x = 0, y = 0, i = 0, c = 0, by = 0;
+
+  for (by = 0; by < height; by += block) {
+    gint rows = MIN(block, height - by);
+
+    memset(sums, 0, blocks * PIXEL_SIZE * sizeof(guint32));
+    for (y = by; y < by + rows; y++) {
+      const guchar *p = data + y * stride;
+      for (i = 0; i < blocks; i++) {
+        gint cols = MIN(block, width - i * block);
+        guint32 *s = sums + i * PIXEL_SIZE;
+        for (x = 0; x < cols; x++, p += PIXEL_SIZE) {
+          for (c = 0; c < PIXEL_SIZE; c++) s[c] += p[c];
+        }
+      }
+    }
+    for (i = 0; i < blocks; i++) {
+      guint32 n = MIN(block, width - i * block) * rows;
+      for (c = 0; c < PIXEL_SIZE; c++) {
+        avgs[i * PIXEL_SIZE + c] = sums[i * PIXEL_SIZE + c] / n;
+      }
+    }
+    for (y = by; y < by + rows; y++) {
+      guchar *p = data + y * stride;
+      for (i = 0; i < blocks; i++) {
+        gint cols = MIN(block, width - i * block);
+        const guchar *a = avgs + i * PIXEL_SIZE;
+        for (x = 0; x < cols; x++, p += PIXEL_SIZE) {
+          for (c = 0; c < PIXEL_SIZE; c++) p[c] = a[c];
+        }
+      }
+    }
+  }
+  g_free(sums);
+  g_free(avgs);
+}
+
+/**
+ * 模糊: 三次半径为radius的可分离盒式模糊,
+ * 合成后近似标准差为radius的高斯模糊,
+ * 每次模糊的耗时与半径无关.
+ * 模糊前先做小块马赛克,去除可被反卷积恢复的细节,
+ * 保证原始内容不可还原
+ */
+void gtk_shot_redact_blur(guchar *data, gint width, gint height
+                            , gint stride, gint radius) {
+  g_return_if_fail(data != NULL && radius > 0);
+
+  gtk_shot_redact_pixelate(data, width, height, stride
+                            , GTK_SHOT_REDACT_BLUR_BLOCK);
+  gtk_shot_redact_box_blur(data, width, height, stride, radius);
+}
+
+/** 仅做三次盒式模糊,不去除细节(用于已缩小的预览图像) */
+void gtk_shot_redact_box_blur(guchar *data, gint width, gint height
+                                , gint stride, gint radius) {
+  g_return_if_fail(data != NULL && radius > 0);
+
+  gint i = 0, r = MIN(radius, GTK_SHOT_REDACT_MAX_RADIUS);
+
+  for (i = 0; i < 3; i++) {
+    box_blur_rows(data, width, height, stride, r);
+    box_blur_columns(data, width, height, stride, r);
+  }
+}
+
+/**
+ * 水平方向: 逐行计算滑动窗口的和,越界的像素取边缘像素.
+ * 四个通道的窗口和一起更新,每行只遍历一次.
+ * 平均值由取整后的16位定点倒数计算并四舍五入,
+ * 多次模糊后亮度不会逐渐变暗
+ */
+void box_blur_rows(guchar *data, gint width, gint height
+                      , gint stride, gint radius) {
+  guchar *row = g_new(guchar, width * PIXEL_SIZE);
+  guint32 d = 2 * radius + 1, inv = ((1 << 16) + d / 2) / d;
+  guint32 sum[PIXEL_SIZE];
+  gint x = 0, y = 0, i = 0, c = 0;
+
+  for (y = 0; y < height; y++) {
+    guchar *restrict dst = data + y * stride;
+
+    memcpy(row, dst, width * PIXEL_SIZE);
+    for (c = 0; c < PIXEL_SIZE; c++) sum[c] = row[c] * (radius + 1);
+    for (i = 1; i <= radius; i++) {
+      const guchar *p = row + MIN(i, width - 1) * PIXEL_SIZE;
+      for (c = 0; c < PIXEL_SIZE; c++) sum[c] += p[c];
+    }
+    for (x = 0; x < width; x++, dst += PIXEL_SIZE) {
+      const guchar *add = row + MIN(x + radius + 1, width - 1) * PIXEL_SIZE;
+      const guchar *sub = row + MAX(x - radius, 0) * PIXEL_SIZE;
+      for (c = 0; c < PIXEL_SIZE; c++) {
+        dst[c] = (sum[c] * inv + (1 << 15)) >> 16;
+        sum[c] += add[c] - sub[c];
+      }
+    }
+  }
+  g_free(row);
+}
+
+/**
+ * 垂直方向: 所有列的窗口和保存在一个数组中,逐行整体更新.
+ * 半径不超过GTK_SHOT_REDACT_MAX_RADIUS时窗口和不超过16位,
+ * 逐行的更新和求平均均为连续的16位运算,便于向量化.
+ * 已被覆盖的原始行保存在radius + 1行的环形缓冲中
+ */
+void box_blur_columns(guchar *data, gint width, gint height
+                        , gint stride, gint radius) {
+  gint n = width * PIXEL_SIZE, slots = radius + 1;
+  guint16 *sums = g_new(guint16, n);
+  guchar *ring = g_new(guchar, slots * n);
+  guchar *first = g_new(guchar, n);
+  guint32 d = 2 * radius + 1, inv = ((1 << 16) + d / 2) / d;
+  gint y = 0, i = 0, j = 0;
+
+  memcpy(first, data, n);
+  for (i = 0; i < n; i++) sums[i] = first[i] * (radius + 1);
+  for (j = 1; j <= radius; j++) {
+    const guchar *p = data + MIN(j, height - 1) * stride;
+    for (i = 0; i < n; i++) sums[i] += p[i];
+  }
+  for (y = 0; y < height; y++) {
+    guchar *dst = data + y * stride;
+
+    memcpy(ring + (y % slots) * n, dst, n);
+    average_sums(dst, sums, n, inv);
+    if (y == height - 1) break;
+
+    const guchar *add = data + MIN(y + radius + 1, height - 1) * stride;
+    const guchar *sub = y - radius < 0 ?
+                          first : ring + ((y - radius) % slots) * n;
+    update_sums(sums, add, sub, n);
+  }
+  g_free(sums);
+  g_free(ring);
+  g_free(first);
+}
+
+/** 窗口和加上新进入的行,减去移出的行(模2^16运算,结果不会越界) */
+void update_sums(guint16 *restrict sums, const guchar *add
+                    , const guchar *sub, gint n) {
+  gint i = 0;
+
+#ifdef __SSE2__
+  const __m128i zero = _mm_setzero_si128();
+
+  for (; i + 16 <= n; i += 16) {
+    __m128i a = _mm_loadu_si128((const __m128i*) (add + i));
+    __m128i b = _mm_loadu_si128((const __m128i*) (sub + i));
+    __m128i lo = _mm_loadu_si128((const __m128i*) (sums + i));
+    __m128i hi = _mm_loadu_si128((const __m128i*) (sums + i + 8));
+
+    lo = _mm_add_epi16(lo, _mm_sub_epi16(_mm_unpacklo_epi8(a, zero)
+                                        , _mm_unpacklo_epi8(b, zero)));
+    hi = _mm_add_epi16(hi, _mm_sub_epi16(_mm_unpackhi_epi8(a, zero)
+                                        , _mm_unpackhi_epi8(b, zero)));
+    _mm_storeu_si128((__m128i*) (sums + i), lo);
+    _mm_storeu_si128((__m128i*) (sums + i + 8), hi);
+  }
+#endif
+  for (; i < n; i++) sums[i] += add[i] - sub[i];
+}
+
+/**
+ * 求平均: (sum * inv + 2^15) >> 16.
+ * SSE2中取乘积的高16位,低16位的最高位即为四舍五入的进位,
+ * 与标量计算的结果完全相同
+ */
+void average_sums(guchar *restrict dst, const guint16 *sums
+                    , gint n, guint16 inv) {
+  gint i = 0;
+
+#ifdef __SSE2__
+  const __m128i factor = _mm_set1_epi16((gshort) inv);
+
+  for (; i + 16 <= n; i += 16) {
+    __m128i lo = _mm_loadu_si128((const __m128i*) (sums + i));
+    __m128i hi = _mm_loadu_si128((const __m128i*) (sums + i + 8));
+
+    lo = _mm_add_epi16(_mm_mulhi_epu16(lo, factor)
+                        , _mm_srli_epi16(_mm_mullo_epi16(lo, factor), 15));
+    hi = _mm_add_epi16(_mm_mulhi_epu16(hi, factor)
+                        , _mm_srli_epi16(_mm_mullo_epi16(hi, factor), 15));
+    _mm_storeu_si128((__m128i*) (dst + i), _mm_packus_epi16(lo, hi));
+  }
+#endif
+  for (; i < n; i++) dst[i] = ((guint32) sums[i] * inv + (1 << 15)) >> 16;
+}
@@ -0,0 +1,369 @@
+/*
+ * GtkShot - A screen capture programme using GtkLib
+ * Copyright (C) 2012 flytreeleft @ CrazyDan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <config.h>
+
+#include <string.h>
+#include <errno.h>
+
+#include <gtk/gtk.h>
+
+#include "utils.h"
+#include "trace.h"
+#include "memory.h"
+
+#include "replay.h"
+
+#define TILE GTK_SHOT_REPLAY_TILE
+
+typedef struct _ReplayTile {
+  guint32 hash;
+  gint ref;
+  gint len, height; // 每行字节数,行数
+  guchar data[]; // 紧密排列的像素
+} ReplayTile;
+
+typedef struct _ReplayFrame {
+  gint64 time; // 采样时间(毫秒)
+  gint width, height;
+  gint cols, rows; // 图块的列数和行数
+  ReplayTile **tiles;
+} ReplayFrame;
+
+static gboolean on_sample(GtkShotReplay *replay);
+
+static gint64 now_milliseconds();
+static guint32 hash_tile(const guchar *pixels, gint rowstride
+                            , gint len, gint height);
+static gboolean tile_equal(ReplayTile *tile, const guchar *pixels
+                              , gint rowstride);
+static ReplayFrame* frame_new(GtkShotReplay *replay, GdkPixbuf *pixbuf
+                                  , ReplayFrame *last);
+static void frame_free(GtkShotReplay *replay, ReplayFrame *frame);
+static GdkPixbuf* frame_to_pixbuf(ReplayFrame *frame);
+static void evict_frames(GtkShotReplay *replay, gint64 now);
+
+/**
+ * @param seconds 保留的时长(秒)
+ * @param budget 图块占用内存的上限(MiB)
+ */
+GtkShotReplay* gtk_shot_replay_new(GdkWindow *root, gint seconds
+                                      , gsize budget) {
+  GtkShotReplay *replay = g_new(GtkShotReplay, 1);
+
+  replay->root = root;
+  replay->seconds = MAX(seconds, 1);
+  replay->interval = GTK_SHOT_REPLAY_INTERVAL;
+  replay->budget = budget << 20;
+  replay->frames = g_queue_new();
+  replay->scratch = NULL;
+  replay->bytes = 0;
+  replay->source = 0;
+  replay->timer = g_timer_new();
+  g_timer_stop(replay->timer);
+  replay->busy = 0;
+  replay->samples = 0;
+
+  return replay;
+}
+
+void gtk_shot_replay_destroy(GtkShotReplay *replay) {
+  g_return_if_fail(replay != NULL);
+
+  gtk_shot_replay_stop(replay);
+  while (!g_queue_is_empty(replay->frames)) {
+    frame_free(replay, g_queue_pop_head(replay->frames));
+  }
+  g_queue_free(replay->frames);
+  if (replay->scratch) {
+    g_object_unref(replay->scratch);
+  }
+  g_timer_destroy(replay->timer);
+  g_free(replay);
+}
+
+/** 开始后台采样,截图窗口显示期间应停止采样 */
+void gtk_shot_replay_start(GtkShotReplay *replay) {
+  g_return_if_fail(replay != NULL);
+
+  if (replay->source) return;
+  replay->source = g_timeout_add(replay->interval
+                                    , (GSourceFunc) on_sample, replay);
+  g_timer_continue(replay->timer);
+}
+
+void gtk_shot_replay_stop(GtkShotReplay *replay) {
+  g_return_if_fail(replay != NULL);
+
+  if (!replay->source) return;
+  g_source_remove(replay->source);
+  replay->source = 0;
+  g_timer_stop(replay->timer);
+}
+
+/**
+ * 获取seconds_ago秒之前的画面,不足时返回最早的画面
+ * @return 新建的整屏截图,无画面时返回NULL
+ */
+GdkPixbuf* gtk_shot_replay_get_frame(GtkShotReplay *replay
+                                        , gint seconds_ago) {
+  g_return_val_if_fail(replay != NULL, NULL);
+
+  gint64 time = now_milliseconds() - seconds_ago * 1000;
+  ReplayFrame *frame = NULL;
+  GList *l = g_queue_peek_tail_link(replay->frames);
+
+  for (l; l; l = l->prev) {
+    frame = (ReplayFrame*) l->data;
+    if (frame->time <= time) break;
+  }
+  return frame ? frame_to_pixbuf(frame) : NULL;
+}
+
+/**
+ * 将所有画面按时间顺序保存为dir目录下的PNG图像序列
+ * @return 保存的画面数,失败时返回-1
+ */
+gint gtk_shot_replay_export(GtkShotReplay *replay, const char *dir
+                                , GError **error) {
+  g_return_val_if_fail(replay != NULL && dir != NULL, -1);
+
+  if (g_mkdir_with_parents(dir, 0755) != 0) {
+    g_set_error(error, G_FILE_ERROR
+                  , g_file_error_from_errno(errno)
+                  , "%s: %s", dir, g_strerror(errno));
+    return -1;
+  }
+  GList *l = g_queue_peek_head_link(replay->frames);
+  gint count = 0;
+  gboolean succ = TRUE;
+
+  for (l; l && succ; l = l->next, count++) {
+    GdkPixbuf *pixbuf = frame_to_pixbuf((ReplayFrame*) l->data);
+    gchar *name = g_strdup_printf("replay-%04d.png", count);
+    gchar *filename = g_build_filename(dir, name, NULL);
+
+    trace_begin("encode");
+    succ = gdk_pixbuf_save(pixbuf, filename, "png", error, NULL);
+    trace_end("encode");
+    g_object_unref(pixbuf);
+    g_free(filename);
+    g_free(name);
+  }
+  return succ ? count : -1;
+}
+
+/** 输出稳定运行时的内存和CPU开销 */
+void gtk_shot_replay_report(GtkShotReplay *replay) {
+  g_return_if_fail(replay != NULL);
+
+  gdouble elapsed = g_timer_elapsed(replay->timer, NULL);
+  gsize scratch = gtk_shot_replay_get_memory(replay) - replay->bytes;
+
+  g_print("replay: %u frame(s), %" G_GSIZE_FORMAT " KiB in tiles"
+          ", %" G_GSIZE_FORMAT " KiB scratch"
+          ", %.2f%% CPU (%.2f ms/sample, %u samples)\n"
+          , g_queue_get_length(replay->frames)
+          , replay->bytes >> 10, scratch >> 10
+          , elapsed > 0 ? replay->busy * 100 / elapsed : 0.0
+          , replay->samples ? replay->busy * 1000 / replay->samples : 0.0
+          , replay->samples);
+}
+
+/** 图块及截图缓存占用的内存(字节) */
+gsize gtk_shot_replay_get_memory(GtkShotReplay *replay) {
+  g_return_val_if_fail(replay != NULL, 0);
+
+  gsize scratch = replay->scratch
+        ? (gsize) gdk_pixbuf_get_rowstride(replay->scratch)
+            * gdk_pixbuf_get_height(replay->scratch)
+        : 0;
+
+  return replay->bytes + scratch;
+}
+
+gboolean on_sample(GtkShotReplay *replay) {
+  gdouble start = g_timer_elapsed(replay->timer, NULL);
+  GdkScreen *screen = gdk_drawable_get_screen(replay->root);
+  gint width = gdk_screen_get_width(screen);
+  gint height = gdk_screen_get_height(screen);
+
+  // 屏幕尺寸变化(RandR)时重建截图缓存
+  if (replay->scratch
+        && (gdk_pixbuf_get_width(replay->scratch) != width
+            || gdk_pixbuf_get_height(replay->scratch) != height)) {
+    g_object_unref(replay->scratch);
+    replay->scratch = NULL;
+  }
+  replay->scratch =
+    gdk_pixbuf_get_from_drawable(replay->scratch, replay->root, NULL
+                                    , 0, 0, 0, 0, width, height);
+  if (!replay->scratch) return TRUE;
+
+  ReplayFrame *frame =
+      frame_new(replay, replay->scratch
+                  , g_queue_peek_tail(replay->frames));
+  g_queue_push_tail(replay->frames, frame);
+  evict_frames(replay, frame->time);
+
+  replay->busy += g_timer_elapsed(replay->timer, NULL) - start;
+  replay->samples++;
+  gtk_shot_memory_sample();
+
+  return TRUE;
+}
+
+gint64 now_milliseconds() {
+  GTimeVal tv;
+  g_get_current_time(&tv);
+
+  return (gint64) tv.tv_sec * 1000 + tv.tv_usec / 1000;
+}
+
+/** FNV-1a, 按32位字计算以加快速度 */
+guint32 hash_tile(const guchar *pixels, gint rowstride
+                      , gint len, gint height) {
+  guint32 hash = 2166136261u, word = 0;
+  gint x = 0, y = 0;
+
+  for (y = 0; y < height; y++) {
+    const guchar *p = pixels + y * rowstride;
+    for (x = 0; x + 4 <= len; x += 4) {
+      memcpy(&word, p + x, 4);
+      hash = (hash ^ word) * 16777619u;
+    }
+    for (x; x < len; x++) {
+      hash = (hash ^ p[x]) * 16777619u;
+    }
+  }
+  return hash;
+}
+
+gboolean tile_equal(ReplayTile *tile, const guchar *pixels
+                        , gint rowstride) {
+  gint y = 0;
+
+  for (y = 0; y < tile->height; y++) {
+    if (memcmp(tile->data + y * tile->len
+                  , pixels + y * rowstride, tile->len) != 0) {
+      return FALSE;
+    }
+  }
+  return TRUE;
+}
+
+/**
+ * 将截图划分为图块,散列值相同且内容一致的图块
+ * 直接引用上一帧中的图块
+ */
+ReplayFrame* frame_new(GtkShotReplay *replay, GdkPixbuf *pixbuf
+                          , ReplayFrame *last) {
+  ReplayFrame *frame = g_new(ReplayFrame, 1);
+  guchar *pixels = gdk_pixbuf_get_pixels(pixbuf);
+  gint rowstride = gdk_pixbuf_get_rowstride(pixbuf);
+  gint channels = gdk_pixbuf_get_n_channels(pixbuf);
+  gint col = 0, row = 0, y = 0;
+
+  frame->time = now_milliseconds();
+  frame->width = gdk_pixbuf_get_width(pixbuf);
+  frame->height = gdk_pixbuf_get_height(pixbuf);
+  frame->cols = (frame->width + TILE - 1) / TILE;
+  frame->rows = (frame->height + TILE - 1) / TILE;
+  frame->tiles = g_new(ReplayTile*, frame->cols * frame->rows);
+  if (last && (last->width != frame->width
+                || last->height != frame->height)) {
+    last = NULL;
+  }
+
+  for (row = 0; row < frame->rows; row++) {
+    for (col = 0; col < frame->cols; col++) {
+      gint i = row * frame->cols + col;
+      gint len = MIN(TILE, frame->width - col * TILE) * channels;
+      gint height = MIN(TILE, frame->height - row * TILE);
+      guchar *p = pixels + row * TILE * rowstride
+                    + col * TILE * channels;
+      guint32 hash = hash_tile(p, rowstride, len, height);
+      ReplayTile *tile = last ? last->tiles[i] : NULL;
+
+      if (tile && tile->hash == hash
+            && tile_equal(tile, p, rowstride)) {
+        tile->ref++;
+      } else {
+        tile = g_malloc(sizeof(ReplayTile) + len * height);
+        tile->hash = hash;
+        tile->ref = 1;
+        tile->len = len;
+        tile->height = height;
+        for (y = 0; y < height; y++) {
+          memcpy(tile->data + y * len, p + y * rowstride, len);
+        }
+        replay->bytes += len * height;
+      }
+      frame->tiles[i] = tile;
+    }
+  }
+  return frame;
+}
+
+void frame_free(GtkShotReplay *replay, ReplayFrame *frame) {
+  gint i = 0;
+
+  for (i = 0; i < frame->cols * frame->rows; i++) {
+    ReplayTile *tile = frame->tiles[i];
+    if (--tile->ref == 0) {
+      replay->bytes -= tile->len * tile->height;
+      g_free(tile);
+    }
+  }
+  g_free(frame->tiles);
+  g_free(frame);
+}
+
+GdkPixbuf* frame_to_pixbuf(ReplayFrame *frame) {
+  GdkPixbuf *pixbuf = gdk_pixbuf_new(GDK_COLORSPACE_RGB, FALSE, 8
+                                        , frame->width, frame->height);
+  guchar *pixels = gdk_pixbuf_get_pixels(pixbuf);
+  gint rowstride = gdk_pixbuf_get_rowstride(pixbuf);
+  gint channels = gdk_pixbuf_get_n_channels(pixbuf);
+  gint col = 0, row = 0, y = 0;
+
+  for (row = 0; row < frame->rows; row++) {
+    for (col = 0; col < frame->cols; col++) {
+      ReplayTile *tile = frame->tiles[row * frame->cols + col];
+      guchar *p = pixels + row * TILE * rowstride
+                    + col * TILE * channels;
+      for (y = 0; y < tile->height; y++) {
+        memcpy(p + y * rowstride, tile->data + y * tile->len, tile->len);
+      }
+    }
+  }
+  return pixbuf;
+}
+
+/** 丢弃过期或超出内存上限的旧画面,但至少保留最新的画面 */
+void evict_frames(GtkShotReplay *replay, gint64 now) {
+  ReplayFrame *frame = NULL;
+
+  while (g_queue_get_length(replay->frames) > 1) {
+    frame = (ReplayFrame*) g_queue_peek_head(replay->frames);
+    if (replay->bytes <= replay->budget
+          && frame->time >= now - replay->seconds * 1000) {
+      break;
+    }
+    frame_free(replay, g_queue_pop_head(replay->frames));
+  }
+}
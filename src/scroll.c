@@ -0,0 +1,240 @@
+/*
+ * GtkShot - A screen capture programme using GtkLib
+ * Copyright (C) 2012 flytreeleft @ CrazyDan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <config.h>
+
+#include <string.h>
+
+#include <gtk/gtk.h>
+
+#include "utils.h"
+
+#include "scroll.h"
+
+#define FNV_OFFSET 14695981039346656037ULL
+#define FNV_PRIME 1099511628211ULL
+
+static void hash_rows(GdkPixbuf *frame, guint64 *hashes);
+static gint find_offset(GtkShotScroll *scroll, gint *footer);
+static void append_rows(GtkShotScroll *scroll, GdkPixbuf *frame
+                          , gint start, gint count);
+
+GtkShotScroll* gtk_shot_scroll_new() {
+  GtkShotScroll *scroll = g_new(GtkShotScroll, 1);
+
+  scroll->pixels = NULL;
+  scroll->hashes = NULL;
+  scroll->frame_hashes = NULL;
+  gtk_shot_scroll_reset(scroll);
+
+  return scroll;
+}
+
+void gtk_shot_scroll_destroy(GtkShotScroll *scroll) {
+  g_return_if_fail(scroll != NULL);
+
+  gtk_shot_scroll_reset(scroll);
+  g_free(scroll);
+}
+
+void gtk_shot_scroll_reset(GtkShotScroll *scroll) {
+  g_return_if_fail(scroll != NULL);
+
+  g_free(scroll->pixels);
+  g_free(scroll->hashes);
+  g_free(scroll->frame_hashes);
+  scroll->pixels = NULL;
+  scroll->hashes = NULL;
+  scroll->frame_hashes = NULL;
+  scroll->width = scroll->height = 0;
+  scroll->n_channels = 0;
+  scroll->rowstride = 0;
+  scroll->rows = scroll->capacity = 0;
+  scroll->lost = FALSE;
+}
+
+/**
+ * 追加一帧,帧的尺寸需与第一帧相同
+ * @return 新追加的行数; 与上一帧没有重叠时返回-1
+ */
+gint gtk_shot_scroll_append(GtkShotScroll *scroll, GdkPixbuf *frame) {
+  g_return_val_if_fail(scroll != NULL && frame != NULL, -1);
+
+  gint width = gdk_pixbuf_get_width(frame);
+  gint height = gdk_pixbuf_get_height(frame);
+
+  if (!scroll->pixels) {
+    scroll->width = width;
+    scroll->height = height;
+    scroll->n_channels = gdk_pixbuf_get_n_channels(frame);
+    scroll->rowstride = width * scroll->n_channels;
+    scroll->hashes = g_new(guint64, height);
+    scroll->frame_hashes = g_new(guint64, height);
+    hash_rows(frame, scroll->hashes);
+    append_rows(scroll, frame, 0, height);
+    return height;
+  }
+  if (width != scroll->width || height != scroll->height
+        || gdk_pixbuf_get_n_channels(frame) != scroll->n_channels) {
+    return -1;
+  }
+
+  gint footer = 0, offset = 0;
+  hash_rows(frame, scroll->frame_hashes);
+  offset = find_offset(scroll, &footer);
+  scroll->lost = offset < 0;
+  if (offset <= 0) return offset;
+
+  // 长图末尾为上一帧的底部固定行,将其替换为新出现的行和新帧的底部
+  scroll->rows -= footer;
+  append_rows(scroll, frame, height - footer - offset, offset + footer);
+
+  guint64 *tmp = scroll->hashes;
+  scroll->hashes = scroll->frame_hashes;
+  scroll->frame_hashes = tmp;
+#ifdef GTK_SHOT_DEBUG
+  debug("scroll %d rows (footer: %d), total %d rows\n"
+            , offset, footer, scroll->rows);
+#endif
+  return offset;
+}
+
+/**
+ * 结束拼接,长图的像素数据直接转交给返回的GdkPixbuf
+ * @return 长图; 没有任何帧时返回NULL
+ */
+GdkPixbuf* gtk_shot_scroll_finish(GtkShotScroll *scroll) {
+  g_return_val_if_fail(scroll != NULL, NULL);
+
+  if (!scroll->pixels) return NULL;
+
+  guchar *pixels = g_realloc(scroll->pixels
+                              , (gsize) scroll->rows * scroll->rowstride);
+  GdkPixbuf *pixbuf =
+      gdk_pixbuf_new_from_data(pixels, GDK_COLORSPACE_RGB
+                                , scroll->n_channels == 4
+                                , 8
+                                , scroll->width, scroll->rows
+                                , scroll->rowstride
+                                , (GdkPixbufDestroyNotify) g_free
+                                , NULL);
+  scroll->pixels = NULL;
+  gtk_shot_scroll_reset(scroll);
+
+  return pixbuf;
+}
+
+/** 长图(按已分配的行数)及行哈希占用的内存(字节) */
+gsize gtk_shot_scroll_get_memory(GtkShotScroll *scroll) {
+  g_return_val_if_fail(scroll != NULL, 0);
+
+  if (!scroll->pixels) return 0;
+  return (gsize) scroll->capacity * scroll->rowstride
+            + 2 * scroll->height * sizeof(guint64);
+}
+
+/** 每行的FNV-1a哈希值(不含行尾的填充字节) */
+void hash_rows(GdkPixbuf *frame, guint64 *hashes) {
+  gint width = gdk_pixbuf_get_width(frame);
+  gint height = gdk_pixbuf_get_height(frame);
+  gint length = width * gdk_pixbuf_get_n_channels(frame);
+  gint rowstride = gdk_pixbuf_get_rowstride(frame);
+  const guchar *pixels = gdk_pixbuf_get_pixels(frame);
+  gint x = 0, y = 0;
+
+  for (y = 0; y < height; y++, pixels += rowstride) {
+    guint64 hash = FNV_OFFSET;
+    for (x = 0; x < length; x++) {
+      hash = (hash ^ pixels[x]) * FNV_PRIME;
+    }
+    hashes[y] = hash;
+  }
+}
+
+/**
+ * 计算新帧相对上一帧向上滚动的行数:
+ * 跳过两帧中相同的顶部行和底部行(固定不动的部分)后,
+ * 取新帧可滚动部分的前GTK_SHOT_SCROLL_ANCHOR行作为锚点,
+ * 在上一帧中用滚动哈希查找锚点,匹配行数最多的位置即为滚动的行数
+ * @return 滚动的行数; 两帧相同时返回0; 找不到时返回-1
+ */
+gint find_offset(GtkShotScroll *scroll, gint *footer) {
+  const guint64 *prev = scroll->hashes, *cur = scroll->frame_hashes;
+  gint height = scroll->height;
+  gint header = 0, content = 0, anchor = 0;
+  gint d = 0, i = 0, best = -1, best_score = 0;
+  guint64 target = 0, window = 0, power = 1;
+
+  while (header < height && cur[header] == prev[header]) header++;
+  if (header == height) return 0;
+  *footer = 0;
+  while (*footer < height - header
+          && cur[height - 1 - *footer] == prev[height - 1 - *footer]) {
+    (*footer)++;
+  }
+  content = height - header - *footer;
+  anchor = MIN(GTK_SHOT_SCROLL_ANCHOR, content / 2);
+  if (anchor <= 0) return -1;
+
+  for (i = 0; i < anchor; i++) {
+    target = target * FNV_PRIME + cur[header + i];
+    window = window * FNV_PRIME + prev[header + 1 + i];
+    if (i > 0) power *= FNV_PRIME;
+  }
+  for (d = 1; d + anchor <= content; d++) {
+    if (d > 1) {
+      window = (window - prev[header + d - 1] * power) * FNV_PRIME
+                  + prev[header + d + anchor - 1];
+    }
+    if (window != target
+          || memcmp(cur + header, prev + header + d
+                      , anchor * sizeof(guint64)) != 0) {
+      continue;
+    }
+    // 锚点可能在空白区域中多次匹配,取整个重叠部分匹配最多者
+    gint score = 0;
+    for (i = header; i < height - *footer - d; i++) {
+      score += cur[i] == prev[i + d];
+    }
+    if (score > best_score) {
+      best_score = score;
+      best = d;
+    }
+  }
+  return best;
+}
+
+/** 将帧中[start, start + count)行追加到长图中,空间按倍数扩展 */
+void append_rows(GtkShotScroll *scroll, GdkPixbuf *frame
+                    , gint start, gint count) {
+  gint rowstride = gdk_pixbuf_get_rowstride(frame);
+  const guchar *pixels = gdk_pixbuf_get_pixels(frame);
+  gint i = 0;
+
+  if (scroll->rows + count > scroll->capacity) {
+    scroll->capacity = MAX(scroll->capacity * 2, scroll->rows + count);
+    scroll->pixels = g_realloc(scroll->pixels
+                                , (gsize) scroll->capacity
+                                    * scroll->rowstride);
+  }
+  for (i = 0; i < count; i++) {
+    memcpy(scroll->pixels + (gsize) (scroll->rows + i) * scroll->rowstride
+            , pixels + (gsize) (start + i) * rowstride
+            , scroll->rowstride);
+  }
+  scroll->rows += count;
+}
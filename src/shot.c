@@ -18,14 +18,23 @@
 #include <config.h>
 
 #include <math.h>
+#include <string.h>
+#ifdef HAVE_MALLOC_TRIM
+#include <malloc.h>
+#endif
 
 #include <glib/gi18n.h>
 #include <gdk/gdkkeysyms.h>
+#include <gdk/gdkx.h>
 #include <gtk/gtk.h>
 
 #include "utils.h"
+#include "trace.h"
 
 #include "shot.h"
+#include "capture.h"
+#include "overlay.h"
+#include "memory.h"
 
 #define IS_OUT_RECT(x, y, x0, y0, x1, y1) \
           ( ((x) < (x0) || (x) > (x1)) \
@@ -55,6 +64,7 @@ static GdkCursorType cursor_pos_type[] = {
 static void gtk_shot_class_init(GtkShotClass *klass);
 static void gtk_shot_init(GtkShot *shot);
 static void gtk_shot_realize(GtkWidget *widget);
+static void gtk_shot_unrealize(GtkWidget *widget);
 static void gtk_shot_finalize(GObject *obj);
 // Events
 static gboolean on_shot_expose(GtkWidget *widget
@@ -69,10 +79,15 @@ static gboolean on_shot_key_press(GtkWidget *widget
                                           , GdkEventKey *event);
 static gboolean on_shot_key_release(GtkWidget *widget
                                           , GdkEventKey *event);
+static gboolean on_shot_event(GtkWidget *widget, GdkEvent *event);
+static void on_screen_damaged(GdkRectangle *rect, GtkShot *shot);
+static gboolean on_shot_map(GtkWidget *widget, GdkEvent *event);
+static gboolean on_scroll_timeout(GtkShot *shot);
+static gboolean on_idle_timeout(GtkShot *shot);
 
 // private(第一个参数为GtkShot时,函数名称以gtk_shot_开头)
 static void gtk_shot_process_edit_mode(GtkShot *shot
-                                          , GdkEventButton *event);
+                                          , GdkPoint *cursor);
 static void gtk_shot_draw_screen(GtkShot *shot, cairo_t *cr);
 static void gtk_shot_draw_section(GtkShot *shot, cairo_t *cr);
 static void gtk_shot_draw_doodle(GtkShot *shot, cairo_t *cr);
@@ -80,9 +95,23 @@ static void gtk_shot_draw_mask(GtkShot *shot, cairo_t *cr);
 static void gtk_shot_draw_anchor(GtkShot *shot, cairo_t *cr);
 static void gtk_shot_draw_message(GtkShot *shot, cairo_t *cr);
 static void gtk_shot_draw_tip(GtkShot *shot, cairo_t *cr);
+static void gtk_shot_draw_hover(GtkShot *shot, cairo_t *cr);
+static void gtk_shot_draw_hud(GtkShot *shot, cairo_t *cr);
+static gboolean gtk_shot_update_hover(GtkShot *shot, gint x, gint y);
 static void gtk_shot_clean_section(GtkShot *shot);
+static void gtk_shot_keep_section(GtkShot *shot);
 static void gtk_shot_clean_historic_pen(GtkShot *shot);
+static void gtk_shot_count_pen(GtkShot *shot, GtkShotPen *pen
+                                  , gboolean add);
+static gboolean gtk_shot_pick_pen(GtkShot *shot, GdkPoint *cursor
+                                    , GdkModifierType state);
+static void gtk_shot_drag_pen(GtkShot *shot, GdkPoint *cursor);
+static void gtk_shot_drop_pen(GtkShot *shot, GdkPoint *cursor);
+static void gtk_shot_unselect_pen(GtkShot *shot);
+static void gtk_shot_delete_selected_pen(GtkShot *shot);
+static void gtk_shot_invalidate_pen(GtkShot *shot, GtkShotPen *pen);
 static void gtk_shot_whole_section(GtkShot *shot);
+static void gtk_shot_select_bounds(GtkShot *shot);
 static void gtk_shot_move_section(GtkShot *shot, gint dx, gint dy);
 static void gtk_shot_resize_section(GtkShot *shot, gint dx, gint dy);
 static void gtk_shot_zoom_section(GtkShot *shot, gint x, gint y);
@@ -92,6 +121,25 @@ static void gtk_shot_get_zoom_anchor(GtkShot *shot, GdkPoint anchor[8]);
 static GtkShotCursorPos gtk_shot_get_cursor_pos(GtkShot *shot
                                                     , gint x, gint y);
 static void gtk_shot_change_cursor(GtkShot *shot);
+static void gtk_shot_load_cursors(GtkShot *shot);
+static void gtk_shot_capture_monitor(GtkShot *shot);
+static gboolean gtk_shot_restore_capture(GtkShot *shot);
+static void gtk_shot_expand(GtkShot *shot, GdkRectangle *area);
+static void gtk_shot_expand_to_section(GtkShot *shot);
+static void gtk_shot_set_bounds(GtkShot *shot, GdkRectangle *bounds);
+static void gtk_shot_fetch_screen(GtkShot *shot, GdkRectangle *area);
+static void gtk_shot_prepare_buffer(GtkShot *shot);
+static void gtk_shot_drop_buffer(GtkShot *shot);
+static void gtk_shot_snap_section(GtkShot *shot, gint x, gint y);
+static void gtk_shot_update_loupe(GtkShot *shot, GdkPoint *cursor);
+static void gtk_shot_update_live_area(GtkShot *shot);
+
+static gsize gtk_shot_probe_capture(GtkShot *shot);
+static gsize gtk_shot_probe_overlay(GtkShot *shot);
+static gsize gtk_shot_probe_doodle(GtkShot *shot);
+static gsize gtk_shot_probe_pens(GtkShot *shot);
+static gsize gtk_shot_probe_layouts(GtkShot *shot);
+static gsize gtk_shot_probe_encoder(GtkShot *shot);
 
 // Begin of GObject-related stuff
 G_DEFINE_TYPE(GtkShot, gtk_shot, GTK_TYPE_WINDOW)
@@ -102,12 +150,14 @@ void gtk_shot_class_init(GtkShotClass *klass) {
 
   obj_class->finalize = gtk_shot_finalize;
 
+  widget_class->unrealize = gtk_shot_unrealize;
   widget_class->expose_event = on_shot_expose;
   widget_class->button_press_event = on_shot_button_press;
   widget_class->button_release_event = on_shot_button_release;
   widget_class->motion_notify_event = on_shot_motion_notify;
   widget_class->key_press_event = on_shot_key_press;
   widget_class->key_release_event = on_shot_key_release;
+  widget_class->event = on_shot_event;
 }
 
 void gtk_shot_init(GtkShot *shot) {
@@ -122,10 +172,14 @@ void gtk_shot_init(GtkShot *shot) {
   shot->section.width = shot->section.height = 0;
   shot->section.border = GTK_SHOT_SECTION_BORDER;
   shot->section.color = GTK_SHOT_SECTION_COLOR;
+  shot->last_section.x = shot->last_section.y = 0;
+  shot->last_section.width = shot->last_section.height = 0;
   shot->move_start.x = shot->move_start.y = 0;
   shot->move_end.x = shot->move_end.y = 0;
   shot->cursor_pos = OUTER_OF_SECTION;
   shot->historic_pen = NULL;
+  shot->historic_count = 0;
+  shot->historic_memory = 0;
   shot->pen = NULL;
   shot->toolbar = gtk_shot_toolbar_new(shot);
   shot->input = gtk_shot_input_new(shot);
@@ -142,17 +196,67 @@ void gtk_shot_init(GtkShot *shot) {
   GdkColormap *colormap = gdk_screen_get_rgba_colormap(screen);
   gtk_widget_set_app_paintable(GTK_WIDGET(shot), TRUE);
   gtk_widget_set_colormap(GTK_WIDGET(shot), colormap);
+  // 重绘时直接使用服务端的后备缓冲,无需GTK每次新建缓冲
+  gtk_widget_set_double_buffered(GTK_WIDGET(shot), FALSE);
 
+  // 窗口范围及遮罩层在显示时按鼠标所在显示器确定
   shot->x = shot->y = 0;
-  shot->width = gdk_screen_get_width(screen);
-  shot->height = gdk_screen_get_height(screen);
-  shot->mask_surface =
-                cairo_image_surface_create(CAIRO_FORMAT_ARGB32
-                                                , shot->width
-                                                , shot->height);
-  // 全屏窗口
-  gtk_window_set_default_size(GTK_WINDOW(shot)
-                                , shot->width, shot->height);
+  shot->width = shot->height = 0;
+  shot->mask_surface = NULL;
+  shot->mask_cr = NULL;
+  shot->window_cr = NULL;
+  shot->buffer_surface = NULL;
+  shot->buffer_cr = NULL;
+  shot->screen_surface = NULL;
+  shot->screen_dirty.x = shot->screen_dirty.y = 0;
+  shot->screen_dirty.width = shot->screen_dirty.height = 0;
+  shot->message_layout = NULL;
+  shot->pool = gtk_shot_pool_new(screen);
+  shot->damage =
+        gtk_shot_damage_new(gdk_get_default_root_window()
+                              , (GtkShotDamageFunc) on_screen_damaged
+                              , shot);
+  shot->live_area.x = shot->live_area.y = 0;
+  shot->live_area.width = shot->live_area.height = 0;
+  shot->windows = gtk_shot_window_tree_new(gdk_get_default_root_window());
+  shot->hover.x = shot->hover.y = 0;
+  shot->hover.width = shot->hover.height = 0;
+  g_signal_connect(shot, "map-event", G_CALLBACK(on_shot_map), NULL);
+  shot->edges = gtk_shot_edges_new();
+  shot->scroll = gtk_shot_scroll_new();
+  shot->scroll_timer = 0;
+  shot->loupe = gtk_shot_loupe_new();
+  shot->doodle = gtk_shot_doodle_new();
+  shot->pens = gtk_shot_pen_index_new();
+  shot->selected = NULL;
+  shot->selected_pos = 0;
+  shot->dragging = FALSE;
+  shot->hud = gtk_shot_hud_new();
+  shot->idle_timeout = GTK_SHOT_IDLE_TIMEOUT;
+  shot->idle_compress = FALSE;
+  shot->idle_source = 0;
+  shot->idle_capture = NULL;
+  shot->idle_capture_size = 0;
+  gtk_shot_load_cursors(shot);
+  // 内存统计
+  gtk_shot_memory_add_probe(GTK_SHOT_MEMORY_CAPTURE
+                              , (GtkShotMemoryProbe) gtk_shot_probe_capture
+                              , shot);
+  gtk_shot_memory_add_probe(GTK_SHOT_MEMORY_OVERLAY
+                              , (GtkShotMemoryProbe) gtk_shot_probe_overlay
+                              , shot);
+  gtk_shot_memory_add_probe(GTK_SHOT_MEMORY_DOODLE
+                              , (GtkShotMemoryProbe) gtk_shot_probe_doodle
+                              , shot);
+  gtk_shot_memory_add_probe(GTK_SHOT_MEMORY_PENS
+                              , (GtkShotMemoryProbe) gtk_shot_probe_pens
+                              , shot);
+  gtk_shot_memory_add_probe(GTK_SHOT_MEMORY_LAYOUTS
+                              , (GtkShotMemoryProbe) gtk_shot_probe_layouts
+                              , shot);
+  gtk_shot_memory_add_probe(GTK_SHOT_MEMORY_ENCODER
+                              , (GtkShotMemoryProbe) gtk_shot_probe_encoder
+                              , shot);
   // events
   gtk_widget_set_events(GTK_WIDGET(shot)
                             , gtk_widget_get_events(GTK_WIDGET(shot))
@@ -181,10 +285,22 @@ GtkShot* gtk_shot_new(/* some arguments */) {
 void gtk_shot_finalize(GObject *obj) {
   GtkShot *shot = GTK_SHOT(obj);
   // 做些清理工作
-  g_object_unref(shot->screen_pixbuf);
+  gtk_shot_memory_remove_probes(shot);
+  if (shot->idle_source) {
+    g_source_remove(shot->idle_source);
+    shot->idle_source = 0;
+  }
+  g_free(shot->idle_capture);
+  shot->idle_capture = NULL;
+  if (shot->screen_pixbuf) g_object_unref(shot->screen_pixbuf);
   shot->screen_pixbuf = NULL;
+  if (shot->mask_cr) cairo_destroy(shot->mask_cr);
+  shot->mask_cr = NULL;
   cairo_surface_destroy(shot->mask_surface);
   shot->mask_surface = NULL;
+  gtk_shot_drop_buffer(shot);
+  if (shot->message_layout) g_object_unref(shot->message_layout);
+  shot->message_layout = NULL;
   gtk_shot_pen_free(shot->pen);
   shot->pen = NULL;
   gtk_shot_clean_historic_pen(shot);
@@ -193,11 +309,45 @@ void gtk_shot_finalize(GObject *obj) {
   shot->toolbar = NULL;
   gtk_shot_input_destroy(shot->input);
   shot->input = NULL;
+  gtk_shot_pool_destroy(shot->pool);
+  shot->pool = NULL;
+  gtk_shot_damage_destroy(shot->damage);
+  shot->damage = NULL;
+  gtk_shot_window_tree_destroy(shot->windows);
+  shot->windows = NULL;
+  gtk_shot_edges_destroy(shot->edges);
+  shot->edges = NULL;
+  if (shot->scroll_timer) {
+    g_source_remove(shot->scroll_timer);
+    shot->scroll_timer = 0;
+  }
+  gtk_shot_scroll_destroy(shot->scroll);
+  shot->scroll = NULL;
+  gtk_shot_loupe_destroy(shot->loupe);
+  shot->loupe = NULL;
+  gtk_shot_doodle_destroy(shot->doodle);
+  shot->doodle = NULL;
+  gtk_shot_pen_index_destroy(shot->pens);
+  shot->pens = NULL;
+  gtk_shot_hud_destroy(shot->hud);
+  shot->hud = NULL;
+  pango_cairo_clear_layout_cache();
+  gint i = 0;
+  for (i = 0; i < GDK_LAST_CURSOR; i++) {
+    if (shot->cursors[i]) gdk_cursor_unref(shot->cursors[i]);
+    shot->cursors[i] = NULL;
+  }
 #ifdef GTK_SHOT_DEBUG
   debug("quit!\n");
 #endif
 }
 
+/** 窗口的cairo上下文和服务端的缓冲依赖于GdkWindow,随之释放 */
+void gtk_shot_unrealize(GtkWidget *widget) {
+  gtk_shot_drop_buffer(GTK_SHOT(widget));
+  GTK_WIDGET_CLASS(gtk_shot_parent_class)->unrealize(widget);
+}
+
 void gtk_shot_destroy(GtkShot *shot) {
   g_return_if_fail(IS_GTK_SHOT(shot));
 
@@ -209,31 +359,196 @@ void gtk_shot_hide(GtkShot *shot) {
   g_return_if_fail(IS_GTK_SHOT(shot));
 
   if (gtk_shot_visible(shot)) {
+    GdkPixbuf *pixbuf = gtk_shot_stop_scroll(shot);
+    if (pixbuf) g_object_unref(pixbuf);
+    gtk_shot_set_dynamic(shot, FALSE);
+    gtk_shot_window_tree_stop(shot->windows);
+    gtk_shot_loupe_hide(shot->loupe);
     gtk_shot_hide_toolbar(shot);
     gtk_shot_input_hide(shot->input);
     gdk_keyboard_ungrab(GDK_CURRENT_TIME);
     gtk_widget_hide_all(GTK_WIDGET(shot));
+    gtk_shot_memory_sample();
+    // 隐藏一段时间后释放截图和遮罩层等
+    if (shot->idle_source) g_source_remove(shot->idle_source);
+    shot->idle_source = 0;
+    if (shot->idle_timeout > 0) {
+      shot->idle_source =
+          g_timeout_add_seconds(shot->idle_timeout
+                                  , (GSourceFunc) on_idle_timeout, shot);
+    }
+  }
+}
+
+/**
+ * 设置隐藏后的内存策略: 隐藏timeout秒后释放缓存(为0时不释放),
+ * compress为TRUE时保留压缩后的截图,以便不重新截屏而再次显示
+ */
+void gtk_shot_set_idle_policy(GtkShot *shot, guint timeout
+                                , gboolean compress) {
+  g_return_if_fail(IS_GTK_SHOT(shot));
+
+  shot->idle_timeout = timeout;
+  shot->idle_compress = compress;
+}
+
+/**
+ * 释放隐藏的截图窗口占用的内存: 遮罩层,历史画笔及其批次,
+ * 边缘索引,缓存池和文本布局缓存,并丢弃(或压缩)截图.
+ * 下次显示时重新截屏及创建遮罩层
+ */
+void gtk_shot_release(GtkShot *shot) {
+  g_return_if_fail(IS_GTK_SHOT(shot));
+
+  if (gtk_shot_visible(shot)) return;
+
+  gsize rss = gtk_shot_memory_get_rss();
+
+  trace_begin("release");
+  if (shot->idle_source) {
+    g_source_remove(shot->idle_source);
+    shot->idle_source = 0;
   }
+  gtk_shot_clean_section(shot);
+  shot->mode = NORMAL_MODE;
+  gtk_shot_edges_clear(shot->edges);
+  g_free(shot->idle_capture);
+  shot->idle_capture = NULL;
+  shot->idle_capture_size = 0;
+  if (shot->screen_pixbuf) {
+    // 截图的压缩率高,以最低的压缩级别换取速度
+    if (shot->idle_compress
+          && !gdk_pixbuf_save_to_buffer(shot->screen_pixbuf
+                                          , &shot->idle_capture
+                                          , &shot->idle_capture_size
+                                          , "png", NULL
+                                          , "compression", "1", NULL)) {
+      shot->idle_capture = NULL;
+      shot->idle_capture_size = 0;
+    }
+    g_object_unref(shot->screen_pixbuf);
+    shot->screen_pixbuf = NULL;
+  }
+  if (shot->mask_cr) cairo_destroy(shot->mask_cr);
+  shot->mask_cr = NULL;
+  cairo_surface_destroy(shot->mask_surface);
+  shot->mask_surface = NULL;
+  gtk_shot_drop_buffer(shot);
+  gtk_shot_pool_clean(shot->pool);
+  pango_cairo_clear_layout_cache();
+#ifdef HAVE_MALLOC_TRIM
+  // 大块内存释放后glibc未必归还给系统
+  malloc_trim(0);
+#endif
+  trace_end("release");
+  gtk_shot_memory_sample();
+  // 释放的效果在内存报告(--memory, --release)中列出
+  gtk_shot_memory_note_release(rss, gtk_shot_memory_get_rss());
+  trace_message("release", "rss %" G_GSIZE_FORMAT
+                            " -> %" G_GSIZE_FORMAT " KiB"
+                    , rss >> 10, gtk_shot_memory_get_rss() >> 10);
 }
 
 void gtk_shot_show(GtkShot *shot, gboolean clean) {
   g_return_if_fail(IS_GTK_SHOT(shot));
 
   if (gtk_shot_visible(shot)) return;
-  if (clean) {
-    shot->screen_pixbuf =
-      gdk_pixbuf_get_from_drawable(shot->screen_pixbuf
-                                    , gdk_get_default_root_window()
-                                    , NULL
-                                    , shot->x, shot->y
-                                    , 0, 0
-                                    , shot->width, shot->height);
+  // 缓存已释放时,恢复压缩的截图
+  if (!clean && !shot->mask_surface) {
+    clean = !gtk_shot_restore_capture(shot);
+  }
+  if (clean || !shot->mask_surface) {
+    gtk_shot_capture_monitor(shot);
+    // 窗口的范围与截图同时获取,此后仅增量更新
+    gtk_shot_window_tree_snapshot(shot->windows);
     gtk_shot_clean_section(shot);
     shot->mode = NORMAL_MODE;
   }
   gtk_widget_show(GTK_WIDGET(shot));
 }
 
+/**
+ * 使用指定的整屏截图(原点为屏幕原点)显示截图窗口,
+ * 如即时回放中的历史画面
+ */
+void gtk_shot_show_pixbuf(GtkShot *shot, GdkPixbuf *pixbuf) {
+  g_return_if_fail(IS_GTK_SHOT(shot) && pixbuf);
+
+  if (gtk_shot_visible(shot)) return;
+
+  GdkRectangle bounds = {.x = 0, .y = 0
+                          , .width = gdk_pixbuf_get_width(pixbuf)
+                          , .height = gdk_pixbuf_get_height(pixbuf)};
+  gtk_shot_edges_clear(shot->edges);
+  gtk_shot_pool_release_pixbuf(shot->pool, shot->screen_pixbuf);
+  shot->screen_pixbuf = g_object_ref(pixbuf);
+  gtk_shot_set_bounds(shot, &bounds);
+  gtk_shot_edges_build(shot->edges, shot->screen_pixbuf
+                          , shot->x, shot->y);
+  gtk_shot_clean_section(shot);
+  shot->mode = NORMAL_MODE;
+
+  gtk_widget_show(GTK_WIDGET(shot));
+}
+
+/**
+ * 截取指定窗口(被遮挡时也无需提升)并显示截图窗口,
+ * 选区为该窗口的范围
+ */
+void gtk_shot_show_window(GtkShot *shot, GdkNativeWindow xid) {
+  g_return_if_fail(IS_GTK_SHOT(shot));
+
+  if (gtk_shot_visible(shot)) return;
+
+  GdkRectangle bounds;
+  trace_begin("capture");
+  gtk_shot_hud_begin_capture(shot->hud);
+  GdkPixbuf *pixbuf =
+        gtk_shot_capture_window(gtk_widget_get_display(GTK_WIDGET(shot))
+                                  , xid, &bounds);
+  gtk_shot_hud_end_capture(shot->hud);
+  trace_end("capture");
+  if (!pixbuf) {
+    gtk_shot_show(shot, TRUE);
+    return;
+  }
+  gtk_shot_edges_clear(shot->edges);
+  gtk_shot_pool_release_pixbuf(shot->pool, shot->screen_pixbuf);
+  shot->screen_pixbuf = pixbuf;
+  gtk_shot_set_bounds(shot, &bounds);
+  gtk_shot_edges_build(shot->edges, shot->screen_pixbuf
+                          , shot->x, shot->y);
+  gtk_shot_clean_section(shot);
+  gtk_shot_select_bounds(shot);
+  shot->mode = NORMAL_MODE;
+
+  gtk_widget_show(GTK_WIDGET(shot));
+  gtk_shot_show_toolbar(shot);
+}
+
+/**
+ * 截屏并选中上次保存的选区,用于重复截取同一区域.
+ * 无保存过的选区时与gtk_shot_show相同
+ */
+void gtk_shot_show_last_section(GtkShot *shot) {
+  g_return_if_fail(IS_GTK_SHOT(shot));
+
+  if (gtk_shot_visible(shot)) return;
+
+  gtk_shot_show(shot, TRUE);
+  if (shot->last_section.width <= 0 || shot->last_section.height <= 0) {
+    return;
+  }
+  shot->section.x = shot->last_section.x;
+  shot->section.y = shot->last_section.y;
+  shot->section.width = shot->last_section.width;
+  shot->section.height = shot->last_section.height;
+  // 选区可能位于其他显示器上
+  gtk_shot_expand_to_section(shot);
+  gtk_shot_refresh(shot);
+  gtk_shot_show_toolbar(shot);
+}
+
 void gtk_shot_quit(GtkShot *shot) {
   g_return_if_fail(IS_GTK_SHOT(shot));
 
@@ -278,6 +593,7 @@ GdkPixbuf* gtk_shot_get_section_pixbuf(GtkShot *shot) {
   debug("screen shot(%d, %d: %d, %d)\n"
                   , x0, y0, x1 - x0, y1 - y0);
 #endif
+  trace_begin("compose");
   GdkDrawable *drawable = NULL;
   if (shot->dynamic) {
     // 获取屏幕上的截图
@@ -294,15 +610,21 @@ GdkPixbuf* gtk_shot_get_section_pixbuf(GtkShot *shot) {
 
     cairo_t *cr = gdk_cairo_create(drawable);
     cairo_set_operator(cr, CAIRO_OPERATOR_OVER);
+    cairo_translate(cr, -shot->x, -shot->y);
     gtk_shot_draw_screen(shot, cr);
     gtk_shot_draw_doodle(shot, cr);
     cairo_destroy(cr);
+    // 画布坐标系相对于窗口
+    x1 -= shot->x; y1 -= shot->y;
+    x0 -= shot->x; y0 -= shot->y;
   }
-  return gdk_pixbuf_get_from_drawable(NULL, drawable
-                                        , NULL
-                                        , x0, y0
-                                        , 0, 0
-                                        , x1 - x0, y1 - y0);
+  GdkPixbuf *pixbuf = gdk_pixbuf_get_from_drawable(NULL, drawable
+                                                    , NULL
+                                                    , x0, y0
+                                                    , 0, 0
+                                                    , x1 - x0, y1 - y0);
+  trace_end("compose");
+  return pixbuf;
 }
 
 void gtk_shot_save_section_to_clipboard(GtkShot *shot) {
@@ -310,6 +632,37 @@ void gtk_shot_save_section_to_clipboard(GtkShot *shot) {
   
   g_return_if_fail(pixbuf);
 
+  save_pixbuf_to_clipboard(pixbuf);
+  g_object_unref(pixbuf);
+  gtk_shot_keep_section(shot);
+}
+
+/**
+ * 不显示截图窗口,直接将鼠标所在显示器的截图保存到剪贴板
+ */
+void gtk_shot_save_screen_to_clipboard(GtkShot *shot) {
+  g_return_if_fail(IS_GTK_SHOT(shot));
+
+  if (gtk_shot_visible(shot)) return;
+
+  GdkScreen *screen = gtk_widget_get_screen(GTK_WIDGET(shot));
+  GdkRectangle bounds;
+  gint x = 0, y = 0;
+
+  gdk_display_get_pointer(gdk_screen_get_display(screen)
+                            , NULL, &x, &y, NULL);
+  gdk_screen_get_monitor_geometry(screen
+                    , gdk_screen_get_monitor_at_point(screen, x, y)
+                    , &bounds);
+  trace_begin("capture");
+  GdkPixbuf *pixbuf =
+    gdk_pixbuf_get_from_drawable(NULL, gdk_get_default_root_window()
+                                  , NULL
+                                  , bounds.x, bounds.y, 0, 0
+                                  , bounds.width, bounds.height);
+  trace_end("capture");
+  if (!pixbuf) return;
+
   save_pixbuf_to_clipboard(pixbuf);
   g_object_unref(pixbuf);
 }
@@ -331,10 +684,14 @@ void gtk_shot_save_section_to_file(GtkShot *shot) {
                                     , &type, NULL);
   if (filename) {
     GError *error = NULL;
+    // 编码和写入文件同时进行,一并追踪
+    trace_begin("save");
     succ = gdk_pixbuf_save(pixbuf, filename, type
                                   , &error, NULL);
+    trace_end("save");
     if (!succ) {
       popup_message_dialog(GTK_WINDOW(shot), error->message);
+      g_error_free(error);
     }
   }
   g_object_unref(pixbuf);
@@ -342,6 +699,7 @@ void gtk_shot_save_section_to_file(GtkShot *shot) {
   g_free(type);
   
   if (succ) {
+    gtk_shot_keep_section(shot);
     gtk_shot_quit(shot);
   } else {
     gtk_shot_show_toolbar(shot);
@@ -393,10 +751,14 @@ void gtk_shot_set_pen(GtkShot *shot, GtkShotPen *pen) {
   shot->pen = pen;
 
   if (pen) {
+    // 涂鸦仅能绘制在静态截图上
+    gtk_shot_set_dynamic(shot, FALSE);
     shot->mode = EDIT_MODE;
     switch(pen->type) {
       case GTK_SHOT_PEN_RECT:
       case GTK_SHOT_PEN_ELLIPSE:
+      case GTK_SHOT_PEN_MOSAIC:
+      case GTK_SHOT_PEN_BLUR:
         shot->edit_cursor = GDK_CROSSHAIR; break;
       case GTK_SHOT_PEN_ARROW:
         shot->edit_cursor = GDK_LEFT_PTR; break;
@@ -417,10 +779,19 @@ void gtk_shot_save_pen(GtkShot *shot) {
   g_return_if_fail(IS_GTK_SHOT(shot));
 
   if (shot->pen) {
-    shot->historic_pen
-        = g_slist_append(shot->historic_pen
-                          , gtk_shot_pen_flat_copy(shot->pen));
+    GtkShotPen *pen = gtk_shot_pen_flat_copy(shot->pen);
+
     gtk_shot_pen_reset(shot->pen);
+    // 提交后画笔不再变化,缓存其路径
+    gtk_shot_pen_compile(pen);
+    if (gtk_shot_pen_is_redaction(pen)) {
+      gtk_shot_pen_snapshot_source(pen);
+    }
+    shot->historic_pen = g_slist_append(shot->historic_pen, pen);
+    gtk_shot_count_pen(shot, pen, TRUE);
+    gtk_shot_pen_index_insert(shot->pens, pen);
+    gtk_shot_doodle_invalidate(shot->doodle);
+    gtk_shot_memory_sample();
   }
 }
 
@@ -429,12 +800,16 @@ void gtk_shot_undo_pen(GtkShot *shot) {
   g_return_if_fail(IS_GTK_SHOT(shot));
 
   gtk_shot_input_hide(shot->input);
+  gtk_shot_unselect_pen(shot);
   if (shot->historic_pen) {
     GSList *l = g_slist_last(shot->historic_pen);
 
+    gtk_shot_pen_index_remove(shot->pens, GTK_SHOT_PEN(l->data));
+    gtk_shot_count_pen(shot, GTK_SHOT_PEN(l->data), FALSE);
     gtk_shot_pen_free(GTK_SHOT_PEN(l->data));
     shot->historic_pen =
             g_slist_delete_link(shot->historic_pen, l);
+    gtk_shot_doodle_invalidate(shot->doodle);
   }
 }
 
@@ -443,6 +818,79 @@ gboolean gtk_shot_has_empty_historic_pen(GtkShot *shot) {
   return IS_GTK_SHOT(shot) && !shot->historic_pen;
 }
 
+/**
+ * 切换动态/静态截图:
+ * 动态截图时,窗口在选区内镂空,直接显示屏幕上的实时内容,
+ * 同时通过XDamage仅将被更新的区域同步到截图中,
+ * 故切换回静态截图时无需重新截取整个屏幕
+ */
+void gtk_shot_set_dynamic(GtkShot *shot, gboolean dynamic) {
+  g_return_if_fail(IS_GTK_SHOT(shot));
+
+  if (shot->dynamic == dynamic) return;
+
+  GdkWindow *window = GTK_WIDGET(shot)->window;
+  shot->dynamic = dynamic;
+  if (dynamic) {
+    gtk_shot_damage_start(shot->damage);
+    shot->live_area.width = shot->live_area.height = 0;
+    gtk_shot_update_live_area(shot);
+  } else {
+    if (!gtk_shot_damage_active(shot->damage)) {
+      // 不支持XDamage时,在冻结前同步选区内的最新内容
+      gtk_shot_fetch_screen(shot, &shot->live_area);
+    }
+    gtk_shot_damage_stop(shot->damage);
+    if (window) {
+      gdk_window_shape_combine_region(window, NULL, 0, 0);
+    }
+    // 截图已冻结,重建边缘索引
+    gtk_shot_edges_build(shot->edges, shot->screen_pixbuf
+                            , shot->x, shot->y);
+  }
+#ifdef GTK_SHOT_DEBUG
+  debug("dynamic: %d, XDamage: %d\n"
+            , dynamic, gtk_shot_damage_active(shot->damage));
+#endif
+}
+
+/**
+ * 开始滚动截图:
+ * 选区切换为动态截图(窗口镂空),用户在选区内滚动内容,
+ * 定时截取选区并拼接到长图中
+ */
+void gtk_shot_start_scroll(GtkShot *shot) {
+  g_return_if_fail(IS_GTK_SHOT(shot));
+
+  if (gtk_shot_scrolling(shot)
+        || !gtk_shot_has_visible_section(shot)) {
+    return;
+  }
+  gtk_shot_hide_toolbar(shot);
+  gtk_shot_set_dynamic(shot, TRUE);
+  gtk_shot_scroll_reset(shot->scroll);
+  // 第一帧在镂空区域重绘后再截取
+  shot->scroll_timer =
+        g_timeout_add(GTK_SHOT_SCROLL_INTERVAL
+                        , (GSourceFunc) on_scroll_timeout, shot);
+}
+
+/**
+ * 结束滚动截图
+ * @return 拼接完成的长图; 未开始滚动截图时返回NULL
+ */
+GdkPixbuf* gtk_shot_stop_scroll(GtkShot *shot) {
+  g_return_val_if_fail(IS_GTK_SHOT(shot), NULL);
+
+  if (!gtk_shot_scrolling(shot)) return NULL;
+
+  g_source_remove(shot->scroll_timer);
+  shot->scroll_timer = 0;
+  gtk_shot_set_dynamic(shot, FALSE);
+
+  return gtk_shot_scroll_finish(shot->scroll);
+}
+
 void gtk_shot_grab_key(GtkShot *shot) {
   g_return_if_fail(IS_GTK_SHOT(shot));
 
@@ -464,27 +912,76 @@ gboolean on_shot_expose(GtkWidget *widget
   GtkShot *shot = GTK_SHOT(widget);
   cairo_t *cr, *mask_cr;
 
-  cr = gdk_cairo_create(gtk_widget_get_window(widget));
+  GdkRectangle hud = shot->hud->rect;
+
+  trace_begin("expose");
+  gtk_shot_hud_begin_frame(shot->hud);
+  // 后备缓冲和遮罩层的cairo上下文均被复用,绘制前后保存/恢复其状态
+  gtk_shot_prepare_buffer(shot);
+  cr = shot->buffer_cr;
+  mask_cr = shot->mask_cr;
+  cairo_save(cr);
+  cairo_save(mask_cr);
   cairo_set_operator(cr, shot->dynamic ?
                             CAIRO_OPERATOR_SOURCE
                             : CAIRO_OPERATOR_OVER);
-
-  mask_cr = cairo_create(shot->mask_surface);
   cairo_set_operator(mask_cr, CAIRO_OPERATOR_SOURCE);
-  // 窗口上绘制截屏图像
-  gtk_shot_draw_screen(shot, cr);
+  // 仅重绘失效的区域(如放大镜移动时)
+  gdk_cairo_region(cr, event->region);
+  cairo_clip(cr);
+  gdk_cairo_region(mask_cr, event->region);
+  cairo_clip(mask_cr);
+  // 选区和涂鸦均使用屏幕坐标,绘制时转换为窗口坐标
+  cairo_translate(cr, -shot->x, -shot->y);
+  cairo_translate(mask_cr, -shot->x, -shot->y);
+  if (shot->dynamic) {
+    gtk_shot_update_live_area(shot);
+  }
+  // 后备缓冲上绘制已上传的截屏图像
+  if (shot->screen_surface) {
+    cairo_set_source_surface(cr, shot->screen_surface
+                                , shot->x, shot->y);
+    cairo_paint(cr);
+  }
   // mask层绘制选区边框和涂鸦
   gtk_shot_draw_section(shot, mask_cr);
   // 绘制信息窗口
   gtk_shot_draw_message(shot, mask_cr);
   // 绘制提示信息
   gtk_shot_draw_tip(shot, mask_cr);
-  // 将mask层合并到窗口上
-  cairo_set_source_surface(cr, shot->mask_surface, 0, 0);
+  // 将mask层合并到后备缓冲上
+  cairo_set_source_surface(cr, shot->mask_surface
+                              , shot->x, shot->y);
   cairo_paint(cr);
+  // 放大镜绘制在遮罩层之上
+  if (!shot->dynamic) {
+    gtk_shot_loupe_draw(shot->loupe, cr, shot->section.color);
+  }
 
-  cairo_destroy(mask_cr);
-  cairo_destroy(cr);
+  cairo_restore(mask_cr);
+  cairo_restore(cr);
+  // 失效区域一次性从后备缓冲复制到窗口上.
+  // 浮层不进入后备缓冲,与失效区域相交时整体重绘,以免残留旧的数值
+  cr = shot->window_cr;
+  cairo_save(cr);
+  gdk_cairo_region(cr, event->region);
+  hud.x -= shot->x;
+  hud.y -= shot->y;
+  if (shot->hud->visible && hud.width > 0 && hud.height > 0
+        && gdk_region_rect_in(event->region, &hud)
+              != GDK_OVERLAP_RECTANGLE_OUT) {
+    cairo_rectangle(cr, hud.x, hud.y, hud.width, hud.height);
+  }
+  cairo_clip(cr);
+  cairo_set_operator(cr, CAIRO_OPERATOR_SOURCE);
+  cairo_set_source_surface(cr, shot->buffer_surface, 0, 0);
+  cairo_paint(cr);
+  // 性能浮层不计入帧耗时
+  gtk_shot_hud_end_frame(shot->hud);
+  cairo_translate(cr, -shot->x, -shot->y);
+  gtk_shot_draw_hud(shot, cr);
+  cairo_restore(cr);
+  trace_end("expose");
   // 捕获按键
   if (shot->grab_key) {
     gtk_shot_grab_key(shot);
@@ -496,21 +993,26 @@ gboolean on_shot_expose(GtkWidget *widget
 gboolean on_shot_button_press(GtkWidget *widget
                                     , GdkEventButton *event) {
   GtkShot *shot = GTK_SHOT(widget);
+  GdkPoint cursor = {.x = event->x_root, .y = event->y_root};
 
   if (event->button != 1) return FALSE;
+  // 滚动截图期间选区不可变化
+  if (gtk_shot_scrolling(shot)) return TRUE;
 
   if (event->type == GDK_2BUTTON_PRESS) {
     if (shot->dblclick) {
       shot->dblclick();
     }
   } else if (event->type == GDK_BUTTON_PRESS) {
-    gdk_point_assign(shot->move_start, *event);
-    gdk_point_assign(shot->move_end, *event);
+    if (gtk_shot_pick_pen(shot, &cursor, event->state)) return TRUE;
+    gdk_point_assign(shot->move_start, cursor);
+    gdk_point_assign(shot->move_end, cursor);
+    gtk_shot_update_hover(shot, cursor.x, cursor.y);
 
     if (shot->mode == NORMAL_MODE) {
       if (shot->cursor_pos == OUTER_OF_SECTION) {
         shot->mode = DRAW_MODE;
-        gdk_point_assign(shot->section, *event);
+        gdk_point_assign(shot->section, cursor);
         shot->section.width = shot->section.height = 0;
         gtk_shot_refresh(shot);
       } else if (shot->cursor_pos == INNER_OF_SECTION) {
@@ -520,7 +1022,7 @@ gboolean on_shot_button_press(GtkWidget *widget
       }
       gtk_shot_hide_toolbar(shot);
     } else if (shot->mode == EDIT_MODE) {
-      gtk_shot_process_edit_mode(shot, event);
+      gtk_shot_process_edit_mode(shot, &cursor);
     }
   }
   return TRUE;
@@ -529,12 +1031,29 @@ gboolean on_shot_button_press(GtkWidget *widget
 gboolean on_shot_button_release(GtkWidget *widget
                                       , GdkEventButton *event) {
   GtkShot *shot = GTK_SHOT(widget);
+  GdkPoint cursor = {.x = event->x_root, .y = event->y_root};
 
   if (event->button != 1 || event->type != GDK_BUTTON_RELEASE) {
     return FALSE;
   }
+  if (shot->dragging) {
+    gtk_shot_drop_pen(shot, &cursor);
+    return TRUE;
+  }
   switch(shot->mode) {
     case DRAW_MODE:
+      // 单击(未拖动)时,选取鼠标下的窗口
+      if ((shot->section.width == 0 || shot->section.height == 0)
+            && shot->hover.width > 0 && shot->hover.height > 0) {
+        gint b = shot->section.border;
+        gtk_shot_adjust_section(shot, shot->hover.x - b
+                                  , shot->hover.y - b
+                                  , shot->hover.x + shot->hover.width + b
+                                  , shot->hover.y + shot->hover.height + b);
+        gtk_shot_expand_to_section(shot);
+        gtk_shot_refresh(shot);
+      }
+      shot->hover.width = shot->hover.height = 0;
     case MOVE_MODE:
     case ZOOM_MODE:
       shot->mode = NORMAL_MODE;
@@ -542,7 +1061,7 @@ gboolean on_shot_button_release(GtkWidget *widget
       break;
     case EDIT_MODE:
       if (shot->pen->type != GTK_SHOT_PEN_TEXT) {
-        gdk_point_assign(shot->pen->end, *event);
+        gdk_point_assign(shot->pen->end, cursor);
         // 将画笔放到历史链表
         gtk_shot_save_pen(shot);
       }
@@ -557,17 +1076,34 @@ gboolean on_shot_motion_notify(GtkWidget *widget
   GtkShot *shot = GTK_SHOT(widget);
   GdkModifierType state;
   GdkPoint cursor;
+#ifdef GTK_SHOT_DEBUG
+  gulong allocs = gtk_shot_alloc_count();
+#endif
 
-  gtk_widget_get_pointer(widget, &cursor.x, &cursor.y);
-  if (event->state & GDK_BUTTON1_MASK) { // 鼠标被按下
+  if (gtk_shot_scrolling(shot)) return TRUE;
+  // 窗口可能随选区扩展而移动,故直接取鼠标的屏幕坐标,
+  // 回放的事件(见journal.c)则使用其记录的坐标
+  if (event->send_event) {
+    cursor.x = event->x_root;
+    cursor.y = event->y_root;
+  } else {
+    gdk_display_get_pointer(gtk_widget_get_display(widget)
+                              , NULL, &cursor.x, &cursor.y, NULL);
+  }
+  if (shot->dragging) { // 拖动已提交的画笔
+    gtk_shot_drag_pen(shot, &cursor);
+  } else if (event->state & GDK_BUTTON1_MASK) { // 鼠标被按下
     switch(shot->mode) {
       case DRAW_MODE:
         if (!gdk_point_is_equal(shot->move_end, cursor)) {
-          gdk_point_assign(shot->move_end, *event);
+          gdk_point_assign(shot->move_end, cursor);
           gtk_shot_adjust_section(shot, shot->move_start.x
                                     , shot->move_start.y
                                     , shot->move_end.x
                                     , shot->move_end.y);
+          if (!(event->state & GDK_SHIFT_MASK)) {
+            gtk_shot_snap_section(shot, cursor.x, cursor.y);
+          }
         }
         break;
       case MOVE_MODE:
@@ -576,22 +1112,52 @@ gboolean on_shot_motion_notify(GtkWidget *widget
         break;
       case ZOOM_MODE:
         gtk_shot_zoom_section(shot, cursor.x, cursor.y);
+        if (!(event->state & GDK_SHIFT_MASK)) {
+          gtk_shot_snap_section(shot, cursor.x, cursor.y);
+        }
         gtk_shot_change_cursor(shot);
         break;
       case EDIT_MODE:
         if (shot->pen->type != GTK_SHOT_PEN_TEXT) {
+#ifdef GTK_SHOT_DEBUG
+          // 画笔的轨迹随拖动增长,不属于每次事件的开销
+          gtk_shot_alloc_exempt(TRUE);
+#endif
           shot->pen->save_track(shot->pen, cursor.x, cursor.y);
+#ifdef GTK_SHOT_DEBUG
+          gtk_shot_alloc_exempt(FALSE);
+#endif
         }
         break;
     }
     if (shot->mode != NORMAL_MODE && shot->mode != SAVE_MODE) {
+      if (shot->mode != EDIT_MODE) {
+#ifdef GTK_SHOT_DEBUG
+        // 选区超出窗口时需重新截图,不计入
+        gtk_shot_alloc_exempt(TRUE);
+#endif
+        gtk_shot_expand_to_section(shot);
+#ifdef GTK_SHOT_DEBUG
+        gtk_shot_alloc_exempt(FALSE);
+#endif
+      }
       gtk_shot_refresh(shot);
     }
   } else {
     shot->cursor_pos =
       gtk_shot_get_cursor_pos(shot, cursor.x, cursor.y);
     gtk_shot_change_cursor(shot);
+    if (gtk_shot_update_hover(shot, cursor.x, cursor.y)) {
+      gtk_shot_refresh(shot);
+    }
   }
+  gtk_shot_update_loupe(shot, &cursor);
+#ifdef GTK_SHOT_DEBUG
+  // 拖动时除扩展窗口和画笔轨迹外,处理过程不应分配内存
+  if (event->state & GDK_BUTTON1_MASK) {
+    g_assert_cmpuint(gtk_shot_alloc_count() - allocs, ==, 0);
+  }
+#endif
   return TRUE;
 }
 
@@ -612,6 +1178,19 @@ gboolean on_shot_key_press(GtkWidget *widget
     return TRUE;
   }
 
+  if (event->keyval == GDK_F12) { // 性能浮层
+    gtk_shot_hud_toggle(shot->hud);
+    gtk_shot_refresh(shot);
+    return TRUE;
+  }
+
+  if (shot->selected && !shot->dragging
+        && (event->keyval == GDK_Delete
+              || event->keyval == GDK_KP_Delete)) {
+    gtk_shot_delete_selected_pen(shot);
+    return TRUE;
+  }
+
   gint dx = 0, dy = 0;
   switch (event->keyval) {
     case GDK_KP_Up:
@@ -622,12 +1201,13 @@ gboolean on_shot_key_press(GtkWidget *widget
     case GDK_Left: dx -= 2;
     case GDK_KP_Right:
     case GDK_Right: dx += 1;
-      if (shot->mode == EDIT_MODE) break;
+      if (shot->mode == EDIT_MODE || gtk_shot_scrolling(shot)) break;
       if (!is_ctrl) { // move
         gtk_shot_move_section(shot, dx, dy);
       } else { // resize
         gtk_shot_resize_section(shot, dx, dy);
       }
+      gtk_shot_expand_to_section(shot);
       gtk_shot_refresh(shot);
       gtk_shot_show_toolbar(shot);
       break;
@@ -642,16 +1222,35 @@ gboolean on_shot_key_press(GtkWidget *widget
         gtk_shot_hide(shot);
         break;
       case GDK_a: // select whole
-        if (shot->mode == EDIT_MODE) break;
+        if (shot->mode == EDIT_MODE || gtk_shot_scrolling(shot)) break;
         gtk_shot_whole_section(shot);
         gtk_shot_refresh(shot);
         gtk_shot_show_toolbar(shot);
         break;
       case GDK_d: // dynamic
+        if (shot->mode == EDIT_MODE || shot->mode == SAVE_MODE
+              || gtk_shot_scrolling(shot)) {
+          break;
+        }
+        gtk_shot_set_dynamic(shot, !shot->dynamic);
+        gtk_shot_refresh(shot);
         break;
       case GDK_r: // record
         gtk_shot_record(shot);
         break;
+      case GDK_l: // long (scrolling capture)
+        if (gtk_shot_scrolling(shot)) {
+          GdkPixbuf *pixbuf = gtk_shot_stop_scroll(shot);
+          if (pixbuf) {
+            save_pixbuf_to_clipboard(pixbuf);
+            g_object_unref(pixbuf);
+          }
+          gtk_shot_hide(shot);
+        } else if (shot->mode != EDIT_MODE && shot->mode != SAVE_MODE) {
+          gtk_shot_start_scroll(shot);
+          gtk_shot_refresh(shot);
+        }
+        break;
       case GDK_z: // undo
         if (!gtk_shot_has_empty_historic_pen(shot)) {
           gtk_shot_undo_pen(shot);
@@ -673,23 +1272,87 @@ gboolean on_shot_key_release(GtkWidget *widget
   return FALSE;
 }
 
+/** 统计每帧之间的输入事件,不拦截事件 */
+gboolean on_shot_event(GtkWidget *widget, GdkEvent *event) {
+  GtkShot *shot = GTK_SHOT(widget);
+
+  switch (event->type) {
+    case GDK_MOTION_NOTIFY:
+    case GDK_BUTTON_PRESS:
+    case GDK_2BUTTON_PRESS:
+    case GDK_BUTTON_RELEASE:
+    case GDK_KEY_PRESS:
+    case GDK_KEY_RELEASE:
+      gtk_shot_hud_count_event(shot->hud);
+      break;
+    default:
+      break;
+  }
+  return FALSE;
+}
+
+/** 窗口管理器完成边框的创建后,才能确定截图窗口的顶层窗口 */
+gboolean on_shot_map(GtkWidget *widget, GdkEvent *event) {
+  GtkShot *shot = GTK_SHOT(widget);
+  GdkNativeWindow xid =
+      gtk_shot_capture_get_toplevel(gtk_widget_get_display(widget)
+                                      , GDK_WINDOW_XID(widget->window));
+
+  gtk_shot_window_tree_set_ignore(shot->windows, xid);
+  return FALSE;
+}
+
+gboolean on_scroll_timeout(GtkShot *shot) {
+  GdkPixbuf *pixbuf = gtk_shot_get_section_pixbuf(shot);
+  gboolean lost = shot->scroll->lost;
+
+  if (!pixbuf) return TRUE;
+  if (gtk_shot_scroll_append(shot->scroll, pixbuf) != 0
+        || lost != shot->scroll->lost) {
+    gtk_shot_memory_sample();
+    gtk_shot_refresh(shot);
+  }
+  g_object_unref(pixbuf);
+
+  return TRUE;
+}
+
+gboolean on_idle_timeout(GtkShot *shot) {
+  shot->idle_source = 0;
+  gtk_shot_release(shot);
+
+  return FALSE;
+}
+
+void on_screen_damaged(GdkRectangle *rect, GtkShot *shot) {
+  GdkRectangle area;
+  // 仅同步镂空的区域,其余区域被窗口覆盖,截取到的将是窗口自身
+  if (gdk_rectangle_intersect(rect, &shot->live_area, &area)) {
+    gtk_shot_fetch_screen(shot, &area);
+  }
+}
+
 void gtk_shot_process_edit_mode(GtkShot *shot
-                                    , GdkEventButton *event) {
+                                    , GdkPoint *cursor) {
   if (shot->pen->type != GTK_SHOT_PEN_TEXT) {
     shot->pen->square = FALSE;
-    gdk_point_assign(shot->pen->start, *event);
-    gdk_point_assign(shot->pen->end, *event);
+    gdk_point_assign(shot->pen->start, *cursor);
+    gdk_point_assign(shot->pen->end, *cursor);
+    if (gtk_shot_pen_is_redaction(shot->pen)) {
+      gtk_shot_pen_set_source(shot->pen, shot->screen_pixbuf
+                                , shot->x, shot->y);
+    }
   } else {
     gint x0, y0, x1, y1;
     gtk_shot_get_section(shot, &x0, &y0, &x1, &y1);
-    if (!IS_IN_RECT(event->x, event->y, x0, y0, x1, y1)) {
+    if (!IS_IN_RECT(cursor->x, cursor->y, x0, y0, x1, y1)) {
       gtk_shot_input_hide(shot->input);
       gtk_shot_grab_key(shot);
     } else {
       // 完成输入,并保存当前画笔
       char *text = gtk_shot_input_get_text(shot->input);
       if (text != NULL && strlen(text) > 0) {
-        shot->pen->text.content = text;
+        gtk_shot_pen_set_text(shot->pen, text);
         gtk_shot_save_pen(shot);
         gtk_shot_input_hide(shot->input);
         gtk_shot_refresh(shot);
@@ -698,10 +1361,10 @@ void gtk_shot_process_edit_mode(GtkShot *shot
         gtk_shot_input_set_font(shot->input
                                   , shot->pen->text.fontname
                                   , shot->pen->color);
-        gdk_point_assign(shot->pen->start, *event);
-        gdk_point_assign(shot->pen->end, *event);
+        gdk_point_assign(shot->pen->start, *cursor);
+        gdk_point_assign(shot->pen->end, *cursor);
         gtk_shot_ungrab_key(shot);
-        gtk_shot_input_show_at(shot->input, event->x, event->y);
+        gtk_shot_input_show_at(shot->input, cursor->x, cursor->y);
       }
     }
   }
@@ -710,7 +1373,7 @@ void gtk_shot_process_edit_mode(GtkShot *shot
 void gtk_shot_draw_screen(GtkShot *shot, cairo_t *cr) {
   if (shot->screen_pixbuf) {
     gdk_cairo_set_source_pixbuf(cr, shot->screen_pixbuf
-                                  , 0, 0);
+                                  , shot->x, shot->y);
     cairo_paint(cr);
   }
 }
@@ -730,27 +1393,44 @@ void gtk_shot_draw_section(GtkShot *shot, cairo_t *cr) {
     // draw mask around section
     gtk_shot_draw_mask(shot, cr);
     // draw section border
-    cairo_set_line_width(cr, shot->section.border);
-    SET_CAIRO_RGB(cr, shot->section.color);
-    cairo_rectangle(cr, shot->section.x
-                      , shot->section.y
-                      , shot->section.width
-                      , shot->section.height);
-    cairo_stroke(cr);
+    GdkRectangle rect = {.x = shot->section.x, .y = shot->section.y
+                          , .width = shot->section.width
+                          , .height = shot->section.height};
+    gtk_shot_overlay_draw_border(cr, &rect, shot->section.border
+                                    , shot->section.color);
     // draw zoom anchor
     gtk_shot_draw_anchor(shot, cr);
   } else {
     // 选区高宽为0时,所画MASK必然覆盖整个画布
-    gtk_shot_draw_mask(shot, cr);
+    if (shot->hover.width > 0 && shot->hover.height > 0) {
+      gtk_shot_draw_hover(shot, cr);
+    } else {
+      gtk_shot_draw_mask(shot, cr);
+    }
   }
 }
 
+/** 历史画笔按样式批量绘制,当前画笔仍在变化,单独绘制 */
 void gtk_shot_draw_doodle(GtkShot *shot, cairo_t *cr) {
-  GSList *l = shot->historic_pen;
   GtkShotPen *pen;
-  for (l; l; l = l->next) {
-    pen = GTK_SHOT_PEN(l->data);
-    pen->draw_track(pen, cr);
+
+  gtk_shot_doodle_draw(shot->doodle, shot->historic_pen, cr);
+  pen = shot->selected;
+  if (pen) {
+    gdouble dash = GTK_SHOT_SELECTED_PEN_DASH;
+    gint b = GTK_SHOT_SELECTED_PEN_BORDER;
+
+    if (shot->dragging) pen->draw_track(pen, cr);
+    // 选中框
+    cairo_save(cr);
+    cairo_set_dash(cr, &dash, 1, 0);
+    cairo_set_line_width(cr, 1);
+    SET_CAIRO_RGB(cr, shot->section.color);
+    cairo_rectangle(cr, pen->bounds.x - b + 0.5, pen->bounds.y - b + 0.5
+                      , pen->bounds.width + 2 * b - 1
+                      , pen->bounds.height + 2 * b - 1);
+    cairo_stroke(cr);
+    cairo_restore(cr);
   }
   pen = shot->pen;
   if (pen) {
@@ -762,32 +1442,20 @@ void gtk_shot_draw_mask(GtkShot *shot, cairo_t *cr) {
   gint x0, y0, x1, y1;
   gtk_shot_get_section(shot, &x0, &y0, &x1, &y1);
 
-  SET_CAIRO_RGBA(cr, shot->color, 1 - shot->opacity);
-  cairo_rectangle(cr, shot->x, shot->y
-                    , shot->width, y0 - shot->y);
-  cairo_rectangle(cr, shot->x, y1
-                    , shot->width, shot->height + shot->y - y1);
-  cairo_rectangle(cr, shot->x, y0
-                    , x0 - shot->x, y1 - y0);
-  cairo_rectangle(cr, x1, y0
-                    , shot->width + shot->x - x1, y1 - y0);
-  cairo_fill(cr);
+  GdkRectangle screen = {.x = shot->x, .y = shot->y
+                          , .width = shot->width, .height = shot->height};
+  GdkRectangle hole = {.x = x0, .y = y0
+                        , .width = x1 - x0, .height = y1 - y0};
+  gtk_shot_overlay_draw_mask(cr, &screen, &hole
+                                , shot->color, 1 - shot->opacity);
 }
 
 void gtk_shot_draw_anchor(GtkShot *shot, cairo_t *cr) {
   GdkPoint anchor[8] = {{.x = 0, .y = 0}};
 
   gtk_shot_get_zoom_anchor(shot, anchor);
-  SET_CAIRO_RGB(cr, shot->section.color);
-
-  gint i = 0;
-  gfloat b = shot->anchor_border / 2.0;
-  for (i = 0; i < 8; i++) {
-    cairo_arc(cr, anchor[i].x + b
-                , anchor[i].y + b
-                , b, 0, 2 * M_PI);
-    cairo_fill(cr);
-  }
+  gtk_shot_overlay_draw_anchors(cr, anchor, shot->anchor_border
+                                  , shot->section.color);
 }
 
 void gtk_shot_draw_message(GtkShot *shot, cairo_t *cr) {
@@ -799,44 +1467,42 @@ void gtk_shot_draw_message(GtkShot *shot, cairo_t *cr) {
   gint x0, y0, x1, y1;
   gtk_shot_get_section(shot, &x0, &y0, &x1, &y1);
 
-  gchar *msg = g_strdup_printf("x:%4d, y:%4d\nw:%4d, h:%4d"
-                                    , x0, y0
-                                    , MAX(x1 - x0, 0)
-                                    , MAX(y1 - y0, 0));
-  PangoLayout *layout =
-    pango_cairo_prepare_layout(cr, msg, "");
-
-  gint width = 0, height = 0;
-  pango_layout_get_pixel_size(layout, &width, &height);
-
-  gint radius = 8, padding = radius / 2;
-  gint b = MAX(shot->section.border, shot->anchor_border);
-  gint x = x0 + shot->section.border + padding;
-  gint y = y0 - b - height - padding;
-
-  if (x1 >= shot->x + shot->width && x + width > x1) {
-    x = x1 - width - b - padding; // 保持在屏幕内
-  }
-  if (y < shot->y) {
-    if (shot->mode == EDIT_MODE || shot->mode == SAVE_MODE) {
-      return;
+  gchar *msg = shot->message;
+  if (gtk_shot_scrolling(shot)) {
+    if (shot->scroll->lost) {
+      g_strlcpy(msg, _("scrolled too fast\nplease scroll back")
+                  , GTK_SHOT_MESSAGE_SIZE);
+    } else {
+      g_snprintf(msg, GTK_SHOT_MESSAGE_SIZE
+                  , _("scrolling: %d rows\nctrl+l to finish")
+                  , shot->scroll->rows);
     }
-    y = y0 + shot->section.border + padding * 2;
+  } else {
+    g_snprintf(msg, GTK_SHOT_MESSAGE_SIZE, "x:%4d, y:%4d\nw:%4d, h:%4d"
+                  , x0, y0
+                  , MAX(x1 - x0, 0)
+                  , MAX(y1 - y0, 0));
   }
-
-  SET_CAIRO_RGBA(cr, 0x232126, shot->opacity / 2.0);
-  cairo_round_rect(cr, x - padding * 2
-                      , y - padding
-                      , width + padding * 4
-                      , height + padding * 2
-                      , radius);
-  cairo_fill(cr);
-
-  SET_CAIRO_RGB(cr, 0xFFFFFF);
-  cairo_move_to(cr, x, y);
-  pango_cairo_show_layout(cr, layout);
-
-  g_free(msg);
+  // 布局随窗口保留,仅文本变化时重新排版
+  if (!shot->message_layout) {
+    shot->message_layout = pango_cairo_create_layout(cr);
+  } else {
+    pango_cairo_update_layout(cr, shot->message_layout);
+  }
+  if (strcmp(pango_layout_get_text(shot->message_layout), msg) != 0) {
+    pango_layout_set_text(shot->message_layout, msg, -1);
+  }
+  GdkRectangle screen = {.x = shot->x, .y = shot->y
+                          , .width = shot->width, .height = shot->height};
+  GdkRectangle section = {.x = x0, .y = y0
+                           , .width = x1 - x0, .height = y1 - y0};
+  // 编辑/保存时信息窗口不覆盖选区内容
+  gtk_shot_overlay_draw_message(cr, shot->message_layout
+                      , &screen, &section
+                      , shot->section.border
+                      , MAX(shot->section.border, shot->anchor_border)
+                      , shot->opacity / 2.0
+                      , shot->mode != EDIT_MODE && shot->mode != SAVE_MODE);
 }
 
 void gtk_shot_draw_tip(GtkShot *shot, cairo_t *cr) {
@@ -859,24 +1525,277 @@ void gtk_shot_draw_tip(GtkShot *shot, cairo_t *cr) {
                         , padding, padding * 2);
 }
 
+/** 高亮无选区时鼠标下的窗口(MASK仅覆盖窗口以外的区域),单击即可选取该窗口 */
+void gtk_shot_draw_hover(GtkShot *shot, cairo_t *cr) {
+  GdkRectangle screen = {.x = shot->x, .y = shot->y
+                          , .width = shot->width, .height = shot->height};
+
+  gtk_shot_overlay_draw_mask(cr, &screen, &shot->hover
+                                , shot->color, 1 - shot->opacity);
+  gtk_shot_overlay_draw_border(cr, &shot->hover, shot->section.border
+                                  , shot->section.color);
+}
+
+/** 性能浮层: 附加画笔和内存信息,绘制在窗口左下角 */
+void gtk_shot_draw_hud(GtkShot *shot, cairo_t *cr) {
+  if (!shot->hud->visible) return;
+
+  gchar extra[GTK_SHOT_MESSAGE_SIZE * 2];
+  gsize screen = 0, mask = 0, pens = shot->historic_memory;
+  guint count = shot->historic_count;
+
+  if (shot->screen_pixbuf) {
+    screen = (gsize) gdk_pixbuf_get_rowstride(shot->screen_pixbuf)
+                * gdk_pixbuf_get_height(shot->screen_pixbuf);
+  }
+  if (shot->mask_surface) {
+    mask = (gsize) cairo_image_surface_get_stride(shot->mask_surface)
+              * cairo_image_surface_get_height(shot->mask_surface);
+  }
+  // 拖动中的画笔暂时移出了历史画笔
+  if (shot->dragging && shot->selected) {
+    pens += gtk_shot_pen_get_memory(shot->selected);
+    count++;
+  }
+  if (shot->pen) pens += gtk_shot_pen_get_memory(shot->pen);
+
+  g_snprintf(extra, sizeof(extra)
+              , "pens:    %7u (rebuilds %u)\n"
+                "screen:  %7.1f MiB\n"
+                "mask:    %7.1f MiB\n"
+                "annot:   %7.1f KiB"
+              , count, shot->doodle->rebuilds
+              , screen / 1048576.0, mask / 1048576.0, pens / 1024.0);
+  gtk_shot_hud_draw(shot->hud, cr
+                      , shot->x + GTK_SHOT_HUD_MARGIN
+                      , shot->y + shot->height - GTK_SHOT_HUD_MARGIN
+                      , extra);
+}
+
+/**
+ * 更新鼠标下的窗口,仅在无选区时有效
+ * @return 窗口发生变化时返回TRUE
+ */
+gboolean gtk_shot_update_hover(GtkShot *shot, gint x, gint y) {
+  GdkRectangle rect = {.x = 0, .y = 0, .width = 0, .height = 0};
+
+  if (shot->mode == NORMAL_MODE
+        && shot->section.width == 0 && shot->section.height == 0) {
+    gtk_shot_window_tree_lookup(shot->windows, x, y, &rect);
+  }
+  if (rect.x == shot->hover.x && rect.y == shot->hover.y
+        && rect.width == shot->hover.width
+        && rect.height == shot->hover.height) {
+    return FALSE;
+  }
+  shot->hover = rect;
+  return TRUE;
+}
+
+/**
+ * 选取选区时在鼠标旁显示放大镜,
+ * 仅重绘放大镜的新旧位置
+ */
+void gtk_shot_update_loupe(GtkShot *shot, GdkPoint *cursor) {
+  GdkRectangle bounds = {.x = shot->x, .y = shot->y
+                          , .width = shot->width
+                          , .height = shot->height};
+  GdkRectangle old = shot->loupe->rect, rect;
+  gboolean visible = shot->loupe->visible;
+
+  if (!shot->dynamic && shot->screen_pixbuf
+        && (shot->mode == NORMAL_MODE
+              || shot->mode == DRAW_MODE
+              || shot->mode == ZOOM_MODE)) {
+    gtk_shot_loupe_update(shot->loupe, shot->screen_pixbuf
+                            , shot->x, shot->y
+                            , cursor->x, cursor->y
+                            , &bounds);
+  } else if (visible) {
+    gtk_shot_loupe_hide(shot->loupe);
+  } else {
+    return;
+  }
+  if (visible) {
+    old.x -= shot->x; old.y -= shot->y;
+    gtk_shot_invalidate(shot, &old);
+  }
+  if (shot->loupe->visible) {
+    rect = shot->loupe->rect;
+    rect.x -= shot->x; rect.y -= shot->y;
+    gtk_shot_invalidate(shot, &rect);
+  }
+}
+
 void gtk_shot_clean_section(GtkShot *shot) {
   gdk_point_assign(shot->move_start, shot->move_end);
   shot->section.width = shot->section.height = 0;
+  shot->hover.width = shot->hover.height = 0;
 
   gtk_shot_remove_pen(shot);
   gtk_shot_clean_historic_pen(shot);
 }
 
+/** 记录保存过的选区,以便重复截取 */
+void gtk_shot_keep_section(GtkShot *shot) {
+  shot->last_section.x = shot->section.x;
+  shot->last_section.y = shot->section.y;
+  shot->last_section.width = shot->section.width;
+  shot->last_section.height = shot->section.height;
+}
+
 void gtk_shot_clean_historic_pen(GtkShot *shot) {
-  GSList *l = shot->historic_pen;
-  for (l; l; l = l->next) {
+  GSList *l;
+
+  gtk_shot_unselect_pen(shot);
+  for (l = shot->historic_pen; l; l = l->next) {
     gtk_shot_pen_free(GTK_SHOT_PEN(l->data));
   }
   g_slist_free(shot->historic_pen);
   shot->historic_pen = NULL;
+  shot->historic_count = 0;
+  shot->historic_memory = 0;
+  if (shot->pens) gtk_shot_pen_index_clear(shot->pens);
+  if (shot->doodle) gtk_shot_doodle_invalidate(shot->doodle);
+}
+
+/**
+ * 累计历史画笔的数量和内存,以免每帧遍历历史画笔.
+ * 画笔在历史画笔中时不再变化,拖动期间的变化在放回时计入
+ */
+void gtk_shot_count_pen(GtkShot *shot, GtkShotPen *pen, gboolean add) {
+  gsize size = gtk_shot_pen_get_memory(pen);
+
+  if (add) {
+    shot->historic_count++;
+    shot->historic_memory += size;
+  } else {
+    shot->historic_count--;
+    shot->historic_memory -= MIN(size, shot->historic_memory);
+  }
+}
+
+/**
+ * 拾取并开始拖动鼠标下已提交的画笔:
+ * 无画笔工具时直接点击,使用画笔工具时需按住Shift.
+ * 拖动期间画笔脱离历史画笔单独绘制,松开后放回原层叠位置
+ */
+gboolean gtk_shot_pick_pen(GtkShot *shot, GdkPoint *cursor
+                              , GdkModifierType state) {
+  GtkShotPen *pen = NULL;
+
+  if (shot->mode == SAVE_MODE
+        || (shot->mode == EDIT_MODE && (state & GDK_SHIFT_MASK))) {
+    pen = gtk_shot_pen_index_pick(shot->pens, cursor->x, cursor->y);
+  }
+  if (pen != shot->selected) {
+    gtk_shot_unselect_pen(shot);
+  }
+  if (!pen) return FALSE;
+
+  shot->selected = pen;
+  shot->selected_pos = g_slist_index(shot->historic_pen, pen);
+  shot->historic_pen = g_slist_remove(shot->historic_pen, pen);
+  gtk_shot_count_pen(shot, pen, FALSE);
+  shot->dragging = TRUE;
+  // 打码画笔拖动期间由当前截图重新生成,放下时再截取副本
+  if (gtk_shot_pen_is_redaction(pen)) {
+    gtk_shot_pen_set_source(pen, shot->screen_pixbuf, shot->x, shot->y);
+  }
+  gdk_point_assign(shot->move_start, *cursor);
+  gdk_point_assign(shot->move_end, *cursor);
+  gtk_shot_doodle_invalidate(shot->doodle);
+  gtk_shot_invalidate_pen(shot, pen);
+
+  return TRUE;
+}
+
+/** 拖动时仅重绘画笔移动前后的范围 */
+void gtk_shot_drag_pen(GtkShot *shot, GdkPoint *cursor) {
+  GtkShotPen *pen = shot->selected;
+
+  if (gdk_point_is_equal(shot->move_end, *cursor)) return;
+  gtk_shot_invalidate_pen(shot, pen);
+  gtk_shot_pen_translate(pen, cursor->x - shot->move_end.x
+                            , cursor->y - shot->move_end.y);
+  gdk_point_assign(shot->move_end, *cursor);
+  gtk_shot_invalidate_pen(shot, pen);
+}
+
+/**
+ * 结束拖动,将画笔放回历史画笔中并更新索引.
+ * 未移动(单击)且有画笔工具时,将当前画笔的样式应用到该画笔
+ */
+void gtk_shot_drop_pen(GtkShot *shot, GdkPoint *cursor) {
+  GtkShotPen *pen = shot->selected;
+
+  if (!shot->dragging) return;
+  if (cursor) gtk_shot_drag_pen(shot, cursor);
+  if (shot->pen && gdk_point_is_equal(shot->move_start, shot->move_end)) {
+    gtk_shot_invalidate_pen(shot, pen);
+    gtk_shot_pen_restyle(pen, shot->pen);
+    gtk_shot_invalidate_pen(shot, pen);
+  }
+  if (gtk_shot_pen_is_redaction(pen)) {
+    gtk_shot_pen_snapshot_source(pen);
+  }
+  shot->historic_pen = g_slist_insert(shot->historic_pen, pen
+                                        , shot->selected_pos);
+  gtk_shot_count_pen(shot, pen, TRUE);
+  shot->dragging = FALSE;
+  gtk_shot_pen_index_update(shot->pens, pen);
+  gtk_shot_doodle_invalidate(shot->doodle);
+}
+
+void gtk_shot_unselect_pen(GtkShot *shot) {
+  if (!shot->selected) return;
+
+  gtk_shot_drop_pen(shot, NULL);
+  if (GTK_WIDGET(shot)->window) {
+    gtk_shot_invalidate_pen(shot, shot->selected);
+  }
+  shot->selected = NULL;
+}
+
+void gtk_shot_delete_selected_pen(GtkShot *shot) {
+  GtkShotPen *pen = shot->selected;
+
+  if (!pen) return;
+  gtk_shot_unselect_pen(shot);
+  gtk_shot_pen_index_remove(shot->pens, pen);
+  shot->historic_pen = g_slist_remove(shot->historic_pen, pen);
+  gtk_shot_count_pen(shot, pen, FALSE);
+  gtk_shot_pen_free(pen);
+  gtk_shot_doodle_invalidate(shot->doodle);
+}
+
+/** 使画笔(含选中框)所在的窗口区域失效 */
+void gtk_shot_invalidate_pen(GtkShot *shot, GtkShotPen *pen) {
+  gint border = GTK_SHOT_SELECTED_PEN_BORDER + 1;
+  GdkRectangle rect = {.x = pen->bounds.x - shot->x - border
+                        , .y = pen->bounds.y - shot->y - border
+                        , .width = pen->bounds.width + 2 * border
+                        , .height = pen->bounds.height + 2 * border};
+
+  if (pen->bounds.width <= 0 || pen->bounds.height <= 0) {
+    gtk_shot_refresh(shot);
+  } else {
+    gtk_shot_invalidate(shot, &rect);
+  }
 }
 
 void gtk_shot_whole_section(GtkShot *shot) {
+  GdkScreen *screen = gtk_widget_get_screen(GTK_WIDGET(shot));
+  GdkRectangle area = {.x = 0, .y = 0
+                        , .width = gdk_screen_get_width(screen)
+                        , .height = gdk_screen_get_height(screen)};
+  // 全选时需截取所有显示器
+  gtk_shot_expand(shot, &area);
+  gtk_shot_select_bounds(shot);
+}
+
+/** 选取窗口的整个范围 */
+void gtk_shot_select_bounds(GtkShot *shot) {
   shot->section.x = shot->x - shot->section.border;
   shot->section.y = shot->y - shot->section.border;
   shot->section.width = shot->width + 2 * shot->section.border;
@@ -943,6 +1862,34 @@ void gtk_shot_zoom_section(GtkShot *shot, gint x, gint y) {
   gtk_shot_adjust_section(shot, x0, y0, x1, y1);
 }
 
+/**
+ * 将被拖动的选区边(与鼠标位置重合的边)吸附到附近的边缘上,
+ * 使边缘恰好成为选区内容的边界
+ */
+void gtk_shot_snap_section(GtkShot *shot, gint x, gint y) {
+  gint border = shot->section.border;
+  gint b = border / 2 + border % 2;
+  gint x0 = shot->section.x, y0 = shot->section.y;
+  gint x1 = x0 + shot->section.width, y1 = y0 + shot->section.height;
+  gint edge = 0;
+
+  if (x == x0 && gtk_shot_edges_snap_x(shot->edges, x0 + b
+                                          , y0, y1, &edge)) {
+    x0 = edge - b;
+  } else if (x == x1 && gtk_shot_edges_snap_x(shot->edges, x1 - border
+                                                , y0, y1, &edge)) {
+    x1 = edge + border;
+  }
+  if (y == y0 && gtk_shot_edges_snap_y(shot->edges, y0 + b
+                                          , x0, x1, &edge)) {
+    y0 = edge - b;
+  } else if (y == y1 && gtk_shot_edges_snap_y(shot->edges, y1 - border
+                                                , x0, x1, &edge)) {
+    y1 = edge + border;
+  }
+  gtk_shot_adjust_section(shot, x0, y0, x1, y1);
+}
+
 void gtk_shot_adjust_section(GtkShot *shot, gint x0, gint y0
                                           , gint x1, gint y1) {
   shot->section.x = MIN(x0, x1);
@@ -1058,6 +2005,417 @@ void gtk_shot_change_cursor(GtkShot *shot) {
       cursor = GDK_LEFT_PTR;
     }
   }
+  if (cursor == shot->cursor) return;
+  if (!shot->cursors[cursor]) {
+    shot->cursors[cursor] = gdk_cursor_new(cursor);
+  }
+  shot->cursor = cursor;
   gdk_window_set_cursor(GTK_WIDGET(shot)->window
-                          , gdk_cursor_new(cursor));
+                          , shot->cursors[cursor]);
+}
+
+/** 预先创建所有用到的鼠标样式,移动鼠标时不再创建 */
+void gtk_shot_load_cursors(GtkShot *shot) {
+  GdkCursorType edit_cursors[] = {GDK_CROSSHAIR, GDK_LEFT_PTR
+                                    , GDK_PENCIL, GDK_XTERM};
+  gint i = 0;
+
+  memset(shot->cursors, 0, sizeof(shot->cursors));
+  shot->cursor = GDK_LAST_CURSOR;
+  for (i = 0; i < G_N_ELEMENTS(cursor_pos_type); i++) {
+    if (!shot->cursors[cursor_pos_type[i]]) {
+      shot->cursors[cursor_pos_type[i]] =
+                      gdk_cursor_new(cursor_pos_type[i]);
+    }
+  }
+  for (i = 0; i < G_N_ELEMENTS(edit_cursors); i++) {
+    if (!shot->cursors[edit_cursors[i]]) {
+      shot->cursors[edit_cursors[i]] = gdk_cursor_new(edit_cursors[i]);
+    }
+  }
+}
+
+/**
+ * 仅截取鼠标所在显示器的图像,并将窗口限定在该显示器上,
+ * 其他显示器在选区跨入时才截取(见gtk_shot_expand)
+ */
+void gtk_shot_capture_monitor(GtkShot *shot) {
+  GdkScreen *screen = gtk_widget_get_screen(GTK_WIDGET(shot));
+  GdkRectangle bounds;
+  gint x = 0, y = 0;
+
+  trace_begin("capture");
+  gtk_shot_hud_begin_capture(shot->hud);
+  gdk_display_get_pointer(gdk_screen_get_display(screen)
+                            , NULL, &x, &y, NULL);
+  gdk_screen_get_monitor_geometry(screen
+                    , gdk_screen_get_monitor_at_point(screen, x, y)
+                    , &bounds);
+  gtk_shot_edges_clear(shot->edges);
+  // 尺寸相同时复用原截图的空间,否则从缓存池中换取
+  if (!shot->screen_pixbuf
+        || gdk_pixbuf_get_width(shot->screen_pixbuf) != bounds.width
+        || gdk_pixbuf_get_height(shot->screen_pixbuf) != bounds.height) {
+    gtk_shot_pool_release_pixbuf(shot->pool, shot->screen_pixbuf);
+    shot->screen_pixbuf =
+        gtk_shot_pool_acquire_pixbuf(shot->pool
+                                        , bounds.width, bounds.height);
+  }
+  shot->screen_pixbuf =
+    gdk_pixbuf_get_from_drawable(shot->screen_pixbuf
+                                  , gdk_get_default_root_window()
+                                  , NULL
+                                  , bounds.x, bounds.y
+                                  , 0, 0
+                                  , bounds.width, bounds.height);
+  gtk_shot_hud_end_capture(shot->hud);
+  trace_end("capture");
+  gtk_shot_set_bounds(shot, &bounds);
+  gtk_shot_edges_build(shot->edges, shot->screen_pixbuf
+                          , shot->x, shot->y);
+}
+
+/**
+ * 恢复释放缓存时压缩的截图,窗口范围不变
+ * @return 无压缩的截图或解码失败时返回FALSE
+ */
+gboolean gtk_shot_restore_capture(GtkShot *shot) {
+  if (!shot->idle_capture) return FALSE;
+
+  GdkPixbufLoader *loader = gdk_pixbuf_loader_new_with_type("png", NULL);
+  GdkPixbuf *pixbuf = NULL;
+  gboolean succ = gdk_pixbuf_loader_write(loader
+                                    , (const guchar*) shot->idle_capture
+                                    , shot->idle_capture_size, NULL);
+
+  // 写入失败时也需关闭
+  succ = gdk_pixbuf_loader_close(loader, NULL) && succ;
+  if (succ) pixbuf = gdk_pixbuf_loader_get_pixbuf(loader);
+  g_free(shot->idle_capture);
+  shot->idle_capture = NULL;
+  shot->idle_capture_size = 0;
+  if (!pixbuf) {
+    g_object_unref(loader);
+    return FALSE;
+  }
+
+  GdkRectangle bounds = {.x = shot->x, .y = shot->y
+                          , .width = gdk_pixbuf_get_width(pixbuf)
+                          , .height = gdk_pixbuf_get_height(pixbuf)};
+  gtk_shot_edges_clear(shot->edges);
+  shot->screen_pixbuf = g_object_ref(pixbuf);
+  g_object_unref(loader);
+  gtk_shot_set_bounds(shot, &bounds);
+  gtk_shot_edges_build(shot->edges, shot->screen_pixbuf
+                          , shot->x, shot->y);
+
+  return TRUE;
+}
+
+/**
+ * 将截图和窗口扩展到与area相交的所有显示器上.
+ * 新显示器在窗口覆盖其之前截取,故截图中不会出现遮罩层;
+ * 已截取的部分直接从原截图中拷贝
+ */
+void gtk_shot_expand(GtkShot *shot, GdkRectangle *area) {
+  GdkScreen *screen = gtk_widget_get_screen(GTK_WIDGET(shot));
+  GdkRectangle old = {.x = shot->x, .y = shot->y
+                        , .width = shot->width
+                        , .height = shot->height};
+  GdkRectangle bounds = old, monitor, rect, covered;
+  gint i = 0, n = gdk_screen_get_n_monitors(screen);
+
+  if (!shot->screen_pixbuf) return;
+
+  for (i = 0; i < n; i++) {
+    gdk_screen_get_monitor_geometry(screen, i, &monitor);
+    if (gdk_rectangle_intersect(&monitor, area, &rect)) {
+      gdk_rectangle_union(&bounds, &monitor, &bounds);
+    }
+  }
+  // 扩展后的范围必然包含原范围
+  if (bounds.width == old.width && bounds.height == old.height) {
+    return;
+  }
+#ifdef GTK_SHOT_DEBUG
+  debug("expand from (%d, %d: %d, %d) to (%d, %d: %d, %d)\n"
+            , old.x, old.y, old.width, old.height
+            , bounds.x, bounds.y, bounds.width, bounds.height);
+#endif
+  gtk_shot_edges_clear(shot->edges);
+  trace_begin("capture");
+  gtk_shot_hud_begin_capture(shot->hud);
+  GdkPixbuf *pixbuf =
+        gtk_shot_pool_acquire_pixbuf(shot->pool
+                                        , bounds.width, bounds.height);
+  gdk_pixbuf_fill(pixbuf, 0);
+  for (i = 0; i < n; i++) {
+    gdk_screen_get_monitor_geometry(screen, i, &monitor);
+    if (!gdk_rectangle_intersect(&monitor, &bounds, &rect)) continue;
+    // 已被窗口覆盖的显示器不再截取
+    if (gdk_rectangle_intersect(&rect, &old, &covered)
+          && covered.width == rect.width
+          && covered.height == rect.height) {
+      continue;
+    }
+    gdk_pixbuf_get_from_drawable(pixbuf
+                                  , gdk_get_default_root_window()
+                                  , NULL
+                                  , rect.x, rect.y
+                                  , rect.x - bounds.x
+                                  , rect.y - bounds.y
+                                  , rect.width, rect.height);
+  }
+  gdk_pixbuf_copy_area(shot->screen_pixbuf, 0, 0
+                          , old.width, old.height
+                          , pixbuf
+                          , old.x - bounds.x, old.y - bounds.y);
+  gtk_shot_pool_release_pixbuf(shot->pool, shot->screen_pixbuf);
+  shot->screen_pixbuf = pixbuf;
+  gtk_shot_hud_end_capture(shot->hud);
+  trace_end("capture");
+
+  gtk_shot_set_bounds(shot, &bounds);
+  gtk_shot_edges_build(shot->edges, shot->screen_pixbuf
+                          , shot->x, shot->y);
+}
+
+void gtk_shot_expand_to_section(GtkShot *shot) {
+  GdkRectangle area = {.x = shot->section.x, .y = shot->section.y
+                        , .width = MAX(shot->section.width, 1)
+                        , .height = MAX(shot->section.height, 1)};
+  gtk_shot_expand(shot, &area);
+}
+
+/**
+ * 设置窗口的范围(屏幕坐标),仅在尺寸变化时更换遮罩层
+ */
+void gtk_shot_set_bounds(GtkShot *shot, GdkRectangle *bounds) {
+  if (!shot->mask_surface
+        || shot->width != bounds->width
+        || shot->height != bounds->height) {
+    if (shot->mask_cr) cairo_destroy(shot->mask_cr);
+    gtk_shot_pool_release_surface(shot->pool, shot->mask_surface);
+    shot->mask_surface =
+              gtk_shot_pool_acquire_surface(shot->pool
+                                              , bounds->width
+                                              , bounds->height);
+    shot->mask_cr = cairo_create(shot->mask_surface);
+    gtk_shot_drop_buffer(shot);
+  }
+  shot->x = bounds->x;
+  shot->y = bounds->y;
+  shot->width = bounds->width;
+  shot->height = bounds->height;
+  // 截图已更换,重绘时整体上传
+  shot->screen_dirty.x = shot->screen_dirty.y = 0;
+  shot->screen_dirty.width = shot->width;
+  shot->screen_dirty.height = shot->height;
+
+  gtk_window_move(GTK_WINDOW(shot), shot->x, shot->y);
+  gtk_window_resize(GTK_WINDOW(shot), shot->width, shot->height);
+  // 截图和遮罩层已更换
+  gtk_shot_memory_sample();
+}
+
+/** 将屏幕上指定区域(屏幕坐标)的内容同步到截图中 */
+void gtk_shot_fetch_screen(GtkShot *shot, GdkRectangle *area) {
+  if (!shot->screen_pixbuf
+        || area->width <= 0 || area->height <= 0) {
+    return;
+  }
+  // 截图被修改,已有的边缘索引失效
+  gtk_shot_edges_clear(shot->edges);
+  gdk_pixbuf_get_from_drawable(shot->screen_pixbuf
+                                , gdk_get_default_root_window()
+                                , NULL
+                                , area->x, area->y
+                                , area->x - shot->x
+                                , area->y - shot->y
+                                , area->width, area->height);
+  // 仅重新上传被同步的区域
+  GdkRectangle dirty = {.x = area->x - shot->x, .y = area->y - shot->y
+                         , .width = area->width, .height = area->height};
+  if (shot->screen_dirty.width > 0 && shot->screen_dirty.height > 0) {
+    gdk_rectangle_union(&shot->screen_dirty, &dirty, &shot->screen_dirty);
+  } else {
+    shot->screen_dirty = dirty;
+  }
+}
+
+/**
+ * 按需创建窗口的cairo上下文和服务端的后备缓冲,
+ * 并将截图中修改过的区域上传到服务端,此后的重绘只在服务端合成
+ */
+void gtk_shot_prepare_buffer(GtkShot *shot) {
+  GdkRectangle *dirty = &shot->screen_dirty;
+
+  if (!shot->window_cr) {
+    shot->window_cr = gdk_cairo_create(GTK_WIDGET(shot)->window);
+  }
+  cairo_surface_t *target = cairo_get_target(shot->window_cr);
+  if (!shot->buffer_surface) {
+    shot->buffer_surface =
+      cairo_surface_create_similar(target, CAIRO_CONTENT_COLOR_ALPHA
+                                      , shot->width, shot->height);
+    shot->buffer_cr = cairo_create(shot->buffer_surface);
+  }
+  if (!shot->screen_pixbuf) return;
+  if (!shot->screen_surface) {
+    shot->screen_surface =
+      cairo_surface_create_similar(target, CAIRO_CONTENT_COLOR_ALPHA
+                                      , shot->width, shot->height);
+  }
+  if (dirty->width > 0 && dirty->height > 0) {
+    GdkPixbuf *pixbuf = gdk_pixbuf_new_subpixbuf(shot->screen_pixbuf
+                                                  , dirty->x, dirty->y
+                                                  , dirty->width
+                                                  , dirty->height);
+    cairo_t *cr = cairo_create(shot->screen_surface);
+
+    cairo_set_operator(cr, CAIRO_OPERATOR_SOURCE);
+    gdk_cairo_set_source_pixbuf(cr, pixbuf, dirty->x, dirty->y);
+    cairo_paint(cr);
+    cairo_destroy(cr);
+    g_object_unref(pixbuf);
+    dirty->width = dirty->height = 0;
+  }
+}
+
+/** 释放窗口的cairo上下文和服务端的缓冲,下次重绘时按新的尺寸重建 */
+void gtk_shot_drop_buffer(GtkShot *shot) {
+  if (shot->window_cr) cairo_destroy(shot->window_cr);
+  shot->window_cr = NULL;
+  if (shot->buffer_cr) cairo_destroy(shot->buffer_cr);
+  shot->buffer_cr = NULL;
+  if (shot->buffer_surface) cairo_surface_destroy(shot->buffer_surface);
+  shot->buffer_surface = NULL;
+  if (shot->screen_surface) cairo_surface_destroy(shot->screen_surface);
+  shot->screen_surface = NULL;
+  shot->screen_dirty.x = shot->screen_dirty.y = 0;
+  shot->screen_dirty.width = shot->width;
+  shot->screen_dirty.height = shot->height;
+}
+
+/**
+ * 使窗口的指定区域(窗口坐标,NULL为整个窗口)失效.
+ * GDK为失效区域分配GdkRegion,不计入热路径的分配
+ */
+void gtk_shot_invalidate(GtkShot *shot, GdkRectangle *rect) {
+  GdkWindow *window = GTK_WIDGET(shot)->window;
+
+  if (!window) return;
+#ifdef GTK_SHOT_DEBUG
+  gtk_shot_alloc_exempt(TRUE);
+#endif
+  gdk_window_invalidate_rect(window, rect, FALSE);
+#ifdef GTK_SHOT_DEBUG
+  gtk_shot_alloc_exempt(FALSE);
+#endif
+}
+
+/**
+ * 动态截图时,按当前选区镂空窗口,
+ * 仅在选区变化时更新窗口形状
+ */
+void gtk_shot_update_live_area(GtkShot *shot) {
+  GdkWindow *window = GTK_WIDGET(shot)->window;
+  GdkRectangle bounds = {.x = 0, .y = 0
+                          , .width = shot->width
+                          , .height = shot->height};
+  GdkRectangle area;
+  gint x0, y0, x1, y1;
+
+  if (!window) return;
+
+  gtk_shot_get_section(shot, &x0, &y0, &x1, &y1);
+  area.x = x0;
+  area.y = y0;
+  area.width = MAX(x1 - x0, 0);
+  area.height = MAX(y1 - y0, 0);
+  if (area.x == shot->live_area.x
+        && area.y == shot->live_area.y
+        && area.width == shot->live_area.width
+        && area.height == shot->live_area.height) {
+    return;
+  }
+  shot->live_area = area;
+
+  // 窗口形状使用窗口坐标
+  area.x -= shot->x;
+  area.y -= shot->y;
+  GdkRegion *shape = gdk_region_rectangle(&bounds);
+  GdkRegion *hole = gdk_region_rectangle(&area);
+  gdk_region_subtract(shape, hole);
+  gdk_window_shape_combine_region(window, shape, 0, 0);
+  gdk_region_destroy(hole);
+  gdk_region_destroy(shape);
+}
+
+/** 截图,缓存池中闲置的截图及滚动截图的长图 */
+gsize gtk_shot_probe_capture(GtkShot *shot) {
+  gsize size = 0;
+
+  if (shot->screen_pixbuf) {
+    size += (gsize) gdk_pixbuf_get_rowstride(shot->screen_pixbuf)
+              * gdk_pixbuf_get_height(shot->screen_pixbuf);
+  }
+  if (shot->pool) {
+    gsize pixbufs = 0;
+    gtk_shot_pool_get_memory(shot->pool, &pixbufs, NULL);
+    size += pixbufs;
+  }
+  if (shot->scroll) size += gtk_shot_scroll_get_memory(shot->scroll);
+
+  return size;
+}
+
+/** 遮罩层,缓存池中闲置的画布及放大镜 */
+gsize gtk_shot_probe_overlay(GtkShot *shot) {
+  gsize size = 0;
+
+  if (shot->mask_surface) {
+    size += (gsize) cairo_image_surface_get_stride(shot->mask_surface)
+              * cairo_image_surface_get_height(shot->mask_surface);
+  }
+  if (shot->pool) {
+    gsize surfaces = 0;
+    gtk_shot_pool_get_memory(shot->pool, NULL, &surfaces);
+    size += surfaces;
+  }
+  if (shot->loupe && shot->loupe->surface) {
+    size += (gsize) cairo_image_surface_get_stride(shot->loupe->surface)
+              * cairo_image_surface_get_height(shot->loupe->surface);
+  }
+  return size;
+}
+
+gsize gtk_shot_probe_doodle(GtkShot *shot) {
+  return shot->doodle ? gtk_shot_doodle_get_memory(shot->doodle) : 0;
+}
+
+/** 当前画笔,历史画笔(含拖动中的画笔)及其空间索引 */
+gsize gtk_shot_probe_pens(GtkShot *shot) {
+  gsize size = shot->historic_memory
+                + shot->historic_count * sizeof(GSList);
+
+  if (shot->dragging && shot->selected) {
+    size += gtk_shot_pen_get_memory(shot->selected);
+  }
+  if (shot->pen) size += gtk_shot_pen_get_memory(shot->pen);
+  if (shot->pens) size += gtk_shot_pen_index_get_memory(shot->pens);
+
+  return size;
+}
+
+gsize gtk_shot_probe_layouts(GtkShot *shot) {
+  return pango_cairo_get_layout_cache_memory();
+}
+
+/**
+ * 编码后的图像数据: 释放缓存时压缩的截图.
+ * 保存到文件时由gdk_pixbuf_save边编码边写入,不持有编码后的数据
+ */
+gsize gtk_shot_probe_encoder(GtkShot *shot) {
+  return shot->idle_capture_size;
 }
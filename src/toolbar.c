@@ -36,7 +36,9 @@ static PenButton pen_btns[] = {
   {.xpm = ellipse_xpm, .tips = N_("draw ellipse"), .type = GTK_SHOT_PEN_ELLIPSE},
   {.xpm = arrow_xpm, .tips = N_("draw arrow"), .type = GTK_SHOT_PEN_ARROW},
   {.xpm = line_xpm, .tips = N_("draw line"), .type = GTK_SHOT_PEN_LINE},
-  {.xpm = text_xpm, .tips = N_("draw text"), .type = GTK_SHOT_PEN_TEXT}
+  {.xpm = text_xpm, .tips = N_("draw text"), .type = GTK_SHOT_PEN_TEXT},
+  {.xpm = mosaic_xpm, .tips = N_("pixelate"), .type = GTK_SHOT_PEN_MOSAIC},
+  {.xpm = blur_xpm, .tips = N_("blur"), .type = GTK_SHOT_PEN_BLUR}
 };
 
 // Button Events
@@ -55,7 +57,7 @@ static GtkBox* create_pen_box(GtkShotToolbar *toolbar);
 static GtkBox* create_op_box(GtkShotToolbar *toolbar);
 
 GtkShotToolbar* gtk_shot_toolbar_new(GtkShot *shot) {
-  gint width = 338, height = 36;
+  gint width = 398, height = 36;
   GtkShotToolbar *toolbar = g_new(GtkShotToolbar, 1);
   GtkWindow *window =
         create_popup_window(GTK_WINDOW(shot), width, height);
@@ -0,0 +1,304 @@
+/*
+ * GtkShot - A screen capture programme using GtkLib
+ * Copyright (C) 2012 flytreeleft @ CrazyDan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <config.h>
+
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <glib.h>
+
+#include "trace.h"
+
+/* The size of a formatted JSON event */
+#define LINE_SIZE 256
+/* The maximum length of a thread name */
+#define THREAD_NAME_SIZE 16
+
+typedef struct _Buffer {
+  gchar name[THREAD_NAME_SIZE]; // 线程名,为空时以序号表示
+  gint busy; // 所属线程仍在运行,缓冲区不可被其他线程使用
+  guint count; // 已写入的事件总数(仅所属线程修改)
+  const gchar *spans[GTK_SHOT_TRACE_DEPTH]; // 尚未结束的区间
+  gint depth; // 区间的嵌套深度(可超出GTK_SHOT_TRACE_DEPTH)
+  GtkShotTraceEvent events[GTK_SHOT_TRACE_EVENTS];
+} Buffer;
+
+// 各线程的缓冲区,只增不减
+static Buffer *buffers[GTK_SHOT_TRACE_THREADS];
+static gint n_buffers = 0;
+G_LOCK_DEFINE_STATIC(buffers);
+// 当前线程使用的缓冲区
+static __thread Buffer *local = NULL;
+// 线程退出时归还其缓冲区
+static GStaticPrivate owner = G_STATIC_PRIVATE_INIT;
+
+static Buffer* attach(const gchar *name);
+static void detach(Buffer *buffer);
+static GtkShotTraceEvent* next_event(gchar phase, const gchar *name);
+static gsize escape(gchar *dest, gsize size, const gchar *src);
+static gboolean write_all(gint fd, const gchar *buf, gsize len);
+
+/**
+ * 设置当前线程的名称,并独占一个缓冲区.
+ * 同名线程退出后其缓冲区可被之后的同名线程(如边缘索引线程)复用,
+ * 同时运行的同名线程各自使用不同的缓冲区
+ */
+void gtk_shot_trace_set_thread_name(const gchar *name) {
+  g_return_if_fail(name != NULL);
+
+  local = attach(name);
+}
+
+void gtk_shot_trace_record(gchar phase, const gchar *name) {
+  if (!next_event(phase, name)) return;
+
+  // 记录尚未结束的区间,供其他线程查询(见gtk_shot_trace_get_span)
+  gint depth = local->depth;
+  if (phase == 'B') {
+    if (depth < GTK_SHOT_TRACE_DEPTH) {
+      g_atomic_pointer_set(&local->spans[depth], name);
+    }
+    g_atomic_int_set(&local->depth, depth + 1);
+  } else if (phase == 'E' && depth > 0) {
+    g_atomic_int_set(&local->depth, depth - 1);
+  }
+}
+
+/** 调试消息(见trace_message()),超出长度的部分被截断 */
+void gtk_shot_trace_message(const gchar *name, const gchar *fmt, ...) {
+  GtkShotTraceEvent *event = next_event('i', name);
+  va_list args;
+
+  if (!event) return;
+
+  va_start(args, fmt);
+  gint len = g_vsnprintf(event->text, GTK_SHOT_TRACE_TEXT_SIZE
+                          , fmt, args);
+  va_end(args);
+  // 去除消息末尾的换行
+  len = MIN(len, GTK_SHOT_TRACE_TEXT_SIZE - 1);
+  if (len > 0 && event->text[len - 1] == '\n') {
+    event->text[len - 1] = '\0';
+  }
+}
+
+/**
+ * 将各线程缓冲区中的事件以Chrome trace格式(JSON)写入文件.
+ * 仅使用栈上的空间和write,不分配内存;
+ * 但格式化使用了浮点数,不可在信号处理函数中调用
+ */
+gboolean gtk_shot_trace_dump(const gchar *filename, GError **error) {
+  g_return_val_if_fail(filename != NULL, FALSE);
+
+  gint fd = open(filename, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  gchar line[LINE_SIZE], name[LINE_SIZE / 2], text[LINE_SIZE / 2];
+  gint pid = getpid(), n = g_atomic_int_get(&n_buffers), i = 0;
+  gboolean succ = TRUE, first = TRUE;
+
+  if (fd < 0) goto fail;
+
+  succ = write_all(fd, "{\"traceEvents\":[\n", 17);
+  for (i = 0; i < n && succ; i++) {
+    Buffer *buffer = buffers[i];
+    guint count = g_atomic_int_get((gint*) &buffer->count);
+    guint start = count > GTK_SHOT_TRACE_EVENTS
+                    ? count - GTK_SHOT_TRACE_EVENTS : 0;
+    gint len = 0;
+
+    if (buffer->name[0]) {
+      escape(name, sizeof(name), buffer->name);
+      len = g_snprintf(line, LINE_SIZE
+                        , "%s{\"name\":\"thread_name\",\"ph\":\"M\""
+                          ",\"pid\":%d,\"tid\":%d"
+                          ",\"args\":{\"name\":\"%s\"}}"
+                        , first ? "" : ",\n", pid, i + 1, name);
+      succ = write_all(fd, line, MIN(len, LINE_SIZE - 1));
+      first = FALSE;
+    }
+    for (; start < count && succ; start++) {
+      GtkShotTraceEvent *event =
+        &buffer->events[start & (GTK_SHOT_TRACE_EVENTS - 1)];
+
+      escape(name, sizeof(name), event->name);
+      if (event->phase == 'i') {
+        escape(text, sizeof(text), event->text);
+        len = g_snprintf(line, LINE_SIZE
+                          , "%s{\"name\":\"%s\",\"ph\":\"i\",\"s\":\"t\""
+                            ",\"ts\":%.3f,\"pid\":%d,\"tid\":%d"
+                            ",\"args\":{\"msg\":\"%s\"}}"
+                          , first ? "" : ",\n", name
+                          , event->time / 1000.0, pid, i + 1, text);
+      } else {
+        len = g_snprintf(line, LINE_SIZE
+                          , "%s{\"name\":\"%s\",\"ph\":\"%c\""
+                            ",\"ts\":%.3f,\"pid\":%d,\"tid\":%d}"
+                          , first ? "" : ",\n", name, event->phase
+                          , event->time / 1000.0, pid, i + 1);
+      }
+      succ = write_all(fd, line, MIN(len, LINE_SIZE - 1));
+      first = FALSE;
+    }
+  }
+  if (succ) {
+    succ = write_all(fd, "\n],\"displayTimeUnit\":\"ms\"}\n", 27);
+  }
+  if (close(fd) != 0) succ = FALSE;
+  if (succ) return TRUE;
+
+fail:
+  g_set_error(error, G_FILE_ERROR
+                , g_file_error_from_errno(errno)
+                , "%s: %s", filename, g_strerror(errno));
+  return FALSE;
+}
+
+/**
+ * 线程(名称为thread)当前所处的最内层区间,
+ * 可在其他线程中调用,不在任何区间中时返回NULL
+ */
+const gchar* gtk_shot_trace_get_span(const gchar *thread) {
+  g_return_val_if_fail(thread != NULL, NULL);
+
+  gint n = g_atomic_int_get(&n_buffers), i = 0;
+  for (i = 0; i < n; i++) {
+    Buffer *buffer = buffers[i];
+    if (strcmp(buffer->name, thread) != 0) continue;
+
+    gint depth = g_atomic_int_get(&buffer->depth);
+    if (depth <= 0) return NULL;
+    return g_atomic_pointer_get(
+              &buffer->spans[MIN(depth, GTK_SHOT_TRACE_DEPTH) - 1]);
+  }
+  return NULL;
+}
+
+/** 单调时钟(纳秒),与追踪事件的时间一致 */
+gint64 gtk_shot_trace_time() {
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (gint64) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/**
+ * 为当前线程取得一个名称为name(为NULL时匿名)且空闲的缓冲区,
+ * 无空闲的同名缓冲区时新建.
+ * 缓冲区数达到上限时返回NULL,该线程的事件将被忽略
+ */
+Buffer* attach(const gchar *name) {
+  Buffer *buffer = NULL;
+  gint i = 0;
+
+  // 先归还当前线程原有的缓冲区(见detach)
+  g_static_private_set(&owner, NULL, NULL);
+  G_LOCK(buffers);
+  for (i = 0; i < n_buffers; i++) {
+    if (!buffers[i]->busy
+          && strcmp(buffers[i]->name, name ? name : "") == 0) {
+      buffer = buffers[i];
+      break;
+    }
+  }
+  if (!buffer && n_buffers < GTK_SHOT_TRACE_THREADS) {
+    buffer = g_new0(Buffer, 1);
+    if (name) g_strlcpy(buffer->name, name, THREAD_NAME_SIZE);
+    buffers[n_buffers] = buffer;
+    // 缓冲区初始化完成后才对导出可见
+    g_atomic_int_inc(&n_buffers);
+  }
+  if (buffer) {
+    buffer->busy = TRUE;
+    // 上一个线程可能在区间中退出
+    g_atomic_int_set(&buffer->depth, 0);
+  }
+  G_UNLOCK(buffers);
+  g_static_private_set(&owner, buffer, (GDestroyNotify) detach);
+
+  return buffer;
+}
+
+/** 线程退出(或更换名称)时归还缓冲区,已记录的事件仍可导出 */
+void detach(Buffer *buffer) {
+  if (!buffer) return;
+
+  G_LOCK(buffers);
+  buffer->busy = FALSE;
+  G_UNLOCK(buffers);
+}
+
+/** 占用当前线程的下一个事件,写满后覆盖最早的事件 */
+GtkShotTraceEvent* next_event(gchar phase, const gchar *name) {
+  static __thread gboolean attached = FALSE;
+
+  if (!local && !attached) {
+    local = attach(NULL);
+    attached = TRUE;
+  }
+  if (!local) return NULL;
+
+  GtkShotTraceEvent *event =
+    &local->events[local->count & (GTK_SHOT_TRACE_EVENTS - 1)];
+  event->time = gtk_shot_trace_time();
+  event->name = name;
+  event->phase = phase;
+  event->text[0] = '\0';
+  g_atomic_int_inc((gint*) &local->count);
+
+  return event;
+}
+
+/** 转义JSON字符串中的引号,反斜杠和控制字符,超出size时截断 */
+gsize escape(gchar *dest, gsize size, const gchar *src) {
+  gsize len = 0;
+
+  for (; src && *src && len + 7 < size; src++) {
+    guchar c = (guchar) *src;
+    if (c == '"' || c == '\\') {
+      dest[len++] = '\\';
+      dest[len++] = c;
+    } else if (c == '\n') {
+      dest[len++] = '\\';
+      dest[len++] = 'n';
+    } else if (c < 0x20) {
+      len += g_snprintf(dest + len, size - len, "\\u%04x", c);
+    } else {
+      dest[len++] = c;
+    }
+  }
+  dest[len] = '\0';
+
+  return len;
+}
+
+gboolean write_all(gint fd, const gchar *buf, gsize len) {
+  while (len > 0) {
+    ssize_t n = write(fd, buf, len);
+    if (n < 0) {
+      if (errno == EINTR) continue;
+      return FALSE;
+    }
+    buf += n;
+    len -= n;
+  }
+  return TRUE;
+}
@@ -18,15 +18,30 @@
 #include <config.h>
 
 #include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
 #include <math.h>
+#ifdef GTK_SHOT_DEBUG
+#include <pthread.h>
+#endif
 
 #include <glib/gi18n.h>
 
 #include "utils.h"
+#include "trace.h"
 
 #define FILE_NAME ("gtkshot")
 
+typedef struct _CachedLayout {
+  gchar *text, *fontname;
+  PangoLayout *layout;
+} CachedLayout;
+
+// 文本布局缓存,最近使用的位于队首
+static GQueue layout_cache = G_QUEUE_INIT;
+
+static void free_cached_layout(CachedLayout *cached);
+
 void parse_to_gdk_color(gint color, GdkColor *c) {
   char *color_str;
   color_str = g_strdup_printf("#%02x%02x%02x"
@@ -118,7 +133,10 @@ gchar* choose_and_get_filename(GtkWindow *parent, char **type
   if (path) {
     gtk_file_chooser_set_current_folder(dialog, path);
   }
-  if (gtk_dialog_run(GTK_DIALOG(dialog)) == GTK_RESPONSE_OK) {
+  trace_begin("dialog");
+  gint response = gtk_dialog_run(GTK_DIALOG(dialog));
+  trace_end("dialog");
+  if (response == GTK_RESPONSE_OK) {
     filter = gtk_file_chooser_get_filter(dialog);
     filename = g_locale_from_utf8(gtk_file_chooser_get_filename(dialog)
                                       , -1, NULL, NULL, NULL);
@@ -206,7 +224,9 @@ void popup_message_dialog(GtkWindow *parent, const char *msg) {
                                           , GTK_MESSAGE_ERROR
                                           , GTK_BUTTONS_OK
                                           , "%s", msg);
+  trace_begin("dialog");
   gtk_dialog_run(GTK_DIALOG(msg_dlg));
+  trace_end("dialog");
   gtk_widget_destroy(msg_dlg);
 }
 
@@ -215,7 +235,9 @@ void save_pixbuf_to_clipboard(GdkPixbuf *pixbuf) {
                 gtk_clipboard_get(GDK_SELECTION_CLIPBOARD);
   gtk_clipboard_set_image(clipboard, pixbuf);
   gtk_clipboard_set_can_store(clipboard, NULL, 0);
+  trace_begin("clipboard");
   gtk_clipboard_store(clipboard);
+  trace_end("clipboard");
 }
 
 /** 取消所有按钮的激活状态 */
@@ -262,9 +284,87 @@ PangoLayout* pango_cairo_prepare_layout(cairo_t *cr, char *text
   return layout;
 }
 
+/**
+ * 获取缓存的文本布局(归缓存所有,不可释放,仅在下次调用前有效),
+ * 用于信息框/提示等少量覆盖层文字(文字画笔的布局缓存在画笔上):
+ * 文本和字体不变时不再重新解析字体及排版.
+ * 每个布局使用自身的PangoContext,取用时按cr更新,
+ * 仅在cr的字体选项或变换变化时重新排版
+ */
+PangoLayout* pango_cairo_get_cached_layout(cairo_t *cr, const char *text
+                                              , const char *fontname) {
+  CachedLayout *cached = NULL;
+  GList *l = layout_cache.head;
+
+  for (l; l; l = l->next) {
+    cached = (CachedLayout*) l->data;
+    if (strcmp(cached->text, text) == 0
+          && strcmp(cached->fontname, fontname) == 0) {
+      break;
+    }
+  }
+  if (l) {
+    g_queue_unlink(&layout_cache, l);
+    g_queue_push_head_link(&layout_cache, l);
+  } else {
+    PangoFontDescription *desc
+          = pango_font_description_from_string(fontname);
+
+    cached = g_new(CachedLayout, 1);
+    cached->text = g_strdup(text);
+    cached->fontname = g_strdup(fontname);
+    cached->layout = pango_cairo_create_layout(cr);
+    pango_layout_set_text(cached->layout, text, -1);
+    pango_layout_set_font_description(cached->layout, desc);
+    pango_font_description_free(desc);
+    g_queue_push_head(&layout_cache, cached);
+    if (layout_cache.length > TEXT_LAYOUT_CACHE_SIZE) {
+      free_cached_layout(g_queue_pop_tail(&layout_cache));
+    }
+  }
+  pango_cairo_update_layout(cr, cached->layout);
+
+  return cached->layout;
+}
+
+void pango_cairo_clear_layout_cache() {
+  CachedLayout *cached = NULL;
+
+  while ((cached = g_queue_pop_head(&layout_cache))) {
+    free_cached_layout(cached);
+  }
+}
+
+/**
+ * 缓存的文本布局占用的内存(字节).
+ * PangoLayout的内部结构不公开,按字符数估算
+ */
+gsize pango_cairo_get_layout_cache_memory() {
+  gsize size = 0;
+  GList *l = layout_cache.head;
+
+  for (l; l; l = l->next) {
+    CachedLayout *cached = (CachedLayout*) l->data;
+    gsize length = strlen(cached->text);
+
+    size += sizeof(CachedLayout) + sizeof(GList)
+              + length + 1 + strlen(cached->fontname) + 1
+              + TEXT_LAYOUT_BASE_SIZE
+              + g_utf8_strlen(cached->text, length) * TEXT_LAYOUT_CHAR_SIZE;
+  }
+  return size;
+}
+
+void free_cached_layout(CachedLayout *cached) {
+  g_object_unref(cached->layout);
+  g_free(cached->text);
+  g_free(cached->fontname);
+  g_free(cached);
+}
+
 void cairo_draw_text(cairo_t *cr, char *text, char *fontname) {
   PangoLayout *layout =
-    pango_cairo_prepare_layout(cr, text, fontname);
+    pango_cairo_get_cached_layout(cr, text, fontname);
   pango_cairo_show_layout(cr, layout);
 }
 
@@ -302,7 +402,7 @@ void cairo_round_msg_box(cairo_t *cr, char *msg
                                 , gint pad_top, gint pad_right
                                 , gint pad_bottom, gint pad_left) {
   PangoLayout *layout =
-    pango_cairo_prepare_layout(cr, msg, fontname);
+    pango_cairo_get_cached_layout(cr, msg, fontname);
 
   gint width = 0, height = 0;
   pango_layout_get_pixel_size(layout, &width, &height);
@@ -319,3 +419,79 @@ void cairo_round_msg_box(cairo_t *cr, char *msg
   cairo_move_to(cr, x, y);
   pango_cairo_show_layout(cr, layout);
 }
+
+#ifdef GTK_SHOT_DEBUG
+# ifdef HAVE___LIBC_MALLOC
+// glibc的原始分配函数,覆盖malloc后由此转发
+extern void* __libc_malloc(size_t size);
+extern void* __libc_calloc(size_t n_blocks, size_t n_block_bytes);
+extern void* __libc_realloc(void *mem, size_t size);
+
+// 仅统计主线程的分配,后台线程(如边缘索引)的分配不计入
+static pthread_t alloc_thread;
+static volatile gboolean alloc_counting = FALSE;
+static volatile gulong alloc_count = 0;
+static gint alloc_exempt = 0;
+
+#define COUNT_ALLOC() \
+          do { \
+            if (alloc_counting && alloc_exempt == 0 \
+                  && pthread_equal(pthread_self(), alloc_thread)) { \
+              alloc_count++; \
+            } \
+          } while(0)
+
+/* 调试时覆盖libc的分配函数,GLib,GDK,cairo和pango的分配均会计入 */
+void* malloc(size_t size) {
+  COUNT_ALLOC();
+  return __libc_malloc(size);
+}
+
+void* calloc(size_t n_blocks, size_t n_block_bytes) {
+  COUNT_ALLOC();
+  return __libc_calloc(n_blocks, n_block_bytes);
+}
+
+void* realloc(void *mem, size_t size) {
+  COUNT_ALLOC();
+  return __libc_realloc(mem, size);
+}
+
+/**
+ * 开始统计主线程的堆分配次数
+ * @return 无法覆盖malloc(非glibc)时返回FALSE,计数始终为0
+ */
+gboolean gtk_shot_alloc_counter_install() {
+  alloc_thread = pthread_self();
+  alloc_counting = TRUE;
+  return TRUE;
+}
+
+gulong gtk_shot_alloc_count() {
+  return alloc_count;
+}
+
+/**
+ * 豁免其间的分配(可嵌套),用于热路径中GDK必然分配的调用,
+ * 如失效区域的GdkRegion
+ */
+void gtk_shot_alloc_exempt(gboolean exempt) {
+  if (!alloc_counting
+        || !pthread_equal(pthread_self(), alloc_thread)) {
+    return;
+  }
+  alloc_exempt += exempt ? 1 : -1;
+}
+# else
+gboolean gtk_shot_alloc_counter_install() {
+  return FALSE;
+}
+
+gulong gtk_shot_alloc_count() {
+  return 0;
+}
+
+void gtk_shot_alloc_exempt(gboolean exempt) {
+}
+# endif
+#endif
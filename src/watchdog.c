@@ -0,0 +1,221 @@
+/*
+ * GtkShot - A screen capture programme using GtkLib
+ * Copyright (C) 2012 flytreeleft @ CrazyDan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <config.h>
+
+#include <gtk/gtk.h>
+
+#include "utils.h"
+#include "trace.h"
+
+#include "watchdog.h"
+
+static gpointer watch(GtkShotWatchdog *watchdog);
+static gboolean on_heartbeat(GtkShotWatchdog *watchdog);
+static void record(GtkShotWatchdog *watchdog, gdouble ms
+                      , const gchar *operation);
+
+GtkShotWatchdog* gtk_shot_watchdog_new(guint threshold) {
+  GtkShotWatchdog *watchdog = g_new0(GtkShotWatchdog, 1);
+
+  watchdog->threshold = threshold > 0
+                          ? threshold : GTK_SHOT_WATCHDOG_THRESHOLD;
+  watchdog->thread = NULL;
+  watchdog->mutex = g_mutex_new();
+  watchdog->cond = g_cond_new();
+  watchdog->running = FALSE;
+  watchdog->pending = FALSE;
+  watchdog->source = 0;
+
+  return watchdog;
+}
+
+void gtk_shot_watchdog_destroy(GtkShotWatchdog *watchdog) {
+  g_return_if_fail(watchdog != NULL);
+
+  gtk_shot_watchdog_stop(watchdog);
+  g_cond_free(watchdog->cond);
+  g_mutex_free(watchdog->mutex);
+  g_free(watchdog);
+}
+
+/** 启动监测线程,需在主线程中调用 */
+void gtk_shot_watchdog_start(GtkShotWatchdog *watchdog) {
+  g_return_if_fail(watchdog != NULL);
+
+  if (watchdog->thread) return;
+
+  watchdog->running = TRUE;
+  watchdog->thread = g_thread_create((GThreadFunc) watch
+                                        , watchdog, TRUE, NULL);
+  if (!watchdog->thread) watchdog->running = FALSE;
+}
+
+/** 停止监测线程,并撤销尚未响应的心跳,需在主线程中调用 */
+void gtk_shot_watchdog_stop(GtkShotWatchdog *watchdog) {
+  g_return_if_fail(watchdog != NULL);
+
+  if (!watchdog->thread) return;
+
+  g_mutex_lock(watchdog->mutex);
+  watchdog->running = FALSE;
+  g_cond_broadcast(watchdog->cond);
+  g_mutex_unlock(watchdog->mutex);
+  g_thread_join(watchdog->thread);
+  watchdog->thread = NULL;
+
+  if (watchdog->pending) {
+    g_source_remove(watchdog->source);
+    watchdog->pending = FALSE;
+    watchdog->source = 0;
+  }
+}
+
+/**
+ * 卡顿统计: 心跳延时的分布及最近的卡顿,运行期间也可获取
+ * @return 报告的文本,需由调用方释放
+ */
+gchar* gtk_shot_watchdog_report(GtkShotWatchdog *watchdog) {
+  g_return_val_if_fail(watchdog != NULL, NULL);
+
+  GString *report = g_string_new(NULL);
+  gint i = 0;
+
+  g_mutex_lock(watchdog->mutex);
+  g_string_append_printf(report
+            , "watchdog: %u heartbeat(s), %u stall(s) over %u ms"
+              ", worst %.1f ms (%s)\n"
+            , watchdog->beats, watchdog->stalls, watchdog->threshold
+            , watchdog->worst
+            , watchdog->worst_operation
+                ? watchdog->worst_operation : "unknown");
+  for (i = 0; i < GTK_SHOT_WATCHDOG_BUCKETS; i++) {
+    if (watchdog->histogram[i] == 0) continue;
+    if (i == GTK_SHOT_WATCHDOG_BUCKETS - 1) {
+      g_string_append_printf(report, "  [%5u,   inf) ms: %u\n"
+                                , 1 << (i - 1), watchdog->histogram[i]);
+    } else {
+      g_string_append_printf(report, "  [%5u, %5u) ms: %u\n"
+                                , i > 0 ? 1 << (i - 1) : 0
+                                , 1 << i, watchdog->histogram[i]);
+    }
+  }
+  // 由旧到新列出最近的卡顿
+  guint n = MIN(watchdog->stalls, GTK_SHOT_WATCHDOG_STALLS);
+  for (i = 0; i < n; i++) {
+    GtkShotWatchdogStall *stall =
+      &watchdog->recent[(watchdog->stalls - n + i)
+                          % GTK_SHOT_WATCHDOG_STALLS];
+    g_string_append_printf(report, "  stall: %7.1f ms in %s\n", stall->ms
+                              , stall->operation
+                                  ? stall->operation : "unknown");
+  }
+  g_mutex_unlock(watchdog->mutex);
+
+  return g_string_free(report, FALSE);
+}
+
+/**
+ * 监测线程: 投递心跳后等待其响应,
+ * 超过阈值仍未响应时,取主线程所处的追踪区间作为卡顿的操作.
+ * 两次心跳间隔阈值的一半,故卡顿的耗时为其下限
+ */
+gpointer watch(GtkShotWatchdog *watchdog) {
+  GTimeVal until;
+
+  gtk_shot_trace_set_thread_name("watchdog");
+
+  g_mutex_lock(watchdog->mutex);
+  while (watchdog->running) {
+    const gchar *operation = NULL;
+    gboolean stalled = FALSE;
+
+    watchdog->pending = TRUE;
+    watchdog->posted = gtk_shot_trace_time();
+    watchdog->source =
+      g_idle_add_full(G_PRIORITY_HIGH, (GSourceFunc) on_heartbeat
+                        , watchdog, NULL);
+
+    g_get_current_time(&until);
+    g_time_val_add(&until, watchdog->threshold * 1000);
+    while (watchdog->running && watchdog->pending) {
+      if (stalled) {
+        g_cond_wait(watchdog->cond, watchdog->mutex);
+      } else if (!g_cond_timed_wait(watchdog->cond, watchdog->mutex
+                                      , &until)
+                  && watchdog->pending) {
+        operation = gtk_shot_trace_get_span("main");
+        stalled = TRUE;
+      }
+    }
+    if (!watchdog->pending) {
+      record(watchdog
+              , (watchdog->answered - watchdog->posted) / 1000000.0
+              , operation);
+    }
+
+    g_get_current_time(&until);
+    g_time_val_add(&until, watchdog->threshold * 1000 / 2);
+    while (watchdog->running
+            && g_cond_timed_wait(watchdog->cond, watchdog->mutex
+                                  , &until)) {
+      // 直到超时或停止
+    }
+  }
+  g_mutex_unlock(watchdog->mutex);
+
+  return NULL;
+}
+
+gboolean on_heartbeat(GtkShotWatchdog *watchdog) {
+  g_mutex_lock(watchdog->mutex);
+  watchdog->answered = gtk_shot_trace_time();
+  watchdog->pending = FALSE;
+  watchdog->source = 0;
+  g_cond_broadcast(watchdog->cond);
+  g_mutex_unlock(watchdog->mutex);
+
+  return FALSE;
+}
+
+/** 统计心跳的延时,需持有mutex */
+void record(GtkShotWatchdog *watchdog, gdouble ms
+              , const gchar *operation) {
+  guint v = (guint) ms;
+  gint bucket = 0;
+
+  while (v > 0 && bucket < GTK_SHOT_WATCHDOG_BUCKETS - 1) {
+    v >>= 1;
+    bucket++;
+  }
+  watchdog->histogram[bucket]++;
+  watchdog->beats++;
+
+  if (ms < watchdog->threshold) return;
+
+  GtkShotWatchdogStall *stall =
+    &watchdog->recent[watchdog->stalls % GTK_SHOT_WATCHDOG_STALLS];
+  stall->operation = operation;
+  stall->ms = ms;
+  watchdog->stalls++;
+  if (ms > watchdog->worst) {
+    watchdog->worst = ms;
+    watchdog->worst_operation = operation;
+  }
+  trace_message_at(GTK_SHOT_TRACE_SPAN, "stall", "%.1f ms in %s", ms
+                    , operation ? operation : "unknown");
+}
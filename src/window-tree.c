@@ -0,0 +1,268 @@
+/*
+ * GtkShot - A screen capture programme using GtkLib
+ * Copyright (C) 2012 flytreeleft @ CrazyDan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <config.h>
+
+#include <gtk/gtk.h>
+#include <gdk/gdkx.h>
+
+#include "utils.h"
+
+#include "window-tree.h"
+
+typedef struct _WindowNode {
+  Window xid;
+  GdkRectangle rect; // 包含边框的范围(屏幕坐标)
+  gboolean viewable;
+  gboolean override_redirect; // 菜单/提示等弹出窗口
+} WindowNode;
+
+#define NODE(tree, i) (g_array_index((tree)->nodes, WindowNode, (i)))
+
+static GdkFilterReturn on_root_filter(GdkXEvent *xevent
+                                        , GdkEvent *event
+                                        , GtkShotWindowTree *tree);
+
+static gint find_node(GtkShotWindowTree *tree, Window xid);
+static void set_node_rect(WindowNode *node, gint x, gint y
+                            , gint width, gint height, gint border);
+static void add_node(GtkShotWindowTree *tree, Window xid);
+static void restack_node(GtkShotWindowTree *tree, gint i, Window above);
+
+GtkShotWindowTree* gtk_shot_window_tree_new(GdkWindow *root) {
+  GtkShotWindowTree *tree = g_new(GtkShotWindowTree, 1);
+
+  tree->root = root;
+  tree->nodes = g_array_new(FALSE, FALSE, sizeof(WindowNode));
+  tree->ignore = 0;
+  tree->active = FALSE;
+
+  return tree;
+}
+
+void gtk_shot_window_tree_destroy(GtkShotWindowTree *tree) {
+  g_return_if_fail(tree != NULL);
+
+  gtk_shot_window_tree_stop(tree);
+  g_array_free(tree->nodes, TRUE);
+  g_free(tree);
+}
+
+/**
+ * 获取所有顶层窗口的范围,并开始监听其变化.
+ * 仅在截图时调用一次
+ */
+void gtk_shot_window_tree_snapshot(GtkShotWindowTree *tree) {
+  g_return_if_fail(tree != NULL);
+
+  Display *dpy = GDK_WINDOW_XDISPLAY(tree->root);
+  Window root = None, parent = None, *children = NULL;
+  guint n = 0, i = 0;
+
+  g_array_set_size(tree->nodes, 0);
+  if (!tree->active) {
+    // 先监听再查询,防止遗漏两者之间的变化
+    gdk_window_set_events(tree->root
+                            , gdk_window_get_events(tree->root)
+                                | GDK_SUBSTRUCTURE_MASK);
+    gdk_window_add_filter(tree->root
+                            , (GdkFilterFunc) on_root_filter, tree);
+    tree->active = TRUE;
+  }
+
+  gdk_error_trap_push();
+  if (XQueryTree(dpy, GDK_WINDOW_XID(tree->root)
+                    , &root, &parent, &children, &n)) {
+    for (i = 0; i < n; i++) {
+      add_node(tree, children[i]);
+    }
+    if (children) XFree(children);
+  }
+  gdk_error_trap_pop();
+#ifdef GTK_SHOT_DEBUG
+  debug("snapshot %u top-level window(s)\n", tree->nodes->len);
+#endif
+}
+
+/** 截图窗口隐藏后停止监听,不再产生任何开销 */
+void gtk_shot_window_tree_stop(GtkShotWindowTree *tree) {
+  g_return_if_fail(tree != NULL);
+
+  if (!tree->active) return;
+  gdk_window_remove_filter(tree->root
+                            , (GdkFilterFunc) on_root_filter, tree);
+  gdk_window_set_events(tree->root
+                          , gdk_window_get_events(tree->root)
+                              & ~GDK_SUBSTRUCTURE_MASK);
+  g_array_set_size(tree->nodes, 0);
+  tree->active = FALSE;
+}
+
+void gtk_shot_window_tree_set_ignore(GtkShotWindowTree *tree
+                                        , GdkNativeWindow xid) {
+  g_return_if_fail(tree != NULL);
+
+  tree->ignore = xid;
+}
+
+/**
+ * 查找包含指定点(屏幕坐标)的最上层可见窗口
+ * @return 未找到时返回FALSE
+ */
+gboolean gtk_shot_window_tree_lookup(GtkShotWindowTree *tree
+                                        , gint x, gint y
+                                        , GdkRectangle *rect) {
+  g_return_val_if_fail(tree != NULL, FALSE);
+
+  gint i = 0;
+  for (i = (gint) tree->nodes->len - 1; i >= 0; i--) {
+    WindowNode *node = &NODE(tree, i);
+    if (!node->viewable || node->override_redirect
+          || node->xid == tree->ignore) {
+      continue;
+    }
+    if (x >= node->rect.x && x < node->rect.x + node->rect.width
+          && y >= node->rect.y && y < node->rect.y + node->rect.height) {
+      *rect = node->rect;
+      return TRUE;
+    }
+  }
+  return FALSE;
+}
+
+GdkFilterReturn on_root_filter(GdkXEvent *xevent, GdkEvent *event
+                                  , GtkShotWindowTree *tree) {
+  XEvent *xev = (XEvent*) xevent;
+  Window parent = GDK_WINDOW_XID(tree->root);
+  WindowNode node;
+  gint i = -1;
+
+  switch (xev->type) {
+    case CreateNotify:
+      if (xev->xcreatewindow.parent != parent) break;
+      // 新建窗口位于最上层
+      node.xid = xev->xcreatewindow.window;
+      node.viewable = FALSE;
+      node.override_redirect = xev->xcreatewindow.override_redirect;
+      set_node_rect(&node, xev->xcreatewindow.x
+                        , xev->xcreatewindow.y
+                        , xev->xcreatewindow.width
+                        , xev->xcreatewindow.height
+                        , xev->xcreatewindow.border_width);
+      g_array_append_val(tree->nodes, node);
+      break;
+    case DestroyNotify:
+      i = find_node(tree, xev->xdestroywindow.window);
+      if (i >= 0) g_array_remove_index(tree->nodes, i);
+      break;
+    case MapNotify:
+      i = find_node(tree, xev->xmap.window);
+      if (i >= 0) {
+        NODE(tree, i).viewable = TRUE;
+        NODE(tree, i).override_redirect = xev->xmap.override_redirect;
+      }
+      break;
+    case UnmapNotify:
+      i = find_node(tree, xev->xunmap.window);
+      if (i >= 0) NODE(tree, i).viewable = FALSE;
+      break;
+    case ConfigureNotify:
+      i = find_node(tree, xev->xconfigure.window);
+      if (i >= 0) {
+        NODE(tree, i).override_redirect = xev->xconfigure.override_redirect;
+        set_node_rect(&NODE(tree, i), xev->xconfigure.x
+                          , xev->xconfigure.y
+                          , xev->xconfigure.width
+                          , xev->xconfigure.height
+                          , xev->xconfigure.border_width);
+        restack_node(tree, i, xev->xconfigure.above);
+      }
+      break;
+    case CirculateNotify:
+      i = find_node(tree, xev->xcirculate.window);
+      if (i >= 0) {
+        node = NODE(tree, i);
+        g_array_remove_index(tree->nodes, i);
+        if (xev->xcirculate.place == PlaceOnTop) {
+          g_array_append_val(tree->nodes, node);
+        } else {
+          g_array_prepend_val(tree->nodes, node);
+        }
+      }
+      break;
+    case ReparentNotify:
+      i = find_node(tree, xev->xreparent.window);
+      if (xev->xreparent.parent != parent) {
+        // 被窗口管理器放入边框中,不再是顶层窗口
+        if (i >= 0) g_array_remove_index(tree->nodes, i);
+      } else if (i < 0) {
+        add_node(tree, xev->xreparent.window);
+      }
+      break;
+  }
+  // 事件仍需交给GDK处理
+  return GDK_FILTER_CONTINUE;
+}
+
+gint find_node(GtkShotWindowTree *tree, Window xid) {
+  gint i = 0;
+
+  for (i = (gint) tree->nodes->len - 1; i >= 0; i--) {
+    if (NODE(tree, i).xid == xid) return i;
+  }
+  return -1;
+}
+
+void set_node_rect(WindowNode *node, gint x, gint y
+                      , gint width, gint height, gint border) {
+  node->rect.x = x;
+  node->rect.y = y;
+  node->rect.width = width + 2 * border;
+  node->rect.height = height + 2 * border;
+}
+
+/** 查询窗口属性并放置于最上层 */
+void add_node(GtkShotWindowTree *tree, Window xid) {
+  Display *dpy = GDK_WINDOW_XDISPLAY(tree->root);
+  XWindowAttributes attr;
+  WindowNode node;
+  Status succ = 0;
+
+  gdk_error_trap_push();
+  succ = XGetWindowAttributes(dpy, xid, &attr);
+  if (gdk_error_trap_pop() != 0 || !succ) return;
+
+  node.xid = xid;
+  node.viewable = attr.map_state == IsViewable;
+  node.override_redirect = attr.override_redirect;
+  set_node_rect(&node, attr.x, attr.y
+                  , attr.width, attr.height, attr.border_width);
+  g_array_append_val(tree->nodes, node);
+}
+
+/** 将窗口放置在above之上,above为None时放置于最底层 */
+void restack_node(GtkShotWindowTree *tree, gint i, Window above) {
+  WindowNode node = NODE(tree, i);
+  gint j = 0;
+
+  g_array_remove_index(tree->nodes, i);
+  if (above != None) {
+    j = find_node(tree, above);
+    j = j < 0 ? (gint) tree->nodes->len : j + 1;
+  }
+  g_array_insert_val(tree->nodes, j, node);
+}